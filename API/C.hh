@@ -2,6 +2,7 @@
 
 #include <graphiti/Graphiti.hh>
 #include <graphiti/Entities/MVC.hh>
+#include <graphiti/Entities/Graph/GraphSnapshot.hh>
 
 Graphiti* g_Graphiti = NULL;
 
@@ -95,6 +96,34 @@ extern "C" {
         return g_Graphiti->entities().active()->getAttribute(name);
     }
 
+	// ----- Snapshots -----
+
+    bool saveSnapshot(const char* filename)
+    {
+        LOG("[API] saveSnapshot('%s')\n", filename);
+        Entity* entity = g_Graphiti->entities().active();
+        if (entity->type() != Entity::GRAPH)
+        {
+            LOG("[API] Active entity is not a graph!\n");
+            return false;
+        }
+        GraphSnapshot snapshot(static_cast<GraphEntity*>(entity));
+        return snapshot.save(filename);
+    }
+
+    bool loadSnapshot(const char* filename)
+    {
+        LOG("[API] loadSnapshot('%s')\n", filename);
+        Entity* entity = g_Graphiti->entities().active();
+        if (entity->type() != Entity::GRAPH)
+        {
+            LOG("[API] Active entity is not a graph!\n");
+            return false;
+        }
+        GraphSnapshot snapshot(static_cast<GraphEntity*>(entity));
+        return snapshot.load(filename);
+    }
+
 	// ----- Scripts -----
 
 	void registerScript(const char* name, const char* source)
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <graphiti/Entities/Graph/GraphCommands.hh>
+#include <graphiti/Entities/Graph/GraphJSON.hh>
 
 namespace API {
 namespace Graph {
@@ -57,6 +58,38 @@ extern "C" {
         return getActiveGraph()->getNodeIDs();
     }
 
+    // ----- Batches -----
+
+    std::vector<Node::ID> addNodes(const std::vector<std::string>& labels)
+    {
+        // LOG("[API] addNodes(%lu)\n", labels.size());
+        return getActiveGraph()->addNodes(labels);
+    }
+
+    std::vector<Edge::ID> addEdges(const std::vector<Node::ID>& uid1s, const std::vector<Node::ID>& uid2s)
+    {
+        // LOG("[API] addEdges(%lu)\n", uid1s.size());
+        return getActiveGraph()->addEdges(uid1s, uid2s);
+    }
+
+    void setNodeAttributes(const std::vector<Node::ID>& ids, const char* name, const char* type, const std::vector<double>& values)
+    {
+        // LOG("[API] setNodeAttributes(%lu, '%s', '%s')\n", ids.size(), name, type);
+        GraphEntity* graph = getActiveGraph();
+        GraphAttribute::ID attribute = graph->registerNodeAttribute(name, type);
+        if (attribute != 0)
+            graph->setNodeAttributes(ids, attribute, values);
+    }
+
+    void setNodeAttributes(const std::vector<Node::ID>& ids, const char* name, const char* type, const std::vector<std::string>& values)
+    {
+        // LOG("[API] setNodeAttributes(%lu, '%s', '%s')\n", ids.size(), name, type);
+        GraphEntity* graph = getActiveGraph();
+        GraphAttribute::ID attribute = graph->registerNodeAttribute(name, type);
+        if (attribute != 0)
+            graph->setNodeAttributes(ids, attribute, values);
+    }
+
 extern "C"
 {
     void setNodeLabel(Node::ID id, const char* label)
@@ -83,6 +116,71 @@ extern "C"
         return getActiveGraph()->getNodeAttribute(id, name);
     }
 
+    // NOTE : Typed setters take a handle from registerNodeAttribute and skip string parsing.
+
+    GraphAttribute::ID registerNodeAttribute(const char* name, const char* type)
+    {
+        // LOG("[API] registerNodeAttribute('%s', '%s')\n", name, type);
+        return getActiveGraph()->registerNodeAttribute(name, type);
+    }
+
+    void setNodeAttributeInt(Node::ID id, GraphAttribute::ID attribute, int value)
+    {
+        IntVariable variable;
+        variable.set(value);
+        getActiveGraph()->setNodeAttribute(id, attribute, variable);
+    }
+
+    void setNodeAttributeBool(Node::ID id, GraphAttribute::ID attribute, bool value)
+    {
+        BooleanVariable variable;
+        variable.set(value);
+        getActiveGraph()->setNodeAttribute(id, attribute, variable);
+    }
+
+    void setNodeAttributeFloat(Node::ID id, GraphAttribute::ID attribute, float value)
+    {
+        FloatVariable variable;
+        variable.set(value);
+        getActiveGraph()->setNodeAttribute(id, attribute, variable);
+    }
+}
+
+    void setNodeAttributeVec2(Node::ID id, GraphAttribute::ID attribute, const glm::vec2& value)
+    {
+        Vec2Variable variable;
+        variable.set(value);
+        getActiveGraph()->setNodeAttribute(id, attribute, variable);
+    }
+
+    void setNodeAttributeVec3(Node::ID id, GraphAttribute::ID attribute, const glm::vec3& value)
+    {
+        Vec3Variable variable;
+        variable.set(value);
+        getActiveGraph()->setNodeAttribute(id, attribute, variable);
+    }
+
+    void setNodeAttributeVec4(Node::ID id, GraphAttribute::ID attribute, const glm::vec4& value)
+    {
+        Vec4Variable variable;
+        variable.set(value);
+        getActiveGraph()->setNodeAttribute(id, attribute, variable);
+    }
+
+extern "C"
+{
+    NodeArray* exportNodeArray(const char* name)
+    {
+        // LOG("[API] exportNodeArray('%s')\n", name);
+        return getActiveGraph()->exportNodeArray(name);
+    }
+
+    void commitNodeArray(const char* name)
+    {
+        // LOG("[API] commitNodeArray('%s')\n", name);
+        return getActiveGraph()->commitNodeArray(name);
+    }
+
     // ---- Edges -----
 
     Edge::ID addEdge(Node::ID uid1, Node::ID uid2)
@@ -176,33 +274,38 @@ extern "C"
     }
 }
 
+    // ----- Files -----
+
+extern "C"
+{
+    bool loadJSON(const char* filename)
+    {
+        LOG("[API] loadJSON('%s')\n", filename);
+        GraphJSONLoader loader(getActiveGraph());
+        return loader.load(filename);
+    }
+}
+
+    bool saveJSON(const char* filename, bool compact, const std::vector<std::string>& nodeViewAttributes, const std::vector<std::string>& edgeViewAttributes)
+    {
+        LOG("[API] saveJSON('%s', %i)\n", filename, compact);
+        GraphJSONWriter writer(getActiveGraph(), compact);
+        for (auto& name : nodeViewAttributes)
+            writer.addNodeViewAttribute(name);
+        for (auto& name : edgeViewAttributes)
+            writer.addEdgeViewAttribute(name);
+        return writer.save(filename);
+    }
+
     // ----- Commands -----
 
     Sequence::ID sendCommand(Timecode timecode, const char* name, const Variables& variables)
     {
-        Sequence* command = NULL;
-        std::string sname = std::string(name);
-
         // LOG("[API] sendCommand(%lu, '%s', %p)\n", timecode, name, &variables);
 
         GraphEntity* graph = getActiveGraph();
 
-        if (sname == "graph:set_attribute")
-            command = GraphCommandFactory::SetAttribute(graph, variables);
-        else if (sname == "graph:add_node")
-            command = GraphCommandFactory::AddNode(graph, variables);
-        else if (sname == "graph:remove_node")
-            command = GraphCommandFactory::RemoveNode(graph, variables);
-        else if (sname == "graph:set_node_attribute")
-            command = GraphCommandFactory::SetNodeAttribute(graph, variables);
-        else if (sname == "graph:add_edge")
-            command = GraphCommandFactory::AddEdge(graph, variables);
-        else if (sname == "graph:remove_edge")
-            command = GraphCommandFactory::RemoveEdge(graph, variables);
-        else if (sname == "graph:set_edge_attribute")
-            command = GraphCommandFactory::SetEdgeAttribute(graph, variables);
-        else
-            LOG("[API] Unknown command type '%s'!\n", name);
+        Sequence* command = GraphCommandFactory::Create(graph, std::string(name), variables);
 
         if (command == NULL)
         {
@@ -215,5 +318,19 @@ extern "C"
         graph->context()->messages().push(new SequencerMessage("command", "update"));
         return command->id();
     }
+
+    // Queues many commands at once, grouped into one batch per timecode. Returns the batch IDs.
+    std::vector<Sequence::ID> sendCommands(const std::vector<Timecode>& timecodes, const std::vector<std::string>& names, const std::vector<Variables*>& variables)
+    {
+        LOG("[API] sendCommands(%lu)\n", timecodes.size());
+
+        GraphCommandBatcher batcher(getActiveGraph());
+
+        for (unsigned long i = 0; i < timecodes.size() && i < names.size() && i < variables.size(); i++)
+            if (!batcher.add(timecodes[i], names[i], *variables[i]))
+                LOG("[API] Couldn't create command '%s'.\n", names[i].c_str());
+
+        return batcher.submit();
+    }
 }
 }
@@ -100,6 +100,148 @@ static PyObject* convertVariablesToPyDict(Variables* variables)
     return result;
 }
 
+template <typename T, typename S>
+static void copyPyBuffer(const Py_buffer& view, std::vector<T>& result)
+{
+	const S* data = static_cast<const S*>(view.buf);
+	Py_ssize_t count = view.len / view.itemsize;
+
+	result.resize(count);
+	for (Py_ssize_t i = 0; i < count; i++)
+		result[i] = static_cast<T>(data[i]);
+}
+
+inline void convertPyNumber(PyObject* item, double& result) { result = PyFloat_AsDouble(item); }
+inline void convertPyNumber(PyObject* item, unsigned long& result) { result = PyInt_AsUnsignedLongMask(item); }
+
+// Flattens a buffer-protocol object (numpy arrays, ...), a sequence of numbers or
+// a sequence of number sequences into a contiguous vector.
+template <typename T>
+static bool convertPyObjectToVector(PyObject* object, std::vector<T>& result)
+{
+	if (PyObject_CheckBuffer(object))
+	{
+		Py_buffer view;
+		if (PyObject_GetBuffer(object, &view, PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) == 0)
+		{
+			const char* format = view.format != NULL ? view.format : "B";
+			if (*format == '@' || *format == '=' || *format == '<')
+				format++;
+
+			bool supported = true;
+			switch (*format)
+			{
+			case 'f': copyPyBuffer<T, float>(view, result); break;
+			case 'd': copyPyBuffer<T, double>(view, result); break;
+			case 'b': copyPyBuffer<T, signed char>(view, result); break;
+			case 'B': copyPyBuffer<T, unsigned char>(view, result); break;
+			case '?': copyPyBuffer<T, unsigned char>(view, result); break;
+			case 'h': copyPyBuffer<T, short>(view, result); break;
+			case 'H': copyPyBuffer<T, unsigned short>(view, result); break;
+			case 'i': copyPyBuffer<T, int>(view, result); break;
+			case 'I': copyPyBuffer<T, unsigned int>(view, result); break;
+			case 'l': copyPyBuffer<T, long>(view, result); break;
+			case 'L': copyPyBuffer<T, unsigned long>(view, result); break;
+			case 'q': copyPyBuffer<T, long long>(view, result); break;
+			case 'Q': copyPyBuffer<T, unsigned long long>(view, result); break;
+			default: supported = false; break;
+			}
+
+			PyBuffer_Release(&view);
+			if (supported)
+				return true;
+		}
+		PyErr_Clear();
+	}
+
+	// NOTE : Python 2 array.array has no new-style buffer, it goes through the sequence path
+	PyObject* sequence = PySequence_Fast(object, "Expected a sequence or a buffer");
+	if (sequence == NULL)
+		return false;
+
+	Py_ssize_t size = PySequence_Fast_GET_SIZE(sequence);
+	PyObject** items = PySequence_Fast_ITEMS(sequence);
+
+	result.clear();
+	result.reserve(size);
+
+	T value;
+	for (Py_ssize_t i = 0; i < size; i++)
+	{
+		if (PyList_Check(items[i]) || PyTuple_Check(items[i]))
+		{
+			for (Py_ssize_t j = 0; j < PySequence_Fast_GET_SIZE(items[i]); j++)
+			{
+				convertPyNumber(PySequence_Fast_GET_ITEM(items[i], j), value);
+				result.push_back(value);
+			}
+		}
+		else
+		{
+			convertPyNumber(items[i], value);
+			result.push_back(value);
+		}
+	}
+
+	Py_DECREF(sequence);
+
+	if (PyErr_Occurred())
+	{
+		PyErr_Clear();
+		return false;
+	}
+	return true;
+}
+
+static bool convertPyObjectToStrings(PyObject* object, std::vector<std::string>& result)
+{
+	PyObject* sequence = PySequence_Fast(object, "Expected a sequence");
+	if (sequence == NULL)
+		return false;
+
+	Py_ssize_t size = PySequence_Fast_GET_SIZE(sequence);
+	PyObject** items = PySequence_Fast_ITEMS(sequence);
+
+	result.clear();
+	result.reserve(size);
+
+	bool valid = true;
+	for (Py_ssize_t i = 0; i < size && valid; i++)
+	{
+		if (PyUnicode_Check(items[i]))
+		{
+			PyObject* bytes = PyUnicode_AsUTF8String(items[i]);
+			valid = bytes != NULL;
+			if (valid)
+			{
+				result.push_back(std::string(PyString_AsString(bytes)));
+				Py_DECREF(bytes);
+			}
+		}
+		else if (PyString_Check(items[i]))
+			result.push_back(std::string(PyString_AsString(items[i])));
+		else
+			valid = false;
+	}
+
+	Py_DECREF(sequence);
+
+	if (!valid)
+		PyErr_Clear();
+	return valid;
+}
+
+static PyObject* convertIDsToPyList(const std::vector<unsigned long>& ids)
+{
+	PyObject* result = PyList_New(ids.size());
+	if (result)
+	{
+		for (unsigned long i = 0; i < ids.size(); i++)
+			PyList_SET_ITEM(result, i, PyLong_FromUnsignedLong(ids[i]));
+	}
+	return result;
+}
+
 static Variables* convertPyDictToVariables(PyObject* dict)
 {
     if (!PyDict_Check(dict))
@@ -398,6 +540,18 @@ static PyObject* getNodeIDs(PyObject* self, PyObject* args)
 
 	return result;
 }
+static PyObject* addNodes(PyObject* self, PyObject* args)
+{
+	PyObject* labels = NULL;
+	std::vector<std::string> slabels;
+
+	(void)self;
+
+	PROTECT_PARSE(PyArg_ParseTuple(args, "O", &labels))
+	PROTECT_PARSE(convertPyObjectToStrings(labels, slabels))
+
+	return convertIDsToPyList(API::Graph::addNodes(slabels));
+}
 static PyObject* setNodeLabel(PyObject* self, PyObject* args)
 {
 	Node::ID id;
@@ -458,6 +612,228 @@ static PyObject* getNodeAttribute(PyObject* self, PyObject* args)
 		return result;
 	}
 }
+static PyObject* setNodeAttributes(PyObject* self, PyObject* args)
+{
+	PyObject* ids = NULL;
+	char* name = NULL;
+	char* type = NULL;
+	PyObject* values = NULL;
+
+	std::vector<Node::ID> nids;
+
+	(void) self;
+
+	PROTECT_PARSE(PyArg_ParseTuple(args, "OssO", &ids, &name, &type, &values))
+	PROTECT_PARSE(convertPyObjectToVector(ids, nids))
+
+	if (std::string(type) == "string")
+	{
+		std::vector<std::string> svalues;
+		PROTECT_PARSE(convertPyObjectToStrings(values, svalues))
+		API::Graph::setNodeAttributes(nids, name, type, svalues);
+	}
+	else
+	{
+		std::vector<double> dvalues;
+		PROTECT_PARSE(convertPyObjectToVector(values, dvalues))
+		API::Graph::setNodeAttributes(nids, name, type, dvalues);
+	}
+
+	return Py_BuildValue("");
+}
+static PyObject* registerNodeAttribute(PyObject* self, PyObject* args)
+{
+	char* name = NULL;
+	char* type = NULL;
+
+	(void) self;
+
+	PROTECT_PARSE(PyArg_ParseTuple(args, "ss", &name, &type))
+
+	GraphAttribute::ID handle = API::Graph::registerNodeAttribute(name, type);
+
+	return Py_BuildValue("k", handle);
+}
+static PyObject* setNodeAttributeInt(PyObject* self, PyObject* args)
+{
+	Node::ID id;
+	GraphAttribute::ID attribute;
+	int value;
+
+	(void) self;
+
+	PROTECT_PARSE(PyArg_ParseTuple(args, "kki", &id, &attribute, &value))
+
+	API::Graph::setNodeAttributeInt(id, attribute, value);
+
+	return Py_BuildValue("");
+}
+static PyObject* setNodeAttributeBool(PyObject* self, PyObject* args)
+{
+	Node::ID id;
+	GraphAttribute::ID attribute;
+	PyObject* value;
+
+	(void) self;
+
+	PROTECT_PARSE(PyArg_ParseTuple(args, "kkO", &id, &attribute, &value))
+
+	API::Graph::setNodeAttributeBool(id, attribute, PyObject_IsTrue(value) == 1);
+
+	return Py_BuildValue("");
+}
+static PyObject* setNodeAttributeFloat(PyObject* self, PyObject* args)
+{
+	Node::ID id;
+	GraphAttribute::ID attribute;
+	float value;
+
+	(void) self;
+
+	PROTECT_PARSE(PyArg_ParseTuple(args, "kkf", &id, &attribute, &value))
+
+	API::Graph::setNodeAttributeFloat(id, attribute, value);
+
+	return Py_BuildValue("");
+}
+static PyObject* setNodeAttributeVec2(PyObject* self, PyObject* args)
+{
+	Node::ID id;
+	GraphAttribute::ID attribute;
+	glm::vec2 value;
+
+	(void) self;
+
+	PROTECT_PARSE(PyArg_ParseTuple(args, "kkff", &id, &attribute, &value.x, &value.y))
+
+	API::Graph::setNodeAttributeVec2(id, attribute, value);
+
+	return Py_BuildValue("");
+}
+static PyObject* setNodeAttributeVec3(PyObject* self, PyObject* args)
+{
+	Node::ID id;
+	GraphAttribute::ID attribute;
+	glm::vec3 value;
+
+	(void) self;
+
+	PROTECT_PARSE(PyArg_ParseTuple(args, "kkfff", &id, &attribute, &value.x, &value.y, &value.z))
+
+	API::Graph::setNodeAttributeVec3(id, attribute, value);
+
+	return Py_BuildValue("");
+}
+static PyObject* setNodeAttributeVec4(PyObject* self, PyObject* args)
+{
+	Node::ID id;
+	GraphAttribute::ID attribute;
+	glm::vec4 value;
+
+	(void) self;
+
+	PROTECT_PARSE(PyArg_ParseTuple(args, "kkffff", &id, &attribute, &value.x, &value.y, &value.z, &value.w))
+
+	API::Graph::setNodeAttributeVec4(id, attribute, value);
+
+	return Py_BuildValue("");
+}
+
+// Python owner of an exported node array storage. Memoryviews keep the owner alive and the owner keeps the
+// storage alive, GraphEntity replaces the storage instead of resizing it while an owner exists.
+// NOTE : After the node count changes, views mapped before keep the previous storage and are no longer committed.
+//        Python 2 memoryviews can't slice typed buffers, map them with numpy.asarray(...) instead.
+struct NodeArrayObject
+{
+	PyObject_HEAD
+	std::shared_ptr<std::vector<float>>* Storage;
+	Py_ssize_t Shape;
+	Py_ssize_t Stride;
+};
+
+static void deallocNodeArray(PyObject* self)
+{
+	delete reinterpret_cast<NodeArrayObject*>(self)->Storage;
+	Py_TYPE(self)->tp_free(self);
+}
+
+static int getNodeArrayBuffer(PyObject* self, Py_buffer* view, int flags)
+{
+	NodeArrayObject* array = reinterpret_cast<NodeArrayObject*>(self);
+
+	if (PyBuffer_FillInfo(view, self, (*array->Storage)->data(), array->Shape * sizeof(float), 0, flags) != 0)
+		return -1;
+
+	view->itemsize = sizeof(float);
+	view->format = (flags & PyBUF_FORMAT) ? const_cast<char*>("f") : NULL;
+	view->ndim = 1;
+	view->shape = (flags & PyBUF_ND) ? &array->Shape : NULL;
+	view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? &array->Stride : NULL;
+
+	return 0;
+}
+
+static PyBufferProcs g_NodeArrayBuffer;
+static PyTypeObject g_NodeArrayType = { PyVarObject_HEAD_INIT(NULL, 0) };
+
+static bool initializeNodeArrayType()
+{
+	g_NodeArrayBuffer.bf_getbuffer = getNodeArrayBuffer;
+
+	g_NodeArrayType.tp_name = "graphiti.NodeArray";
+	g_NodeArrayType.tp_basicsize = sizeof(NodeArrayObject);
+	g_NodeArrayType.tp_dealloc = deallocNodeArray;
+	g_NodeArrayType.tp_as_buffer = &g_NodeArrayBuffer;
+	g_NodeArrayType.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER;
+	g_NodeArrayType.tp_doc = "Storage of a node array mapped by graphiti.positions() or graphiti.colors()";
+
+	return PyType_Ready(&g_NodeArrayType) == 0;
+}
+
+static PyObject* exportNodeArray(const char* name)
+{
+	NodeArray* array = API::Graph::exportNodeArray(name);
+	if (array == NULL)
+		return Py_BuildValue("");
+
+	NodeArrayObject* owner = PyObject_New(NodeArrayObject, &g_NodeArrayType);
+	if (owner == NULL)
+		return NULL;
+
+	owner->Storage = new std::shared_ptr<std::vector<float>>(array->Data);
+	owner->Shape = array->Data->size();
+	owner->Stride = sizeof(float);
+
+	PyObject* view = PyMemoryView_FromObject(reinterpret_cast<PyObject*>(owner));
+	Py_DECREF(owner);
+	return view;
+}
+static PyObject* positions(PyObject* self, PyObject* args)
+{
+	(void) self;
+	(void) args;
+
+	return exportNodeArray("og:space:position");
+}
+static PyObject* colors(PyObject* self, PyObject* args)
+{
+	(void) self;
+	(void) args;
+
+	return exportNodeArray("og:space:color");
+}
+static PyObject* commit(PyObject* self, PyObject* args)
+{
+	(void) self;
+
+	char* name = NULL;
+
+	PROTECT_PARSE(PyArg_ParseTuple(args, "s", &name));
+
+	API::Graph::commitNodeArray(name);
+
+	return Py_BuildValue("");
+}
 
 // ----- Edges -----
 
@@ -472,6 +848,22 @@ static PyObject* addEdge(PyObject* self, PyObject* args)
 
 	return PyLong_FromLong(API::Graph::addEdge(id1, id2));
 }
+static PyObject* addEdges(PyObject* self, PyObject* args)
+{
+	PyObject* sources = NULL;
+	PyObject* targets = NULL;
+
+	std::vector<Node::ID> uid1s;
+	std::vector<Node::ID> uid2s;
+
+	(void)self;
+
+	PROTECT_PARSE(PyArg_ParseTuple(args, "OO", &sources, &targets))
+	PROTECT_PARSE(convertPyObjectToVector(sources, uid1s))
+	PROTECT_PARSE(convertPyObjectToVector(targets, uid2s))
+
+	return convertIDsToPyList(API::Graph::addEdges(uid1s, uid2s));
+}
 static PyObject* removeEdge(PyObject* self, PyObject* args)
 {
 	Edge::ID id;
@@ -619,6 +1011,39 @@ static PyObject* getSelectedNode(PyObject* self, PyObject* args)
 
 // ----- Commands -----
 
+static PyObject* loadJSONNative(PyObject* self, PyObject* args)
+{
+	char* filename = NULL;
+
+	(void) self;
+
+	PROTECT_PARSE(PyArg_ParseTuple(args, "s", &filename))
+
+	return PyBool_FromLong(API::Graph::loadJSON(filename) ? 1 : 0);
+}
+
+static PyObject* saveJSONNative(PyObject* self, PyObject* args)
+{
+	char* filename = NULL;
+	PyObject* compact = NULL;
+	PyObject* nodeAttributes = NULL;
+	PyObject* edgeAttributes = NULL;
+
+	(void) self;
+
+	PROTECT_PARSE(PyArg_ParseTuple(args, "s|OOO", &filename, &compact, &nodeAttributes, &edgeAttributes))
+
+	std::vector<std::string> nodeViewAttributes;
+	std::vector<std::string> edgeViewAttributes;
+
+	if ((nodeAttributes != NULL && !convertPyObjectToStrings(nodeAttributes, nodeViewAttributes)) ||
+	    (edgeAttributes != NULL && !convertPyObjectToStrings(edgeAttributes, edgeViewAttributes)))
+		return NULL;
+
+	bool result = API::Graph::saveJSON(filename, compact != NULL && PyObject_IsTrue(compact), nodeViewAttributes, edgeViewAttributes);
+	return PyBool_FromLong(result ? 1 : 0);
+}
+
 static PyObject* sendCommand(PyObject* self, PyObject* args)
 {
     (void) self;
@@ -648,10 +1073,98 @@ static PyObject* sendCommand(PyObject* self, PyObject* args)
     return cid;
 }
 
+
+// Takes a list of [timecode, name, arguments] like the JSON timeline
+static PyObject* sendCommands(PyObject* self, PyObject* args)
+{
+	PyObject* commands;
+
+	(void) self;
+
+	PROTECT_PARSE(PyArg_ParseTuple(args, "O", &commands))
+
+	PyObject* sequence = PySequence_Fast(commands, "Expected a sequence of commands");
+	if (sequence == NULL)
+		return NULL;
+
+	Py_ssize_t size = PySequence_Fast_GET_SIZE(sequence);
+	PyObject** items = PySequence_Fast_ITEMS(sequence);
+
+	std::vector<Timecode> timecodes;
+	std::vector<std::string> names;
+	std::vector<Variables*> variables;
+
+	timecodes.reserve(size);
+	names.reserve(size);
+	variables.reserve(size);
+
+	for (Py_ssize_t i = 0; i < size; i++)
+	{
+		Timecode timecode;
+		char* name = NULL;
+		PyObject* dict;
+
+		// NOTE : A malformed entry is skipped, the rest of the list is still sent
+		PyObject* command = PySequence_Tuple(items[i]);
+		if (command == NULL || !PyArg_ParseTuple(command, "ksO", &timecode, &name, &dict))
+		{
+			LOG("[PYTHON] Command %li is not a [timecode, name, arguments] list, skipped!\n", (long) i);
+			Py_XDECREF(command);
+			PyErr_Clear();
+			continue;
+		}
+
+		Variables* vars = convertPyDictToVariables(dict);
+		Py_DECREF(command);
+		if (vars == NULL)
+		{
+			LOG("[PYTHON] Arguments of command %li ('%s') are not a dictionary, skipped!\n", (long) i, name);
+			continue;
+		}
+
+		timecodes.push_back(timecode);
+		names.push_back(std::string(name));
+		variables.push_back(vars);
+	}
+
+	Py_DECREF(sequence);
+
+	PyObject* result = NULL;
+	if (!PyErr_Occurred())
+		result = convertIDsToPyList(API::Graph::sendCommands(timecodes, names, variables));
+
+	for (auto vars : variables)
+		delete vars;
+
+	return result;
+}
+
 }
 
 // ----- Scripts -----
 
+static PyObject* saveSnapshot(PyObject* self, PyObject* args)
+{
+	char* filename = NULL;
+
+	(void) self;
+
+	PROTECT_PARSE(PyArg_ParseTuple(args, "s", &filename))
+
+	return PyBool_FromLong(API::saveSnapshot(filename) ? 1 : 0);
+}
+
+static PyObject* loadSnapshot(PyObject* self, PyObject* args)
+{
+	char* filename = NULL;
+
+	(void) self;
+
+	PROTECT_PARSE(PyArg_ParseTuple(args, "s", &filename))
+
+	return PyBool_FromLong(API::loadSnapshot(filename) ? 1 : 0);
+}
+
 static PyObject* registerScript(PyObject* self, PyObject* args)
 {
     char* name = NULL;
@@ -719,6 +1232,9 @@ static PyMethodDef g_Module[] =
     // ----- Attributes -----
     {"set_attribute",         API::Python::setAttribute,        METH_VARARGS, "Set entity attribute"},
     {"get_attribute",         API::Python::getAttribute,        METH_VARARGS, "Get entity attribute"},
+    // ----- Snapshots -----
+    {"save_snapshot",         API::Python::saveSnapshot,        METH_VARARGS, "Save the active graph in a binary snapshot"},
+    {"load_snapshot",         API::Python::loadSnapshot,        METH_VARARGS, "Load a binary snapshot into the active graph"},
     // ----- Scripts -----
     {"register_script",       API::Python::registerScript,      METH_VARARGS, "Register a script"},
     {"unregister_script",     API::Python::unregisterScript,    METH_VARARGS, "Unregister a script"},
@@ -729,6 +1245,7 @@ static PyMethodDef g_Module[] =
 
         // ----- Nodes -----
         {"add_node",              API::Python::Graph::addNode,             METH_VARARGS, "Add node to the graph"},
+        {"add_nodes",             API::Python::Graph::addNodes,            METH_VARARGS, "Add a batch of nodes to the graph"},
         {"remove_node",           API::Python::Graph::removeNode,          METH_VARARGS, "Remove node from the graph"},
         {"tag_node",              API::Python::Graph::tagNode,             METH_VARARGS, "Tag a node"},
         {"count_nodes",           API::Python::Graph::countNodes,          METH_VARARGS, "Count nodes"},
@@ -737,8 +1254,20 @@ static PyMethodDef g_Module[] =
         {"get_node_label",        API::Python::Graph::getNodeLabel,        METH_VARARGS, "Get node label" },
         {"set_node_attribute",    API::Python::Graph::setNodeAttribute,    METH_VARARGS, "Set node attribute"},
         {"get_node_attribute",    API::Python::Graph::getNodeAttribute,    METH_VARARGS, "Get node attribute"},
+        {"set_node_attributes",   API::Python::Graph::setNodeAttributes,   METH_VARARGS, "Set a node attribute on a batch of nodes"},
+        {"positions",             API::Python::Graph::positions,           METH_VARARGS, "Map node positions as a flat float32 memoryview"},
+        {"colors",                API::Python::Graph::colors,              METH_VARARGS, "Map node colors as a flat float32 memoryview"},
+        {"commit",                API::Python::Graph::commit,              METH_VARARGS, "Write a mapped node array (e.g. 'og:space:position') back to its view"},
+        {"register_node_attribute", API::Python::Graph::registerNodeAttribute, METH_VARARGS, "Register a node attribute for the typed setters"},
+        {"set_node_attribute_int",   API::Python::Graph::setNodeAttributeInt,   METH_VARARGS, "Set int node attribute"},
+        {"set_node_attribute_bool",  API::Python::Graph::setNodeAttributeBool,  METH_VARARGS, "Set bool node attribute"},
+        {"set_node_attribute_float", API::Python::Graph::setNodeAttributeFloat, METH_VARARGS, "Set float node attribute"},
+        {"set_node_attribute_vec2",  API::Python::Graph::setNodeAttributeVec2,  METH_VARARGS, "Set vec2 node attribute"},
+        {"set_node_attribute_vec3",  API::Python::Graph::setNodeAttributeVec3,  METH_VARARGS, "Set vec3 node attribute"},
+        {"set_node_attribute_vec4",  API::Python::Graph::setNodeAttributeVec4,  METH_VARARGS, "Set vec4 node attribute"},
         // ----- Edges -----
         {"add_edge",              API::Python::Graph::addEdge,             METH_VARARGS, "Add edge to the graph"},
+        {"add_edges",             API::Python::Graph::addEdges,            METH_VARARGS, "Add a batch of edges to the graph"},
         {"remove_edge",           API::Python::Graph::removeEdge,          METH_VARARGS, "Remove edge from the graph"},
         {"count_edges",           API::Python::Graph::countEdges,          METH_VARARGS, "Count edges"},
         {"get_edge_ids",          API::Python::Graph::getEdgeIDs,          METH_VARARGS, "Get edge IDs" },
@@ -753,13 +1282,19 @@ static PyMethodDef g_Module[] =
         {"count_selected_nodes",  API::Python::Graph::countSelectedNodes,  METH_VARARGS, "Count selected nodes"},
         {"get_selected_node",     API::Python::Graph::getSelectedNode,     METH_VARARGS, "Get a selected node"},
         // ----- Commands -----
+        {"load_json_native",      API::Python::Graph::loadJSONNative,      METH_VARARGS, "Load a JSON graph file with the native streaming loader"},
+        {"save_json_native",      API::Python::Graph::saveJSONNative,      METH_VARARGS, "Save the graph to a JSON file with the native streaming writer"},
         {"send_command",          API::Python::Graph::sendCommand,         METH_VARARGS, "Send a command"},
+        {"send_commands",         API::Python::Graph::sendCommands,        METH_VARARGS, "Send a list of [timecode, name, arguments] commands, batched by timecode"},
 
 	{NULL, NULL, 0, NULL}
 };
 
 static void initialize()
 {
+	if (!Graph::initializeNodeArrayType())
+		LOG("[PYTHON] Couldn't register the node array type!\n");
+
 	Py_InitModule("graphiti", g_Module);
 }
 
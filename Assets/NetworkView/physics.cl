@@ -29,38 +29,70 @@ typedef struct
 } EdgeInstance;
 
 
-__kernel void repulsion(__global NodeInstance* node_instances, const float k)
+// NOTE : Force kernels gather, every work-item only writes the force of its own node so the result does not
+// depend on the scheduling. Each node sums its terms in the same order on every run.
+
+// Repulsion between every pair of nodes, tiled : each work group stages a tile of positions in local memory,
+// then every work-item of the group accumulates the tile. The global size is node_count rounded up to the
+// work group size, tile holds one position per work-item.
+__kernel void repulsion(__global NodeInstance* node_instances,
+                        const unsigned int node_count,
+                        const float k,
+                        __local float4* tile)
 {
-    unsigned long node_count = get_global_size(0);
-    unsigned long i = get_global_id(0);
+    unsigned int i = get_global_id(0);
+    unsigned int local_id = get_local_id(0);
+    unsigned int local_size = get_local_size(0);
+
+    float4 position = i < node_count ? node_instances[i].Position : (float4)(0.0);
+    float4 force = (float4)(0.0);
 
-    for (unsigned long j = i + 1; j < node_count; j++)
+    for (unsigned int base = 0; base < node_count; base += local_size)
     {
-        float4 direction = node_instances[i].Position - node_instances[j].Position;
-        float magnitude = length(direction.xyz); // NOTE: Make sure we ignore W component
-        if (magnitude > 0.0)
+        unsigned int j = base + local_id;
+        tile[local_id] = j < node_count ? node_instances[j].Position : (float4)(0.0);
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        unsigned int count = min(local_size, node_count - base);
+        for (unsigned int t = 0; t < count; t++)
         {
-            float4 f = (direction / magnitude) * (k * k / magnitude);
-            node_instances[i].Force.Direction += f;
-            node_instances[j].Force.Direction -= f;
+            float4 direction = position - tile[t];
+            direction.w = 0.0; // NOTE: Make sure we ignore W component
+            float magnitude = length(direction.xyz);
+            if (magnitude > 0.0)
+                force += direction * (k * k / (magnitude * magnitude));
         }
+        barrier(CLK_LOCAL_MEM_FENCE);
     }
+
+    if (i < node_count)
+        node_instances[i].Force.Direction = force;
 }
 
+// Attraction along the links, gathered over the adjacency lists of each node (CSR) : the neighbors of node i
+// are neighbors[offsets[i]] to neighbors[offsets[i + 1] - 1], both directions of every edge are listed.
 __kernel void attraction(__global NodeInstance* node_instances,
-                         __global EdgeInstance* edge_instances,
+                         __global const unsigned int* offsets,
+                         __global const unsigned int* neighbors,
+                         const unsigned int node_count,
                          const float k)
 {
     unsigned int i = get_global_id(0);
+    if (i >= node_count)
+        return;
 
-    unsigned int src = edge_instances[i].SourceID;
-    unsigned int dst = edge_instances[i].TargetID;
+    float4 position = node_instances[i].Position;
+    float4 force = (float4)(0.0);
+
+    for (unsigned int l = offsets[i]; l < offsets[i + 1]; l++)
+    {
+        float4 direction = position - node_instances[neighbors[l]].Position;
+        float magnitude = length(direction.xyz); // NOTE: Make sure we ignore W component
 
-    float4 direction = node_instances[src].Position - node_instances[dst].Position;
-    float magnitude = length(direction.xyz); // NOTE: Make sure we ignore W component
+        force -= direction * magnitude / k;
+    }
 
-    node_instances[src].Force.Direction -= direction * magnitude / k;
-    node_instances[dst].Force.Direction += direction * magnitude / k;
+    node_instances[i].Force.Direction += force;
 }
 
 __kernel void node_animation(__global NodeInstance* instances, const float temperature)
@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <graphiti/Entities/MVC.hh>
+
+// graphiti-bench : micro-benchmarks of the graph model, run them after touching its storage or its setters.
+// Lookup sizes grow by 100x, constant time operations should report about the same time at every size.
+
+static double now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Best of a few runs, in nanoseconds per call
+template <typename F>
+static double measure(unsigned long calls, F function)
+{
+	double best = 1e30;
+	for (unsigned int run = 0; run < 5; run++)
+	{
+		double start = now();
+		function();
+		best = std::min(best, now() - start);
+	}
+	return best * 1e9 / calls;
+}
+
+// ----- Model Lookups -----
+
+static void benchLookups(unsigned long count)
+{
+	GraphModel model;
+	std::vector<Node::ID> ids;
+	ids.reserve(count);
+
+	Node::Data data;
+	for (unsigned long i = 0; i < count; i++)
+		ids.push_back(model.addNode(data));
+
+	// NOTE : Removes and adds back a tenth of the nodes so lookups go through reused slots too
+	std::mt19937 random(1);
+	for (unsigned long i = 0; i < count / 10; i++)
+	{
+		unsigned long k = random() % ids.size();
+		model.removeNode(ids[k]);
+		ids[k] = model.addNode(data);
+	}
+
+	// NOTE : Random order pays a cache miss per lookup once the nodes outgrow the caches, insertion order doesn't
+	const unsigned long calls = 1000000;
+	std::vector<Node::ID> order(calls);
+	std::vector<Node::ID> sequence(calls);
+	for (unsigned long i = 0; i < calls; i++)
+	{
+		order[i] = ids[random() % ids.size()];
+		sequence[i] = ids[i % ids.size()];
+	}
+
+	unsigned long sink = 0;
+
+	double ordered = measure(calls, [&]()
+	{
+		for (auto id : sequence)
+			sink += model.node(id)->id() & 1;
+	});
+
+	double lookup = measure(calls, [&]()
+	{
+		for (auto id : order)
+			sink += model.node(id)->id() & 1;
+	});
+
+	double stale = measure(calls, [&]()
+	{
+		for (auto id : order)
+			sink += model.node(id + (static_cast<Node::ID>(1) << SlotMap<Node>::IndexBits)) == NULL;
+	});
+
+	double churn = measure(count / 10, [&]()
+	{
+		for (unsigned long i = 0; i < count / 10; i++)
+		{
+			model.removeNode(ids[i]);
+			ids[i] = model.addNode(data);
+		}
+	});
+
+	printf("%10lu nodes  node() %6.1f ns in order, %6.1f ns random  stale node() %6.1f ns  remove + add %6.1f ns  (%lu)\n",
+		count, ordered, lookup, stale, churn, sink & 1);
+}
+
+// ----- Attribute Setters -----
+
+// Stands for SpaceView : the string path parses the value, the typed path reads it as is
+class BenchListener : public GraphListener
+{
+public:
+	BenchListener() : Sum(0) {}
+
+	void onSetNodeAttribute(Node::ID uid, const std::string& name, VariableType type, const std::string& value) override
+	{
+		(void) uid;
+		(void) name;
+
+		if (type == RD_VEC4)
+		{
+			Vec4Variable variable;
+			variable.set(value);
+			Sum += variable.value().x;
+		}
+		else if (type == RD_FLOAT)
+		{
+			FloatVariable variable;
+			variable.set(value);
+			Sum += variable.value();
+		}
+	}
+
+	void onSetNodeAttributeValue(Node::ID uid, const std::string& name, IVariable& value) override
+	{
+		(void) uid;
+		(void) name;
+
+		if (value.type() == RD_VEC4)
+			Sum += static_cast<Vec4Variable&>(value).value().x;
+		else if (value.type() == RD_FLOAT)
+			Sum += static_cast<FloatVariable&>(value).value();
+	}
+
+	double Sum;
+};
+
+// NOTE : The string path includes formatting the value on the caller side, like std.vec4_to_str in Python
+static void benchSetters(GraphEntity& graph, const std::vector<Node::ID>& ids, const char* name, const char* type)
+{
+	const bool vec4 = std::string(type) == "vec4";
+	char buffer[128];
+	unsigned long sink = 0;
+
+	double format = measure(ids.size(), [&]()
+	{
+		for (unsigned long i = 0; i < ids.size(); i++)
+			sink += vec4 ? snprintf(buffer, sizeof(buffer), "%f %f %f %f", i * 0.001f, 0.5f, 0.25f, 1.0f) : snprintf(buffer, sizeof(buffer), "%f", i * 0.001f);
+	});
+
+	double string = measure(ids.size(), [&]()
+	{
+		for (unsigned long i = 0; i < ids.size(); i++)
+		{
+			if (vec4)
+				snprintf(buffer, sizeof(buffer), "%f %f %f %f", i * 0.001f, 0.5f, 0.25f, 1.0f);
+			else
+				snprintf(buffer, sizeof(buffer), "%f", i * 0.001f);
+			graph.setNodeAttribute(ids[i], name, type, buffer);
+		}
+	});
+
+	GraphAttribute::ID attribute = graph.registerNodeAttribute(name, type);
+
+	double typed = measure(ids.size(), [&]()
+	{
+		for (unsigned long i = 0; i < ids.size(); i++)
+		{
+			if (vec4)
+			{
+				Vec4Variable variable;
+				variable.set(glm::vec4(i * 0.001f, 0.5f, 0.25f, 1.0f));
+				graph.setNodeAttribute(ids[i], attribute, variable);
+			}
+			else
+			{
+				FloatVariable variable;
+				variable.set(i * 0.001f);
+				graph.setNodeAttribute(ids[i], attribute, variable);
+			}
+		}
+	});
+
+	printf("%-16s %-5s  string %7.1f ns (formatting %6.1f ns)  typed %6.1f ns  x%.0f  (%lu)\n",
+		name, type, string, format, typed, string / typed, sink & 1);
+}
+
+int main(int argc, char** argv)
+{
+	(void) argc;
+	(void) argv;
+
+	printf("--- Graph model lookups (best of 5) ---\n");
+	benchLookups(1000);
+	benchLookups(100000);
+	benchLookups(1000000);
+
+	printf("--- Node attribute setters, string against typed (200000 nodes, best of 5) ---\n");
+	{
+		GraphEntity graph;
+		BenchListener listener;
+		graph.listeners().push_back(&listener);
+
+		std::vector<Node::ID> ids;
+		for (unsigned long i = 0; i < 200000; i++)
+			ids.push_back(graph.addNode("node"));
+
+		benchSetters(graph, ids, "og:space:color", "vec4");
+		benchSetters(graph, ids, "weight", "float");
+		benchSetters(graph, ids, "rgba", "vec4");
+
+		graph.listeners().clear();
+	}
+
+	return 0;
+}
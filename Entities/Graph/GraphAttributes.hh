@@ -0,0 +1,447 @@
+#pragma once
+
+#include <raindance/Core/Variables.hh>
+
+// Allocates a variable of the given type from its string form, NULL if the type is not supported.
+inline IVariable* parseVariable(VariableType type, const std::string& value)
+{
+    IVariable* variable = NULL;
+
+    switch (type)
+    {
+    case RD_STRING:  variable = new StringVariable(); break;
+    case RD_INT:     variable = new IntVariable(); break;
+    case RD_FLOAT:   variable = new FloatVariable(); break;
+    case RD_BOOLEAN: variable = new BooleanVariable(); break;
+    case RD_VEC2:    variable = new Vec2Variable(); break;
+    case RD_VEC3:    variable = new Vec3Variable(); break;
+    case RD_VEC4:    variable = new Vec4Variable(); break;
+    default:         return NULL;
+    }
+
+    variable->set(value);
+    return variable;
+}
+
+// Formats a variable the way attribute values are passed around as strings ("x y z" for vectors).
+inline std::string formatVariable(IVariable& variable)
+{
+    std::ostringstream result;
+    result.precision(9);
+
+    switch (variable.type())
+    {
+    case RD_STRING:  return static_cast<StringVariable&>(variable).value();
+    case RD_INT:     result << static_cast<IntVariable&>(variable).value(); break;
+    case RD_FLOAT:   result << static_cast<FloatVariable&>(variable).value(); break;
+    case RD_BOOLEAN: return static_cast<BooleanVariable&>(variable).value() ? "true" : "false";
+    case RD_VEC2:
+        {
+            glm::vec2 v = static_cast<Vec2Variable&>(variable).value();
+            result << v[0] << " " << v[1];
+        }
+        break;
+    case RD_VEC3:
+        {
+            glm::vec3 v = static_cast<Vec3Variable&>(variable).value();
+            result << v[0] << " " << v[1] << " " << v[2];
+        }
+        break;
+    case RD_VEC4:
+        {
+            glm::vec4 v = static_cast<Vec4Variable&>(variable).value();
+            result << v[0] << " " << v[1] << " " << v[2] << " " << v[3];
+        }
+        break;
+    default:
+        break;
+    }
+
+    return result.str();
+}
+
+// Interns attribute strings so string columns only store 32-bit indices.
+class StringDictionary
+{
+public:
+    typedef unsigned int ID;
+
+    ID intern(const std::string& value)
+    {
+        auto it = m_Index.find(value);
+        if (it != m_Index.end())
+            return it->second;
+
+        ID id = static_cast<ID>(m_Strings.size());
+        m_Strings.push_back(value);
+        m_Index[value] = id;
+        return id;
+    }
+
+    inline const std::string& get(ID id) const { return m_Strings[id]; }
+    inline unsigned long size() const { return m_Strings.size(); }
+
+    void clear()
+    {
+        m_Strings.clear();
+        m_Index.clear();
+    }
+
+private:
+    std::vector<std::string> m_Strings;
+    std::unordered_map<std::string, ID> m_Index;
+};
+
+// One typed, densely packed attribute column. Rows are element slot indices.
+// Float and vector types share a float array with 1 to 4 components per row,
+// int, bool and dictionary string indices share an integer array.
+class AttributeColumn
+{
+public:
+    AttributeColumn(const std::string& name, VariableType type, StringDictionary* dictionary)
+    : m_Name(name), m_Type(type), m_Dictionary(dictionary)
+    {
+        switch (type)
+        {
+        case RD_FLOAT: m_Components = 1; break;
+        case RD_VEC2:  m_Components = 2; break;
+        case RD_VEC3:  m_Components = 3; break;
+        case RD_VEC4:  m_Components = 4; break;
+        default:       m_Components = 0; break;
+        }
+        m_Count = 0;
+    }
+
+    inline bool has(unsigned long row) const
+    {
+        return (row >> 5) < m_Presence.size() && (m_Presence[row >> 5] & (1u << (row & 31))) != 0;
+    }
+
+    void erase(unsigned long row)
+    {
+        if (has(row))
+        {
+            m_Presence[row >> 5] &= ~(1u << (row & 31));
+            m_Count--;
+        }
+    }
+
+    void set(unsigned long row, const std::string& value)
+    {
+        switch (m_Type)
+        {
+        case RD_STRING:
+            integer(row) = m_Dictionary->intern(value);
+            break;
+        case RD_INT:
+            {
+                IntVariable variable;
+                variable.set(value);
+                integer(row) = variable.value();
+            }
+            break;
+        case RD_BOOLEAN:
+            {
+                BooleanVariable variable;
+                variable.set(value);
+                integer(row) = variable.value() ? 1 : 0;
+            }
+            break;
+        case RD_FLOAT:
+            {
+                FloatVariable variable;
+                variable.set(value);
+                vector(row)[0] = variable.value();
+            }
+            break;
+        case RD_VEC2:
+            {
+                Vec2Variable variable;
+                variable.set(value);
+                for (unsigned int i = 0; i < 2; i++)
+                    vector(row)[i] = variable.value()[i];
+            }
+            break;
+        case RD_VEC3:
+            {
+                Vec3Variable variable;
+                variable.set(value);
+                for (unsigned int i = 0; i < 3; i++)
+                    vector(row)[i] = variable.value()[i];
+            }
+            break;
+        case RD_VEC4:
+            {
+                Vec4Variable variable;
+                variable.set(value);
+                for (unsigned int i = 0; i < 4; i++)
+                    vector(row)[i] = variable.value()[i];
+            }
+            break;
+        default:
+            return;
+        }
+
+        mark(row);
+    }
+
+    // Binary counterpart of set(row, string), the variable must match the column type.
+    void set(unsigned long row, IVariable& value)
+    {
+        if (value.type() != m_Type)
+            return;
+
+        switch (m_Type)
+        {
+        case RD_STRING:
+            integer(row) = m_Dictionary->intern(static_cast<StringVariable&>(value).value());
+            break;
+        case RD_INT:
+            integer(row) = static_cast<IntVariable&>(value).value();
+            break;
+        case RD_BOOLEAN:
+            integer(row) = static_cast<BooleanVariable&>(value).value() ? 1 : 0;
+            break;
+        case RD_FLOAT:
+            vector(row)[0] = static_cast<FloatVariable&>(value).value();
+            break;
+        case RD_VEC2:
+            for (unsigned int i = 0; i < 2; i++)
+                vector(row)[i] = static_cast<Vec2Variable&>(value).value()[i];
+            break;
+        case RD_VEC3:
+            for (unsigned int i = 0; i < 3; i++)
+                vector(row)[i] = static_cast<Vec3Variable&>(value).value()[i];
+            break;
+        case RD_VEC4:
+            for (unsigned int i = 0; i < 4; i++)
+                vector(row)[i] = static_cast<Vec4Variable&>(value).value()[i];
+            break;
+        default:
+            return;
+        }
+
+        mark(row);
+    }
+
+    // Returns a new variable holding the row value, or NULL if the row has no value.
+    IVariable* get(unsigned long row) const
+    {
+        if (!has(row))
+            return NULL;
+
+        switch (m_Type)
+        {
+        case RD_STRING:
+            {
+                StringVariable* variable = new StringVariable();
+                variable->set(m_Dictionary->get(static_cast<StringDictionary::ID>(m_Integers[row])));
+                return variable;
+            }
+        case RD_INT:
+            {
+                IntVariable* variable = new IntVariable();
+                variable->set(m_Integers[row]);
+                return variable;
+            }
+        case RD_BOOLEAN:
+            {
+                BooleanVariable* variable = new BooleanVariable();
+                variable->set(m_Integers[row] != 0);
+                return variable;
+            }
+        case RD_FLOAT:
+            {
+                FloatVariable* variable = new FloatVariable();
+                variable->set(m_Floats[row]);
+                return variable;
+            }
+        case RD_VEC2:
+            {
+                Vec2Variable* variable = new Vec2Variable();
+                variable->set(glm::vec2(m_Floats[2 * row], m_Floats[2 * row + 1]));
+                return variable;
+            }
+        case RD_VEC3:
+            {
+                Vec3Variable* variable = new Vec3Variable();
+                variable->set(glm::vec3(m_Floats[3 * row], m_Floats[3 * row + 1], m_Floats[3 * row + 2]));
+                return variable;
+            }
+        case RD_VEC4:
+            {
+                Vec4Variable* variable = new Vec4Variable();
+                variable->set(glm::vec4(m_Floats[4 * row], m_Floats[4 * row + 1], m_Floats[4 * row + 2], m_Floats[4 * row + 3]));
+                return variable;
+            }
+        default:
+            return NULL;
+        }
+    }
+
+    // ----- Raw Access -----
+
+    // NOTE : Rows without a value hold garbage, always check has() when scanning.
+    inline const float* floats() const { return m_Floats.data(); }
+    inline const long* integers() const { return m_Integers.data(); }
+    inline unsigned int components() const { return m_Components; }
+    inline unsigned long rows() const { return m_Presence.size() * 32; }
+
+    inline const std::string& name() const { return m_Name; }
+    inline VariableType type() const { return m_Type; }
+    inline unsigned long count() const { return m_Count; }
+
+private:
+    void grow(unsigned long row)
+    {
+        unsigned long rows = row + 1;
+
+        if (rows > m_Presence.size() * 32)
+            m_Presence.resize((rows + 31) / 32, 0);
+
+        if (m_Components > 0 && rows * m_Components > m_Floats.size())
+            m_Floats.resize(rows * m_Components, 0.0f);
+        else if (m_Components == 0 && rows > m_Integers.size())
+            m_Integers.resize(rows, 0);
+    }
+
+    inline long& integer(unsigned long row)
+    {
+        grow(row);
+        return m_Integers[row];
+    }
+
+    inline float* vector(unsigned long row)
+    {
+        grow(row);
+        return &m_Floats[m_Components * row];
+    }
+
+    inline void mark(unsigned long row)
+    {
+        if (!has(row))
+        {
+            m_Presence[row >> 5] |= 1u << (row & 31);
+            m_Count++;
+        }
+    }
+
+    std::string m_Name;
+    VariableType m_Type;
+    StringDictionary* m_Dictionary;
+
+    unsigned int m_Components;
+    unsigned long m_Count;
+
+    std::vector<unsigned int> m_Presence;
+    std::vector<float> m_Floats;
+    std::vector<long> m_Integers;
+};
+
+// Per-graph columnar storage for node or edge attributes.
+// An attribute name owns one column per type it was set with, and a row holds
+// a value in at most one of them so the last write wins, like Variables::set.
+class AttributeStore
+{
+public:
+    AttributeStore()
+    {
+    }
+
+    ~AttributeStore()
+    {
+        clear();
+    }
+
+    void set(unsigned long row, const std::string& name, VariableType type, const std::string& value)
+    {
+        AttributeColumn* target = column(name, type, true);
+        if (target == NULL)
+            return;
+
+        clearSiblings(row, target);
+        target->set(row, value);
+    }
+
+    void set(unsigned long row, AttributeColumn* target, IVariable& value)
+    {
+        clearSiblings(row, target);
+        target->set(row, value);
+    }
+
+    IVariable* get(unsigned long row, const std::string& name) const
+    {
+        auto it = m_Names.find(name);
+        if (it == m_Names.end())
+            return NULL;
+
+        for (auto c : it->second)
+            if (c->has(row))
+                return c->get(row);
+
+        return NULL;
+    }
+
+    AttributeColumn* column(const std::string& name, VariableType type, bool create = false)
+    {
+        auto it = m_Names.find(name);
+        if (it != m_Names.end())
+        {
+            for (auto c : it->second)
+                if (c->type() == type)
+                    return c;
+        }
+
+        if (!create)
+            return NULL;
+
+        switch (type)
+        {
+        case RD_STRING: case RD_INT: case RD_BOOLEAN: case RD_FLOAT: case RD_VEC2: case RD_VEC3: case RD_VEC4:
+            break;
+        default:
+            LOG("[GRAPH] Attribute '%s' has an unsupported type!\n", name.c_str());
+            return NULL;
+        }
+
+        AttributeColumn* c = new AttributeColumn(name, type, &m_Dictionary);
+        m_Columns.push_back(c);
+        m_Names[name].push_back(c);
+        return c;
+    }
+
+    // Clears a row in every column, called when its element is removed.
+    void erase(unsigned long row)
+    {
+        for (auto c : m_Columns)
+            c->erase(row);
+    }
+
+    void clear()
+    {
+        for (auto c : m_Columns)
+            delete c;
+        m_Columns.clear();
+        m_Names.clear();
+        m_Dictionary.clear();
+    }
+
+    inline const std::vector<AttributeColumn*>& columns() const { return m_Columns; }
+    inline StringDictionary& dictionary() { return m_Dictionary; }
+
+private:
+    void clearSiblings(unsigned long row, AttributeColumn* target)
+    {
+        auto& siblings = m_Names[target->name()];
+        if (siblings.size() == 1)
+            return;
+
+        for (auto c : siblings)
+            if (c != target)
+                c->erase(row);
+    }
+
+    std::vector<AttributeColumn*> m_Columns;
+    std::unordered_map<std::string, std::vector<AttributeColumn*> > m_Names;
+    StringDictionary m_Dictionary;
+};
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <map>
+
 #include <raindance/Core/Sequencer/Sequencer.hh>
 
 #include <graphiti/Entities/MVC.hh>
@@ -205,105 +207,272 @@ public:
 class GraphCommandFactory
 {
 public:
-    // Graph Commands
+    enum OperationType
+    {
+        SET_ATTRIBUTE,
+        ADD_NODE,
+        REMOVE_NODE,
+        SET_NODE_ATTRIBUTE,
+        ADD_EDGE,
+        REMOVE_EDGE,
+        SET_EDGE_ATTRIBUTE
+    };
+
+    // A command read from its script arguments, Name holds the label of ADD_NODE.
+    struct Operation
+    {
+        OperationType Type;
+        unsigned long ID1;
+        unsigned long ID2;
+        std::string Name;
+        std::string AttributeType;
+        std::string Value;
+    };
 
-    static GraphCommand_SetAttribute* SetAttribute(GraphEntity* graph, const Variables& variables)
+    // Creates a command from its script name (e.g. "graph:add_node"), NULL if unknown or incomplete.
+    static GraphCommand* Create(GraphEntity* graph, const std::string& name, const Variables& variables)
     {
-        IVariable* name = getVariable("name", RD_STRING, variables);
-        IVariable* type = getVariable("type", RD_STRING, variables);
-        IVariable* value = getVariable("value", RD_STRING, variables);
-        if (name == NULL || type == NULL || value == NULL)
+        Operation operation;
+        if (!Parse(name, variables, operation))
             return NULL;
 
-        return new GraphCommand_SetAttribute(graph,
-                static_cast<StringVariable*>(name)->value().c_str(),
-                static_cast<StringVariable*>(type)->value().c_str(),
-                static_cast<StringVariable*>(value)->value().c_str());
+        switch (operation.Type)
+        {
+        case SET_ATTRIBUTE:
+            return new GraphCommand_SetAttribute(graph, operation.Name.c_str(), operation.AttributeType.c_str(), operation.Value.c_str());
+        case ADD_NODE:
+            return new GraphCommand_AddNode(graph, operation.Name.c_str());
+        case REMOVE_NODE:
+            return new GraphCommand_RemoveNode(graph, operation.ID1);
+        case SET_NODE_ATTRIBUTE:
+            return new GraphCommand_SetNodeAttribute(graph, operation.ID1, operation.Name.c_str(), operation.AttributeType.c_str(), operation.Value.c_str());
+        case ADD_EDGE:
+            return new GraphCommand_AddEdge(graph, operation.ID1, operation.ID2);
+        case REMOVE_EDGE:
+            return new GraphCommand_RemoveEdge(graph, operation.ID1);
+        case SET_EDGE_ATTRIBUTE:
+            return new GraphCommand_SetEdgeAttribute(graph, operation.ID1, operation.Name.c_str(), operation.AttributeType.c_str(), operation.Value.c_str());
+        }
+        return NULL;
     }
 
-    // Node Commands
-
-    static GraphCommand_AddNode* AddNode(GraphEntity* graph, const Variables& variables)
+    // Fills an operation from a script name and its arguments, false if unknown or incomplete.
+    static bool Parse(const std::string& name, const Variables& variables, Operation& operation)
     {
-        IVariable* label = getVariable("label", RD_STRING, variables);
-        if (label == NULL)
-            return NULL;
+        operation.ID1 = operation.ID2 = 0;
 
-        return new GraphCommand_AddNode(graph, static_cast<StringVariable*>(label)->value().c_str());
+        if (name == "graph:set_attribute")
+        {
+            operation.Type = SET_ATTRIBUTE;
+            return getAttribute(variables, operation);
+        }
+        else if (name == "graph:add_node")
+        {
+            operation.Type = ADD_NODE;
+            return getString("label", variables, operation.Name);
+        }
+        else if (name == "graph:remove_node")
+        {
+            operation.Type = REMOVE_NODE;
+            return getID("id", variables, operation.ID1);
+        }
+        else if (name == "graph:set_node_attribute")
+        {
+            operation.Type = SET_NODE_ATTRIBUTE;
+            return getID("id", variables, operation.ID1) && getAttribute(variables, operation);
+        }
+        else if (name == "graph:add_edge")
+        {
+            operation.Type = ADD_EDGE;
+            return getID("src", variables, operation.ID1) && getID("dst", variables, operation.ID2);
+        }
+        else if (name == "graph:remove_edge")
+        {
+            operation.Type = REMOVE_EDGE;
+            return getID("id", variables, operation.ID1);
+        }
+        else if (name == "graph:set_edge_attribute")
+        {
+            operation.Type = SET_EDGE_ATTRIBUTE;
+            return getID("id", variables, operation.ID1) && getAttribute(variables, operation);
+        }
+
+        LOG("[COMMAND] Unknown command type '%s'!\n", name.c_str());
+        return false;
     }
 
-    static GraphCommand_RemoveNode* RemoveNode(GraphEntity* graph, const Variables& variables)
+    static IVariable* getVariable(const char* name, VariableType type, const Variables& variables)
     {
-        IVariable* id = getVariable("id", RD_INT, variables);
-        if (id == NULL)
+        IVariable* var = variables.get(name);
+        if (var == NULL || var->type() != type)
+        {
+            LOG("[COMMAND] Couldn't find required variable '%s'!\n", name);
             return NULL;
+        }
+        return var;
+    }
 
-        return new GraphCommand_RemoveNode(graph, static_cast<IntVariable*>(id)->value());
+private:
+    static bool getID(const char* name, const Variables& variables, unsigned long& id)
+    {
+        IVariable* var = getVariable(name, RD_INT, variables);
+        if (var == NULL)
+            return false;
+
+        id = static_cast<IntVariable*>(var)->value();
+        return true;
     }
 
-    static GraphCommand_SetNodeAttribute* SetNodeAttribute(GraphEntity* graph, const Variables& variables)
+    static bool getString(const char* name, const Variables& variables, std::string& value)
     {
-        IVariable* id = getVariable("id", RD_INT, variables);
-        IVariable* name = getVariable("name", RD_STRING, variables);
-        IVariable* type = getVariable("type", RD_STRING, variables);
-        IVariable* value = getVariable("value", RD_STRING, variables);
-        if (id == NULL || name == NULL || type == NULL || value == NULL)
-            return NULL;
+        IVariable* var = getVariable(name, RD_STRING, variables);
+        if (var == NULL)
+            return false;
 
-        return new GraphCommand_SetNodeAttribute(graph,
-                static_cast<IntVariable*>(id)->value(),
-                static_cast<StringVariable*>(name)->value().c_str(),
-                static_cast<StringVariable*>(type)->value().c_str(),
-                static_cast<StringVariable*>(value)->value().c_str());
+        value = static_cast<StringVariable*>(var)->value();
+        return true;
     }
 
-    // Edge Commands
+    static bool getAttribute(const Variables& variables, Operation& operation)
+    {
+        return getString("name", variables, operation.Name)
+            && getString("type", variables, operation.AttributeType)
+            && getString("value", variables, operation.Value);
+    }
+};
 
-    static GraphCommand_AddEdge* AddEdge(GraphEntity* graph, const Variables& variables)
+// All the graph commands of one timecode packed in a single sequence.
+// Operations are stored as plain structs with interned strings instead of one heap allocated command each.
+class GraphCommand_Batch : public GraphCommand
+{
+public:
+    struct Operation
     {
-        IVariable* src = getVariable("src", RD_INT, variables);
-        IVariable* dst = getVariable("dst", RD_INT, variables);
-        if (src == NULL || dst == NULL)
-            return NULL;
+        GraphCommandFactory::OperationType Type;
+        unsigned long ID1;
+        unsigned long ID2;
+        StringDictionary::ID Name;
+        StringDictionary::ID AttributeType;
+        StringDictionary::ID Value;
+    };
+
+    GraphCommand_Batch(GraphEntity* graph)
+    : GraphCommand(graph, "Batch")
+    {
+    }
 
-        return new GraphCommand_AddEdge(graph,
-                static_cast<IntVariable*>(src)->value(),
-                static_cast<IntVariable*>(dst)->value());
+    // Appends a command from its script name and arguments, read by GraphCommandFactory::Parse.
+    bool add(const std::string& name, const Variables& variables)
+    {
+        GraphCommandFactory::Operation parsed;
+        if (!GraphCommandFactory::Parse(name, variables, parsed))
+            return false;
+
+        Operation operation;
+        operation.Type = parsed.Type;
+        operation.ID1 = parsed.ID1;
+        operation.ID2 = parsed.ID2;
+        operation.Name = m_Strings.intern(parsed.Name);
+        operation.AttributeType = m_Strings.intern(parsed.AttributeType);
+        operation.Value = m_Strings.intern(parsed.Value);
+
+        m_Operations.push_back(operation);
+        return true;
     }
 
-    static GraphCommand_RemoveEdge* RemoveEdge(GraphEntity* graph, const Variables& variables)
+    virtual Sequence::SequenceStatus play(Timecode timecode)
     {
-        IVariable* id = getVariable("id", RD_INT, variables);
-        if (id == NULL)
-            return NULL;
+        (void) timecode;
 
-        return new GraphCommand_RemoveEdge(graph, static_cast<IntVariable*>(id)->value());
+        for (auto& op : m_Operations)
+        {
+            switch (op.Type)
+            {
+            case GraphCommandFactory::SET_ATTRIBUTE:
+                m_Graph->setAttribute(string(op.Name), string(op.AttributeType), string(op.Value));
+                break;
+            case GraphCommandFactory::ADD_NODE:
+                m_Graph->addNode(string(op.Name));
+                break;
+            case GraphCommandFactory::REMOVE_NODE:
+                m_Graph->removeNode(op.ID1);
+                break;
+            case GraphCommandFactory::SET_NODE_ATTRIBUTE:
+                m_Graph->setNodeAttribute(op.ID1, string(op.Name), string(op.AttributeType), string(op.Value));
+                break;
+            case GraphCommandFactory::ADD_EDGE:
+                m_Graph->addEdge(op.ID1, op.ID2);
+                break;
+            case GraphCommandFactory::REMOVE_EDGE:
+                m_Graph->removeEdge(op.ID1);
+                break;
+            case GraphCommandFactory::SET_EDGE_ATTRIBUTE:
+                m_Graph->setEdgeAttribute(op.ID1, string(op.Name), string(op.AttributeType), string(op.Value));
+                break;
+            }
+        }
+
+        LOG("[COMMAND] Batch { Input : (%lu operations) }\n", m_Operations.size());
+        return KILL;
     }
 
-    static GraphCommand_SetEdgeAttribute* SetEdgeAttribute(GraphEntity* graph, const Variables& variables)
+    inline unsigned long size() const { return m_Operations.size(); }
+
+private:
+    inline const char* string(StringDictionary::ID id) const { return m_Strings.get(id).c_str(); }
+
+    std::vector<Operation> m_Operations;
+    StringDictionary m_Strings;
+};
+
+// Groups commands by timecode so the sequencer gets one batch per timecode instead of one sequence per command.
+class GraphCommandBatcher
+{
+public:
+    GraphCommandBatcher(GraphEntity* graph)
+    : m_Graph(graph)
     {
-        IVariable* id = getVariable("id", RD_INT, variables);
-        IVariable* name = getVariable("name", RD_STRING, variables);
-        IVariable* type = getVariable("type", RD_STRING, variables);
-        IVariable* value = getVariable("value", RD_STRING, variables);
-        if (id == NULL || name == NULL || type == NULL || value == NULL)
-            return NULL;
+    }
 
-        return new GraphCommand_SetEdgeAttribute(graph,
-                static_cast<IntVariable*>(id)->value(),
-                static_cast<StringVariable*>(name)->value().c_str(),
-                static_cast<StringVariable*>(type)->value().c_str(),
-                static_cast<StringVariable*>(value)->value().c_str());
+    ~GraphCommandBatcher()
+    {
+        for (auto& batch : m_Batches)
+            delete batch.second;
     }
 
-    static IVariable* getVariable(const char* name, VariableType type, const Variables& variables)
+    bool add(Timecode timecode, const std::string& name, const Variables& variables)
     {
-        IVariable* var = variables.get(name);
-        if (var == NULL || var->type() != type)
+        GraphCommand_Batch*& batch = m_Batches[timecode];
+        if (batch == NULL)
+            batch = new GraphCommand_Batch(m_Graph);
+        return batch->add(name, variables);
+    }
+
+    // Hands the batches over to the "command" track and notifies the sequencer once, returns the batch IDs.
+    std::vector<Sequence::ID> submit()
+    {
+        std::vector<Sequence::ID> ids;
+
+        for (auto& batch : m_Batches)
         {
-            LOG("[COMMAND] Couldn't find required variable '%s'!\n", name);
-            return NULL;
+            if (batch.second->size() == 0)
+            {
+                delete batch.second;
+                continue;
+            }
+
+            m_Graph->context()->sequencer().track("command")->insert(batch.second, Track::Event::ONCE, batch.first);
+            ids.push_back(batch.second->id());
         }
-        return var;
+        m_Batches.clear();
+
+        if (!ids.empty())
+            m_Graph->context()->messages().push(new SequencerMessage("command", "update"));
+
+        return ids;
     }
+
+private:
+    GraphEntity* m_Graph;
+    std::map<Timecode, GraphCommand_Batch*> m_Batches;
 };
@@ -1,23 +1,47 @@
 #pragma once
 
+#include <memory>
+
 #include <graphiti/Entities/Graph/GraphModel.hh>
 
 class GraphContext : public EntityContext
 {
 };
 
+// Pre-resolved attribute handle, so hot paths can set values without
+// parsing names, types or values for every element.
+struct GraphAttribute
+{
+    typedef unsigned long ID;
+
+    std::string Name; // Name as seen by listeners, without the view namespace
+    VariableType Type;
+    AttributeColumn* Column; // NULL for view attributes, which are not stored in the model
+};
+
 class GraphListener : public EntityListener
 {
 public:
     virtual void onAddNode(Node::ID uid, const char* label)
     { (void) uid; (void) label; }
 
+    // NOTE : Batch notifications, override them to amortize per-element work.
+    virtual void onAddNodes(const std::vector<Node::ID>& uids, const std::vector<std::string>& labels)
+    {
+        for (unsigned long i = 0; i < uids.size(); i++)
+            onAddNode(uids[i], labels[i].c_str());
+    }
+
     virtual void onRemoveNode(Node::ID uid)
     { (void) uid; }
 
     virtual void onSetNodeAttribute(Node::ID uid, const std::string& name, VariableType type, const std::string& value)
     { (void) uid; (void) name; (void) type; (void) value; }
 
+    // NOTE : Binary counterpart of onSetNodeAttribute, override it to skip string parsing.
+    virtual void onSetNodeAttributeValue(Node::ID uid, const std::string& name, IVariable& value)
+    { onSetNodeAttribute(uid, name, value.type(), formatVariable(value)); }
+
     virtual void onSetNodeLabel(Node::ID uid, const char* label)
     { (void) uid; (void) label; }
 
@@ -27,12 +51,28 @@ public:
     virtual void onAddEdge(Edge::ID uid, Node::ID uid1, Node::ID uid2)
     { (void) uid; (void) uid1; (void) uid2; }
 
+    virtual void onAddEdges(const std::vector<Edge::ID>& uids, const std::vector<Node::ID>& uid1s, const std::vector<Node::ID>& uid2s)
+    {
+        for (unsigned long i = 0; i < uids.size(); i++)
+            onAddEdge(uids[i], uid1s[i], uid2s[i]);
+    }
+
     virtual void onRemoveEdge(Edge::ID uid)
     { (void) uid; }
 
+    virtual void onRemoveEdges(const std::vector<Edge::ID>& uids)
+    {
+        for (auto uid : uids)
+            onRemoveEdge(uid);
+    }
+
     virtual void onSetEdgeAttribute(Edge::ID uid, const std::string& name, VariableType type, const std::string& value)
     { (void) uid; (void) name; (void) type; (void) value; }
 
+    // NOTE : Binary counterpart of onSetEdgeAttribute, see onSetNodeAttributeValue.
+    virtual void onSetEdgeAttributeValue(Edge::ID uid, const std::string& name, IVariable& value)
+    { onSetEdgeAttribute(uid, name, value.type(), formatVariable(value)); }
+
     virtual void onAddNeighbor(const std::pair<Node::ID, Edge::ID>& element, const char* label, Node::ID neighbor)
     { (void) element; (void) label; (void) neighbor; }
 
@@ -46,6 +86,23 @@ public:
     virtual IVariable* getNodeAttribute(Node::ID id, std::string& name) = 0;
 
     virtual IVariable* getEdgeAttribute(Edge::ID id, std::string& name) = 0;
+
+    // Fills a contiguous per-node array in model order (the order of GraphEntity::getNodeIDs).
+    // Returns the number of components per node, or 0 if the view doesn't export this attribute.
+    virtual unsigned int exportNodeArray(const std::string& name, std::vector<float>& array)
+    { (void) name; (void) array; return 0; }
+
+    // Writes back an array previously filled by exportNodeArray.
+    virtual void commitNodeArray(const std::string& name, const std::vector<float>& array)
+    { (void) name; (void) array; }
+};
+
+// Float array shared with scripts, see GraphEntity::exportNodeArray.
+// NOTE : Scripts keep a reference on the storage, so it outlives the graph and its next resize
+struct NodeArray
+{
+    std::shared_ptr<std::vector<float>> Data;
+    unsigned int Components;
 };
 
 class GraphController : public EntityController, public GraphListener
@@ -91,8 +148,37 @@ public:
         return id;
     }
 
+    std::vector<Node::ID> addNodes(const std::vector<std::string>& labels)
+    {
+        std::vector<Node::ID> ids;
+        ids.reserve(labels.size());
+
+        m_GraphModel->reserveNodes(labels.size());
+
+        Node::Data data;
+        for (auto& label : labels)
+        {
+            data.Label = label;
+            ids.push_back(m_GraphModel->addNode(data));
+        }
+
+        for (auto l : listeners())
+            static_cast<GraphListener*>(l)->onAddNodes(ids, labels);
+
+        return ids;
+    }
+
     void removeNode(Node::ID id)
     {
+        if (m_GraphModel->node(id) == NULL)
+        {
+            LOG("[GRAPH] Node %lu doesn't exist!\n", id);
+            return;
+        }
+
+        // NOTE : Incident edges go first so every listener sees them removed before the node
+        removeEdges(m_GraphModel->incidentEdges(id));
+
         m_GraphModel->removeNode(id);
 
         for (auto l : listeners())
@@ -171,13 +257,49 @@ public:
         }
         else
         {
-            m_GraphModel->node(id)->attributes().set(sname, vtype, svalue);
+            m_GraphModel->setNodeAttribute(id, sname, vtype, svalue);
         }
 
         for (auto l : listeners())
             static_cast<GraphListener*>(l)->onSetNodeAttribute(id, sname, vtype, svalue);
     }
 
+    // Returns a handle for the typed setters, or 0 if the type is unknown.
+    GraphAttribute::ID registerNodeAttribute(const char* name, const char* type)
+    {
+        return registerAttribute(name, type, m_GraphModel->nodeAttributes(), m_RegisteredNodeAttributes, m_NodeAttributeHandles);
+    }
+
+    void setNodeAttribute(Node::ID id, GraphAttribute::ID handle, IVariable& value)
+    {
+        const GraphAttribute* attribute = registeredAttribute(m_RegisteredNodeAttributes, handle);
+        if (attribute == NULL)
+            return;
+
+        if (value.type() != attribute->Type)
+        {
+            LOG("[GRAPH] Attribute '%s' type mismatch!\n", attribute->Name.c_str());
+            return;
+        }
+
+        setNodeAttributeValue(id, *attribute, value);
+    }
+
+    // Numeric batch, values hold one to four components per node depending on the attribute type.
+    void setNodeAttributes(const std::vector<Node::ID>& ids, GraphAttribute::ID handle, const std::vector<double>& values)
+    {
+        const GraphAttribute* attribute = registeredAttribute(m_RegisteredNodeAttributes, handle);
+        if (attribute != NULL)
+            numericValues(*attribute, ids, values, [&](Node::ID id, IVariable& value) { setNodeAttributeValue(id, *attribute, value); });
+    }
+
+    void setNodeAttributes(const std::vector<Node::ID>& ids, GraphAttribute::ID handle, const std::vector<std::string>& values)
+    {
+        const GraphAttribute* attribute = registeredAttribute(m_RegisteredNodeAttributes, handle);
+        if (attribute != NULL)
+            stringValues(*attribute, ids, values, [&](Node::ID id, IVariable& value) { setNodeAttributeValue(id, *attribute, value); });
+    }
+
     IVariable* getNodeAttribute(Node::ID id, const char* name)
     {
         std::string sname(name);
@@ -202,16 +324,116 @@ public:
         }
         else
         {
-            IVariable* attribute = m_GraphModel->node(id)->attributes().get(sname);
-            if (attribute)
-                return attribute->duplicate();
+            return m_GraphModel->getNodeAttribute(id, sname);
+        }
+    }
+
+    // Refreshes and returns the array of a view node attribute (e.g. "og:space:position"), NULL if no view exports it.
+    // NOTE : The storage stays valid until the node count changes, so scripts can map it without copying.
+    NodeArray* exportNodeArray(const char* name)
+    {
+        GraphView* view;
+        std::string attribute;
+        if (!findNodeArrayView(name, &view, &attribute))
+            return NULL;
+
+        NodeArray& array = m_NodeArrays[std::string(name)];
+        if (!array.Data)
+            array.Data = std::make_shared<std::vector<float>>();
+
+        // NOTE : Storage held by scripts is refreshed in place when its size still fits and replaced otherwise,
+        // it is never resized under a script.
+        if (array.Data.unique())
+            array.Components = view->exportNodeArray(attribute, *array.Data);
+        else
+        {
+            std::shared_ptr<std::vector<float>> fresh = std::make_shared<std::vector<float>>();
+            array.Components = view->exportNodeArray(attribute, *fresh);
+            if (fresh->size() == array.Data->size())
+                std::copy(fresh->begin(), fresh->end(), array.Data->begin());
             else
-                return NULL;
+                array.Data = fresh;
+        }
+
+        if (array.Components == 0)
+        {
+            m_NodeArrays.erase(std::string(name));
+            return NULL;
+        }
+        return &array;
+    }
+
+    // Pushes the array exported under this name back to its view, the other exported arrays are left alone.
+    void commitNodeArray(const char* name)
+    {
+        auto it = m_NodeArrays.find(std::string(name));
+        if (it == m_NodeArrays.end())
+        {
+            LOG("[GRAPH] Node array '%s' wasn't exported, nothing to commit!\n", name);
+            return;
         }
+
+        writeNodeArray(name, *it->second.Data);
+    }
+
+    // Copies a view node attribute array into a caller owned one, without sharing it with scripts.
+    // Returns the number of components per node, or 0 if no view exports it.
+    unsigned int readNodeArray(const char* name, std::vector<float>& array)
+    {
+        GraphView* view;
+        std::string attribute;
+        if (!findNodeArrayView(name, &view, &attribute))
+            return 0;
+
+        return view->exportNodeArray(attribute, array);
+    }
+
+    // Writes a whole view node attribute array, in model order.
+    void writeNodeArray(const char* name, const std::vector<float>& array)
+    {
+        GraphView* view;
+        std::string attribute;
+        if (findNodeArrayView(name, &view, &attribute))
+            view->commitNodeArray(attribute, array);
     }
 
     // ---- Edges -----
 
+    std::vector<Edge::ID> addEdges(const std::vector<Node::ID>& uid1s, const std::vector<Node::ID>& uid2s)
+    {
+        std::vector<Edge::ID> uids;
+
+        if (uid1s.size() != uid2s.size())
+        {
+            LOG("[GRAPH] Edge endpoint arrays differ in size!\n");
+            return uids;
+        }
+
+        // NOTE : The whole batch is rejected before any edge is added, listeners never see a partial batch
+        for (unsigned long i = 0; i < uid1s.size(); i++)
+            if (m_GraphModel->node(uid1s[i]) == NULL || m_GraphModel->node(uid2s[i]) == NULL)
+            {
+                LOG("[GRAPH] Edge %lu has an unknown endpoint (%lu, %lu)!\n", i, uid1s[i], uid2s[i]);
+                return uids;
+            }
+
+        uids.reserve(uid1s.size());
+        m_GraphModel->reserveEdges(uid1s.size());
+
+        Edge::Data data;
+        for (unsigned long i = 0; i < uid1s.size(); i++)
+        {
+            data.Node1 = uid1s[i];
+            data.Node2 = uid2s[i];
+            uids.push_back(m_GraphModel->addEdge(data));
+        }
+
+        for (auto l : listeners())
+            static_cast<GraphListener*>(l)->onAddEdges(uids, uid1s, uid2s);
+
+        return uids;
+    }
+
     Edge::ID addEdge(Node::ID uid1, Node::ID uid2)
     {
         Edge::ID uid;
@@ -220,6 +442,11 @@ public:
         data.Node2 = uid2;
 
         uid = m_GraphModel->addEdge(data);
+        if (uid == SlotMap<Edge>::Invalid)
+        {
+            LOG("[GRAPH] Edge has an unknown endpoint (%lu, %lu)!\n", uid1, uid2);
+            return uid;
+        }
 
         for (auto l : listeners())
             static_cast<GraphListener*>(l)->onAddEdge(uid, uid1, uid2);
@@ -229,12 +456,43 @@ public:
 
     void removeEdge(Edge::ID id)
     {
+        if (m_GraphModel->edge(id) == NULL)
+        {
+            LOG("[GRAPH] Edge %lu doesn't exist!\n", id);
+            return;
+        }
+
         m_GraphModel->removeEdge(id);
 
         for (auto l : listeners())
             static_cast<GraphListener*>(l)->onRemoveEdge(id);
     }
 
+    // Removes several edges, listeners are notified once for the whole batch.
+    void removeEdges(const std::vector<Edge::ID>& ids)
+    {
+        std::vector<Edge::ID> removed;
+        removed.reserve(ids.size());
+
+        for (auto id : ids)
+        {
+            if (m_GraphModel->edge(id) == NULL)
+            {
+                LOG("[GRAPH] Edge %lu doesn't exist!\n", id);
+                continue;
+            }
+
+            m_GraphModel->removeEdge(id);
+            removed.push_back(id);
+        }
+
+        if (removed.empty())
+            return;
+
+        for (auto l : listeners())
+            static_cast<GraphListener*>(l)->onRemoveEdges(removed);
+    }
+
     unsigned long countEdges() { return m_GraphModel->countEdges(); }
 
     Edge::ID getEdgeID(unsigned int i) { return m_GraphModel->edge(i)->id(); }
@@ -291,13 +549,49 @@ public:
         }
         else
         {
-            m_GraphModel->edge(id)->attributes().set(sname, vtype, svalue);
+            m_GraphModel->setEdgeAttribute(id, sname, vtype, svalue);
         }
 
         for (auto l : listeners())
             static_cast<GraphListener*>(l)->onSetEdgeAttribute(id, sname, vtype, svalue);
     }
 
+    // Returns a handle for the typed edge setters, or 0 if the type is unknown.
+    GraphAttribute::ID registerEdgeAttribute(const char* name, const char* type)
+    {
+        return registerAttribute(name, type, m_GraphModel->edgeAttributes(), m_RegisteredEdgeAttributes, m_EdgeAttributeHandles);
+    }
+
+    void setEdgeAttribute(Edge::ID id, GraphAttribute::ID handle, IVariable& value)
+    {
+        const GraphAttribute* attribute = registeredAttribute(m_RegisteredEdgeAttributes, handle);
+        if (attribute == NULL)
+            return;
+
+        if (value.type() != attribute->Type)
+        {
+            LOG("[GRAPH] Attribute '%s' type mismatch!\n", attribute->Name.c_str());
+            return;
+        }
+
+        setEdgeAttributeValue(id, *attribute, value);
+    }
+
+    // Numeric batch, see setNodeAttributes.
+    void setEdgeAttributes(const std::vector<Edge::ID>& ids, GraphAttribute::ID handle, const std::vector<double>& values)
+    {
+        const GraphAttribute* attribute = registeredAttribute(m_RegisteredEdgeAttributes, handle);
+        if (attribute != NULL)
+            numericValues(*attribute, ids, values, [&](Edge::ID id, IVariable& value) { setEdgeAttributeValue(id, *attribute, value); });
+    }
+
+    void setEdgeAttributes(const std::vector<Edge::ID>& ids, GraphAttribute::ID handle, const std::vector<std::string>& values)
+    {
+        const GraphAttribute* attribute = registeredAttribute(m_RegisteredEdgeAttributes, handle);
+        if (attribute != NULL)
+            stringValues(*attribute, ids, values, [&](Edge::ID id, IVariable& value) { setEdgeAttributeValue(id, *attribute, value); });
+    }
+
     IVariable* getEdgeAttribute(Edge::ID id, const char* name)
     {
         std::string sname(name);
@@ -322,11 +616,7 @@ public:
         }
         else
         {
-            IVariable* attribute = m_GraphModel->edge(id)->attributes().get(sname);
-            if (attribute)
-                return attribute->duplicate();
-            else
-                return NULL;
+            return m_GraphModel->getEdgeAttribute(id, sname);
         }
     }
 
@@ -375,6 +665,184 @@ public:
     inline GraphModel* model() { return m_GraphModel; }
     inline EntityContext* context() { return m_GraphContext; }
 private:
+    bool findNodeArrayView(const std::string& name, GraphView** view, std::string* attribute)
+    {
+        unsigned long pos1 = name.find(":");
+        std::string category = name.substr(0, pos1);
+        if (pos1 == std::string::npos || (category != "raindance" && category != "graphiti" && category != "og"))
+            return false;
+
+        std::string rest = name.substr(pos1 + 1);
+        unsigned long pos2 = rest.find(":");
+        std::string vname = rest.substr(0, pos2);
+
+        for (auto v : views())
+        {
+            if (vname == std::string(v->name()))
+            {
+                *view = static_cast<GraphView*>(v);
+                *attribute = rest.substr(pos2 + 1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Handles start at 1, 0 is the invalid handle returned by registerAttribute.
+    GraphAttribute::ID registerAttribute(const char* name, const char* type, AttributeStore& store,
+                                         std::vector<GraphAttribute>& registered, std::unordered_map<std::string, GraphAttribute::ID>& handles)
+    {
+        std::string sname(name);
+        std::string stype(type);
+
+        auto it = handles.find(sname + "/" + stype);
+        if (it != handles.end())
+            return it->second;
+
+        GraphAttribute attribute;
+
+        if (stype == "float")
+            attribute.Type = RD_FLOAT;
+        else if (stype == "string")
+            attribute.Type = RD_STRING;
+        else if (stype == "int")
+            attribute.Type = RD_INT;
+        else if (stype == "bool")
+            attribute.Type = RD_BOOLEAN;
+        else if (stype == "vec2")
+            attribute.Type = RD_VEC2;
+        else if (stype == "vec3")
+            attribute.Type = RD_VEC3;
+        else if (stype == "vec4")
+            attribute.Type = RD_VEC4;
+        else
+        {
+            std::cout << "Unknown attribute type \"" << stype << "\" !" << std::endl;
+            return 0;
+        }
+
+        unsigned long pos = sname.find(":");
+        std::string category = sname.substr (0, pos);
+
+        // TODO : Remove 'raindance' attribute namespace whenever possible.
+        if (category == "raindance" || category == "graphiti" || category == "og")
+        {
+            attribute.Name = sname.substr(pos + 1);
+            attribute.Column = NULL;
+        }
+        else
+        {
+            attribute.Name = sname;
+            attribute.Column = store.column(sname, attribute.Type, true);
+        }
+
+        registered.push_back(attribute);
+
+        GraphAttribute::ID handle = registered.size();
+        handles[sname + "/" + stype] = handle;
+        return handle;
+    }
+
+    const GraphAttribute* registeredAttribute(const std::vector<GraphAttribute>& registered, GraphAttribute::ID handle)
+    {
+        if (handle == 0 || handle > registered.size())
+        {
+            LOG("[GRAPH] Invalid attribute handle %lu!\n", handle);
+            return NULL;
+        }
+        return &registered[handle - 1];
+    }
+
+    // Hands set(id, variable) one typed value per element, values hold one to four components per element.
+    template <typename ID, typename F>
+    static void numericValues(const GraphAttribute& attribute, const std::vector<ID>& ids, const std::vector<double>& values, F set)
+    {
+        unsigned int components;
+        switch (attribute.Type)
+        {
+        case RD_INT: case RD_BOOLEAN: case RD_FLOAT: components = 1; break;
+        case RD_VEC2: components = 2; break;
+        case RD_VEC3: components = 3; break;
+        case RD_VEC4: components = 4; break;
+        default:
+            LOG("[GRAPH] Attribute '%s' is not numeric!\n", attribute.Name.c_str());
+            return;
+        }
+
+        if (values.size() != ids.size() * components)
+        {
+            LOG("[GRAPH] Expected %lu values for attribute '%s', got %lu!\n", ids.size() * components, attribute.Name.c_str(), values.size());
+            return;
+        }
+
+        IntVariable vint;
+        BooleanVariable vbool;
+        FloatVariable vfloat;
+        Vec2Variable vvec2;
+        Vec3Variable vvec3;
+        Vec4Variable vvec4;
+
+        for (unsigned long i = 0; i < ids.size(); i++)
+        {
+            const double* v = &values[i * components];
+            IVariable* variable = NULL;
+
+            switch (attribute.Type)
+            {
+            case RD_INT:     vint.set(static_cast<int>(v[0])); variable = &vint; break;
+            case RD_BOOLEAN: vbool.set(v[0] != 0.0); variable = &vbool; break;
+            case RD_FLOAT:   vfloat.set(static_cast<float>(v[0])); variable = &vfloat; break;
+            case RD_VEC2:    vvec2.set(glm::vec2(v[0], v[1])); variable = &vvec2; break;
+            case RD_VEC3:    vvec3.set(glm::vec3(v[0], v[1], v[2])); variable = &vvec3; break;
+            default:         vvec4.set(glm::vec4(v[0], v[1], v[2], v[3])); variable = &vvec4; break;
+            }
+
+            set(ids[i], *variable);
+        }
+    }
+
+    template <typename ID, typename F>
+    static void stringValues(const GraphAttribute& attribute, const std::vector<ID>& ids, const std::vector<std::string>& values, F set)
+    {
+        if (attribute.Type != RD_STRING || values.size() != ids.size())
+        {
+            LOG("[GRAPH] Invalid string values for attribute '%s'!\n", attribute.Name.c_str());
+            return;
+        }
+
+        StringVariable variable;
+        for (unsigned long i = 0; i < ids.size(); i++)
+        {
+            variable.set(values[i]);
+            set(ids[i], variable);
+        }
+    }
+
+    inline void setNodeAttributeValue(Node::ID id, const GraphAttribute& attribute, IVariable& value)
+    {
+        if (attribute.Column != NULL)
+            m_GraphModel->setNodeAttribute(id, attribute.Column, value);
+
+        for (auto l : listeners())
+            static_cast<GraphListener*>(l)->onSetNodeAttributeValue(id, attribute.Name, value);
+    }
+
+    inline void setEdgeAttributeValue(Edge::ID id, const GraphAttribute& attribute, IVariable& value)
+    {
+        if (attribute.Column != NULL)
+            m_GraphModel->setEdgeAttribute(id, attribute.Column, value);
+
+        for (auto l : listeners())
+            static_cast<GraphListener*>(l)->onSetEdgeAttributeValue(id, attribute.Name, value);
+    }
+
     GraphContext* m_GraphContext;
     GraphModel* m_GraphModel;
+
+    std::vector<GraphAttribute> m_RegisteredNodeAttributes;
+    std::unordered_map<std::string, GraphAttribute::ID> m_NodeAttributeHandles;
+    std::vector<GraphAttribute> m_RegisteredEdgeAttributes;
+    std::unordered_map<std::string, GraphAttribute::ID> m_EdgeAttributeHandles;
+
+    std::unordered_map<std::string, NodeArray> m_NodeArrays;
 };
@@ -0,0 +1,771 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+# include <sys/resource.h>
+#endif
+
+#include <raindance/Core/Clock.hh>
+
+#include <graphiti/Entities/MVC.hh>
+#include <graphiti/Entities/Graph/GraphCommands.hh>
+#include <graphiti/Entities/Graph/JSONReader.hh>
+
+// Loads the JSON graph format of Scripts/standard.py (meta, attributes, nodes, edges, timeline)
+// without holding the document in memory, nodes and edges go through the GraphEntity batch calls.
+// NOTE : Like the Python loader, nodes must come before the edges and the timeline referencing them.
+class GraphJSONLoader
+{
+public:
+    GraphJSONLoader(GraphEntity* graph)
+    : m_Graph(graph), m_Batcher(graph)
+    {
+        m_NodeCount = 0;
+        m_EdgeCount = 0;
+        m_EventCount = 0;
+    }
+
+    bool load(const char* path)
+    {
+        LOG("[JSON] Loading '%s' ...\n", path);
+
+        if (!m_Reader.open(path))
+        {
+            LOG("[JSON] Couldn't open '%s'!\n", path);
+            return false;
+        }
+
+        Clock clock;
+        Timecode start = clock.milliseconds();
+
+        bool ok = m_Reader.next() == JSONReader::OBJECT_BEGIN;
+
+        JSONReader::Token token;
+        while (ok && (token = m_Reader.next()) == JSONReader::KEY)
+        {
+            std::string section = m_Reader.text();
+            JSONReader::Token first = m_Reader.next();
+
+            if (section == "meta" && first == JSONReader::OBJECT_BEGIN)
+                ok = readMeta();
+            else if (section == "attributes" && first == JSONReader::OBJECT_BEGIN)
+                ok = readAttributes();
+            else if (section == "nodes" && first == JSONReader::ARRAY_BEGIN)
+                ok = readNodes();
+            else if (section == "edges" && first == JSONReader::ARRAY_BEGIN)
+                ok = readEdges();
+            else if (section == "timeline" && first == JSONReader::ARRAY_BEGIN)
+                ok = readTimeline();
+            else
+                ok = m_Reader.skip(first);
+        }
+
+        m_Reader.close();
+
+        if (!ok)
+        {
+            LOG("[JSON] Parse error around byte %llu!\n", m_Reader.offset());
+            return false;
+        }
+
+        float seconds = (clock.milliseconds() - start) / 1000.0f;
+        LOG("[JSON] %lu nodes, %lu edges, %lu events in %.2fs (%.0f nodes/s)\n",
+            m_NodeCount, m_EdgeCount, m_EventCount, seconds, seconds > 0 ? m_NodeCount / seconds : 0.0f);
+
+#ifndef _WIN32
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0)
+            LOG("[JSON] Peak RSS : %ld MB\n", usage.ru_maxrss / 1024);
+#endif
+        return true;
+    }
+
+private:
+    static const unsigned long BatchSize = 1 << 16;
+
+    // Values of one attribute (name and type) for the nodes or edges of the pending batch
+    struct AttributeBatch
+    {
+        std::string Name;
+        std::string Type;
+        std::vector<unsigned long> Rows;
+        std::vector<double> Numbers;
+        std::vector<std::string> Strings;
+    };
+
+    typedef std::unordered_map<std::string, AttributeBatch> AttributeBatches;
+
+    static void append(AttributeBatches& batches, const std::string& name, const JSONAttribute& attribute, unsigned long row)
+    {
+        AttributeBatch& batch = batches[name + "/" + attribute.Type];
+        if (batch.Name.empty())
+        {
+            batch.Name = name;
+            batch.Type = attribute.Type;
+        }
+
+        batch.Rows.push_back(row);
+        if (attribute.Type == "string")
+            batch.Strings.push_back(attribute.Text);
+        else
+            batch.Numbers.insert(batch.Numbers.end(), attribute.Numbers, attribute.Numbers + attribute.Count);
+    }
+
+    // Sets the pending batches on the elements just added, ids[row] being the element of each row
+    void flushAttributes(AttributeBatches& batches, const std::vector<unsigned long>& ids, bool nodes)
+    {
+        std::vector<unsigned long> batchIDs;
+        for (auto& it : batches)
+        {
+            AttributeBatch& batch = it.second;
+            if (batch.Rows.empty())
+                continue;
+
+            batchIDs.resize(batch.Rows.size());
+            for (unsigned long i = 0; i < batch.Rows.size(); i++)
+                batchIDs[i] = ids[batch.Rows[i]];
+
+            if (nodes)
+            {
+                GraphAttribute::ID handle = m_Graph->registerNodeAttribute(batch.Name.c_str(), batch.Type.c_str());
+                if (batch.Type == "string")
+                    m_Graph->setNodeAttributes(batchIDs, handle, batch.Strings);
+                else
+                    m_Graph->setNodeAttributes(batchIDs, handle, batch.Numbers);
+            }
+            else
+            {
+                GraphAttribute::ID handle = m_Graph->registerEdgeAttribute(batch.Name.c_str(), batch.Type.c_str());
+                if (batch.Type == "string")
+                    m_Graph->setEdgeAttributes(batchIDs, handle, batch.Strings);
+                else
+                    m_Graph->setEdgeAttributes(batchIDs, handle, batch.Numbers);
+            }
+
+            batch.Rows.clear();
+            batch.Numbers.clear();
+            batch.Strings.clear();
+        }
+    }
+
+    static bool isReserved(const std::string& key)
+    {
+        // NOTE : 'source' and 'target' are the alternate edge endpoint keys
+        return key == "id" || key == "label" || key == "src" || key == "dst" || key == "source" || key == "target";
+    }
+
+    bool readMeta()
+    {
+        JSONReader::Token token;
+        while ((token = m_Reader.next()) == JSONReader::KEY)
+        {
+            std::string key = m_Reader.text();
+            JSONReader::Token first = m_Reader.next();
+
+            // TODO : Find a more generic way of doing this
+            if (key == "title" && first == JSONReader::STRING)
+                m_Graph->setAttribute("raindance:space:title", "string", m_Reader.text());
+            else if (!m_Reader.skip(first))
+                return false;
+        }
+        return token == JSONReader::OBJECT_END;
+    }
+
+    bool readAttributes()
+    {
+        JSONAttribute attribute;
+
+        JSONReader::Token token;
+        while ((token = m_Reader.next()) == JSONReader::KEY)
+        {
+            std::string key = m_Reader.text();
+            JSONReader::Token first = m_Reader.next();
+
+            if (isReserved(key))
+                m_Reader.skip(first);
+            else if (attribute.read(m_Reader, first))
+                m_Graph->setAttribute(key, attribute.Type, attribute.Text);
+            else
+                LOG("[JSON] Couldn't parse graph attribute '%s'!\n", key.c_str());
+        }
+        return token == JSONReader::OBJECT_END;
+    }
+
+    bool readNodes()
+    {
+        JSONReader::Token token;
+        while ((token = m_Reader.next()) == JSONReader::OBJECT_BEGIN)
+        {
+            if (!readNode())
+                return false;
+            if (m_NodeLabels.size() == BatchSize)
+                flushNodes();
+        }
+        flushNodes();
+        return token == JSONReader::ARRAY_END;
+    }
+
+    bool readNode()
+    {
+        JSONAttribute attribute;
+        std::string label;
+        std::string key;
+
+        JSONReader::Token token;
+        while ((token = m_Reader.next()) == JSONReader::KEY)
+        {
+            std::string name = m_Reader.text();
+            JSONReader::Token first = m_Reader.next();
+
+            if (name == "id" && (first == JSONReader::STRING || first == JSONReader::NUMBER))
+                key = m_Reader.text();
+            else if (name == "label" && first == JSONReader::STRING)
+                label = m_Reader.text();
+            else if (isReserved(name))
+                m_Reader.skip(first);
+            else if (attribute.read(m_Reader, first))
+                append(m_NodeAttributes, name, attribute, m_NodeLabels.size());
+            else
+                LOG("[JSON] Couldn't parse node attribute '%s'!\n", name.c_str());
+        }
+
+        m_NodeLabels.push_back(label);
+        m_NodeKeys.push_back(key);
+        return token == JSONReader::OBJECT_END;
+    }
+
+    void flushNodes()
+    {
+        if (m_NodeLabels.empty())
+            return;
+
+        std::vector<Node::ID> ids = m_Graph->addNodes(m_NodeLabels);
+
+        for (unsigned long i = 0; i < ids.size(); i++)
+            m_Nodes[m_NodeKeys[i]] = ids[i];
+
+        flushAttributes(m_NodeAttributes, ids, true);
+
+        m_NodeCount += ids.size();
+        m_NodeLabels.clear();
+        m_NodeKeys.clear();
+    }
+
+    bool readEdges()
+    {
+        JSONReader::Token token;
+        while ((token = m_Reader.next()) == JSONReader::OBJECT_BEGIN)
+        {
+            if (!readEdge())
+                return false;
+            if (m_EdgeSources.size() == BatchSize)
+                flushEdges();
+        }
+        flushEdges();
+        return token == JSONReader::ARRAY_END;
+    }
+
+    bool readEdge()
+    {
+        JSONAttribute attribute;
+        std::string key;
+        std::string source;
+        std::string target;
+        std::vector<std::pair<std::string, JSONAttribute>> attributes;
+
+        JSONReader::Token token;
+        while ((token = m_Reader.next()) == JSONReader::KEY)
+        {
+            std::string name = m_Reader.text();
+            JSONReader::Token first = m_Reader.next();
+            bool scalar = first == JSONReader::STRING || first == JSONReader::NUMBER;
+
+            if (name == "id" && scalar)
+                key = m_Reader.text();
+            else if ((name == "src" || name == "source") && scalar)
+                source = m_Reader.text();
+            else if ((name == "dst" || name == "target") && scalar)
+                target = m_Reader.text();
+            else if (isReserved(name))
+                m_Reader.skip(first);
+            else if (attribute.read(m_Reader, first))
+                attributes.push_back(std::make_pair(name, attribute));
+            else
+                LOG("[JSON] Couldn't parse edge attribute '%s'!\n", name.c_str());
+        }
+
+        auto it1 = m_Nodes.find(source);
+        auto it2 = m_Nodes.find(target);
+        if (it1 == m_Nodes.end() || it2 == m_Nodes.end())
+        {
+            LOG("[JSON] Edge '%s' references unknown nodes, ignored!\n", key.c_str());
+        }
+        else
+        {
+            for (auto& it : attributes)
+                append(m_EdgeAttributes, it.first, it.second, m_EdgeSources.size());
+
+            m_EdgeSources.push_back(it1->second);
+            m_EdgeTargets.push_back(it2->second);
+            m_EdgeKeys.push_back(key);
+        }
+
+        return token == JSONReader::OBJECT_END;
+    }
+
+    void flushEdges()
+    {
+        if (m_EdgeSources.empty())
+            return;
+
+        std::vector<Edge::ID> ids = m_Graph->addEdges(m_EdgeSources, m_EdgeTargets);
+
+        for (unsigned long i = 0; i < ids.size(); i++)
+            m_Edges[m_EdgeKeys[i]] = ids[i];
+
+        flushAttributes(m_EdgeAttributes, ids, false);
+
+        m_EdgeCount += ids.size();
+        m_EdgeSources.clear();
+        m_EdgeTargets.clear();
+        m_EdgeKeys.clear();
+    }
+
+    bool readTimeline()
+    {
+        JSONReader::Token token;
+        while ((token = m_Reader.next()) == JSONReader::ARRAY_BEGIN)
+        {
+            if (!readEvent())
+                return false;
+        }
+
+        // NOTE : One batch per timecode and one sequencer update for the whole timeline
+        m_Batcher.submit();
+
+        return token == JSONReader::ARRAY_END;
+    }
+
+    // [ timecode, "graph:command", { arguments } ]
+    bool readEvent()
+    {
+        if (m_Reader.next() != JSONReader::NUMBER)
+            return false;
+        Timecode timecode = static_cast<Timecode>(strtod(m_Reader.text().c_str(), NULL));
+
+        if (m_Reader.next() != JSONReader::STRING)
+            return false;
+        std::string name = m_Reader.text();
+
+        if (m_Reader.next() != JSONReader::OBJECT_BEGIN)
+            return false;
+
+        Variables variables;
+        bool valid = true;
+
+        JSONReader::Token token;
+        while ((token = m_Reader.next()) == JSONReader::KEY)
+        {
+            std::string key = m_Reader.text();
+            JSONReader::Token first = m_Reader.next();
+
+            IVariable* variable = NULL;
+
+            // TODO : Get rid of this translation phase when possible.
+            bool nodeID = (key == "id" && (name == "graph:remove_node" || name == "graph:set_node_attribute")) || key == "src" || key == "dst";
+            bool edgeID = key == "id" && (name == "graph:remove_edge" || name == "graph:set_edge_attribute");
+
+            if ((nodeID || edgeID) && (first == JSONReader::STRING || first == JSONReader::NUMBER))
+            {
+                // NOTE : Keys are looked up, never inserted, an unknown key fails the event instead of aliasing element 0
+                bool found;
+                unsigned long id = 0;
+                if (nodeID)
+                {
+                    auto it = m_Nodes.find(m_Reader.text());
+                    found = it != m_Nodes.end();
+                    if (found)
+                        id = it->second;
+                }
+                else
+                {
+                    auto it = m_Edges.find(m_Reader.text());
+                    found = it != m_Edges.end();
+                    if (found)
+                        id = it->second;
+                }
+
+                if (!found)
+                {
+                    valid = false;
+                    LOG("[JSON] Event '%s' at %lu references unknown %s '%s', ignored!\n", name.c_str(), static_cast<unsigned long>(timecode), nodeID ? "node" : "edge", m_Reader.text().c_str());
+                    continue;
+                }
+
+                IntVariable* var = new IntVariable();
+                var->set(id);
+                variable = var;
+            }
+            else if (first == JSONReader::STRING)
+            {
+                StringVariable* var = new StringVariable();
+                var->set(m_Reader.text());
+                variable = var;
+            }
+            else if (first == JSONReader::NUMBER && !m_Reader.isReal())
+            {
+                IntVariable* var = new IntVariable();
+                var->set(atoi(m_Reader.text().c_str()));
+                variable = var;
+            }
+            else if (first == JSONReader::NUMBER)
+            {
+                FloatVariable* var = new FloatVariable();
+                var->set(static_cast<float>(strtod(m_Reader.text().c_str(), NULL)));
+                variable = var;
+            }
+            else if (first == JSONReader::TRUE || first == JSONReader::FALSE)
+            {
+                BooleanVariable* var = new BooleanVariable();
+                var->set(first == JSONReader::TRUE);
+                variable = var;
+            }
+            else
+            {
+                m_Reader.skip(first);
+                LOG("[JSON] Item '%s' ignored!\n", key.c_str());
+                continue;
+            }
+
+            variables.set(key, variable);
+        }
+
+        if (token != JSONReader::OBJECT_END || m_Reader.next() != JSONReader::ARRAY_END)
+            return false;
+
+        if (valid && m_Batcher.add(timecode, name, variables))
+            m_EventCount++;
+
+        return true;
+    }
+
+    GraphEntity* m_Graph;
+    JSONReader m_Reader;
+    GraphCommandBatcher m_Batcher;
+
+    std::unordered_map<std::string, Node::ID> m_Nodes;
+    std::unordered_map<std::string, Edge::ID> m_Edges;
+
+    std::vector<std::string> m_NodeLabels;
+    std::vector<std::string> m_NodeKeys;
+    AttributeBatches m_NodeAttributes;
+
+    std::vector<Node::ID> m_EdgeSources;
+    std::vector<Node::ID> m_EdgeTargets;
+    std::vector<std::string> m_EdgeKeys;
+    AttributeBatches m_EdgeAttributes;
+
+    unsigned long m_NodeCount;
+    unsigned long m_EdgeCount;
+    unsigned long m_EventCount;
+};
+
+// Streams the graph to the JSON format read by GraphJSONLoader and Scripts/standard.py.
+// Model attributes come straight from the attribute columns, view attributes (e.g. "og:space:position")
+// have to be listed with addNodeViewAttribute / addEdgeViewAttribute.
+class GraphJSONWriter
+{
+public:
+    GraphJSONWriter(GraphEntity* graph, bool compact = false)
+    : m_Graph(graph), m_Compact(compact)
+    {
+        m_File = NULL;
+    }
+
+    void addNodeViewAttribute(const std::string& name) { m_NodeViewAttributes.push_back(name); }
+    void addEdgeViewAttribute(const std::string& name) { m_EdgeViewAttributes.push_back(name); }
+
+    bool save(const char* path)
+    {
+        m_File = fopen(path, "wb");
+        if (m_File == NULL)
+        {
+            LOG("[JSON] Couldn't open '%s' for writing!\n", path);
+            return false;
+        }
+
+        std::vector<char> buffer(1 << 20);
+        setvbuf(m_File, &buffer[0], _IOFBF, buffer.size());
+
+        GraphModel* model = m_Graph->model();
+
+        std::vector<ViewAttribute> nodeViews = resolve(m_NodeViewAttributes);
+        std::vector<ViewAttribute> edgeViews = resolve(m_EdgeViewAttributes);
+
+        fputs("{", m_File);
+        newline(1);
+        fputs("\"meta\":", m_File);
+        space();
+        fputs("{},", m_File);
+
+        newline(1);
+        fputs("\"nodes\":", m_File);
+        space();
+        fputs("[", m_File);
+
+        bool first = true;
+        for (auto it = model->nodes_begin(); it != model->nodes_end(); ++it)
+        {
+            separator(first, 2);
+            fputs("{", m_File);
+            newline(3);
+            fprintf(m_File, "\"id\":");
+            space();
+            fprintf(m_File, "%lu,", it->id());
+            newline(3);
+            fputs("\"label\":", m_File);
+            space();
+            string(it->data().Label);
+
+            writeColumns(model->nodeAttributes(), SlotMap<Node>::index(it->id()));
+
+            for (auto& view : nodeViews)
+            {
+                IVariable* value = view.View->getNodeAttribute(it->id(), view.Attribute);
+                writeAttribute(view.Name, value);
+                delete value;
+            }
+
+            newline(2);
+            fputs("}", m_File);
+        }
+
+        newline(1);
+        fputs("],", m_File);
+        newline(1);
+        fputs("\"edges\":", m_File);
+        space();
+        fputs("[", m_File);
+
+        first = true;
+        for (auto it = model->edges_begin(); it != model->edges_end(); ++it)
+        {
+            separator(first, 2);
+            fputs("{", m_File);
+            newline(3);
+            fputs("\"id\":", m_File);
+            space();
+            fprintf(m_File, "%lu,", it->id());
+            newline(3);
+            fputs("\"src\":", m_File);
+            space();
+            fprintf(m_File, "%lu,", it->data().Node1);
+            newline(3);
+            fputs("\"dst\":", m_File);
+            space();
+            fprintf(m_File, "%lu", it->data().Node2);
+
+            writeColumns(model->edgeAttributes(), SlotMap<Edge>::index(it->id()));
+
+            for (auto& view : edgeViews)
+            {
+                IVariable* value = view.View->getEdgeAttribute(it->id(), view.Attribute);
+                writeAttribute(view.Name, value);
+                delete value;
+            }
+
+            newline(2);
+            fputs("}", m_File);
+        }
+
+        newline(1);
+        fputs("]", m_File);
+        newline(0);
+        fputs("}\n", m_File);
+
+        bool ok = ferror(m_File) == 0;
+        fclose(m_File);
+        m_File = NULL;
+
+        LOG("[JSON] Saved %lu nodes and %lu edges in '%s'.\n", model->countNodes(), model->countEdges(), path);
+        return ok;
+    }
+
+private:
+    struct ViewAttribute
+    {
+        std::string Name;
+        GraphView* View;
+        std::string Attribute;
+    };
+
+    // NOTE : Views are looked up once instead of for every element
+    std::vector<ViewAttribute> resolve(const std::vector<std::string>& names)
+    {
+        std::vector<ViewAttribute> result;
+
+        for (auto& name : names)
+        {
+            unsigned long pos1 = name.find(":");
+            std::string rest = name.substr(pos1 + 1);
+            unsigned long pos2 = rest.find(":");
+            std::string view = rest.substr(0, pos2);
+
+            for (auto v : m_Graph->views())
+            {
+                if (pos1 != std::string::npos && pos2 != std::string::npos && view == std::string(v->name()))
+                {
+                    ViewAttribute attribute;
+                    attribute.Name = name;
+                    attribute.View = static_cast<GraphView*>(v);
+                    attribute.Attribute = rest.substr(pos2 + 1);
+                    result.push_back(attribute);
+                }
+            }
+        }
+
+        return result;
+    }
+
+    void writeColumns(AttributeStore& store, unsigned long row)
+    {
+        for (auto c : store.columns())
+        {
+            if (!c->has(row))
+                continue;
+
+            key(c->name());
+
+            switch (c->type())
+            {
+            case RD_STRING:
+                string(store.dictionary().get(static_cast<StringDictionary::ID>(c->integers()[row])));
+                break;
+            case RD_INT:
+                fprintf(m_File, "%ld", c->integers()[row]);
+                break;
+            case RD_BOOLEAN:
+                fputs(c->integers()[row] != 0 ? "true" : "false", m_File);
+                break;
+            default:
+                numbers(c->floats() + row * c->components(), c->components(), c->type() != RD_FLOAT);
+                break;
+            }
+        }
+    }
+
+    void writeAttribute(const std::string& name, IVariable* value)
+    {
+        if (value == NULL)
+            return;
+
+        float v[4];
+
+        switch (value->type())
+        {
+        case RD_STRING:
+            key(name);
+            string(static_cast<StringVariable*>(value)->value());
+            break;
+        case RD_INT:
+            key(name);
+            fprintf(m_File, "%ld", static_cast<long>(static_cast<IntVariable*>(value)->value()));
+            break;
+        case RD_BOOLEAN:
+            key(name);
+            fputs(static_cast<BooleanVariable*>(value)->value() ? "true" : "false", m_File);
+            break;
+        case RD_FLOAT:
+            key(name);
+            v[0] = static_cast<FloatVariable*>(value)->value();
+            numbers(v, 1, false);
+            break;
+        case RD_VEC2:
+            key(name);
+            for (int i = 0; i < 2; i++)
+                v[i] = static_cast<Vec2Variable*>(value)->value()[i];
+            numbers(v, 2, true);
+            break;
+        case RD_VEC3:
+            key(name);
+            for (int i = 0; i < 3; i++)
+                v[i] = static_cast<Vec3Variable*>(value)->value()[i];
+            numbers(v, 3, true);
+            break;
+        case RD_VEC4:
+            key(name);
+            for (int i = 0; i < 4; i++)
+                v[i] = static_cast<Vec4Variable*>(value)->value()[i];
+            numbers(v, 4, true);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void numbers(const float* values, unsigned int count, bool array)
+    {
+        if (array)
+            fputs("[", m_File);
+
+        for (unsigned int i = 0; i < count; i++)
+        {
+            if (i > 0)
+            {
+                fputs(",", m_File);
+                space();
+            }
+            JSONWriter::number(m_File, values[i]);
+        }
+
+        if (array)
+            fputs("]", m_File);
+    }
+
+    void key(const std::string& name)
+    {
+        fputs(",", m_File);
+        newline(3);
+        string(name);
+        fputs(":", m_File);
+        space();
+    }
+
+    void string(const std::string& value)
+    {
+        JSONWriter::string(m_File, value);
+    }
+
+    void separator(bool& first, unsigned int depth)
+    {
+        if (!first)
+            fputs(",", m_File);
+        first = false;
+        newline(depth);
+    }
+
+    inline void newline(unsigned int depth)
+    {
+        if (m_Compact)
+            return;
+        fputc('\n', m_File);
+        for (unsigned int i = 0; i < depth; i++)
+            fputc(' ', m_File);
+    }
+
+    inline void space()
+    {
+        if (!m_Compact)
+            fputc(' ', m_File);
+    }
+
+    GraphEntity* m_Graph;
+    bool m_Compact;
+    FILE* m_File;
+
+    std::vector<std::string> m_NodeViewAttributes;
+    std::vector<std::string> m_EdgeViewAttributes;
+};
@@ -2,6 +2,8 @@
 
 #include <raindance/Core/Variables.hh>
 
+#include <graphiti/Entities/Graph/GraphAttributes.hh>
+
 class Node;
 class Edge;
 class Sphere;
@@ -29,6 +31,15 @@ public:
         m_Remote.erase(lid);
     }
 
+    // NOTE : For views that compact their elements, the remote ID now maps to another local ID
+    void moveLocalID(U from, U to)
+    {
+        T rid = m_Remote[from];
+        m_Remote.erase(from);
+        m_Local[rid] = to;
+        m_Remote[to] = rid;
+    }
+
     inline bool containsRemoteID(T rid) const { return (m_Local.find(rid) == m_Local.end() ? false : true); }
     inline bool containsLocalID(U lid) const { return (m_Remote.find(lid) == m_Remote.end() ? false : true); }
 
@@ -36,8 +47,122 @@ public:
     inline T getRemoteID(U lid) { return m_Remote[lid]; }
 
 private:
-	std::unordered_map<U, T> m_Local;
-	std::unordered_map<T, U> m_Remote;
+	std::unordered_map<T, U> m_Local;
+	std::unordered_map<U, T> m_Remote;
+};
+
+template <class T>
+class SlotMap
+{
+public:
+	typedef unsigned long ID;
+	typedef typename std::vector<T>::iterator iterator;
+
+	// NOTE : An ID packs a slot index in its low bits and the slot generation in its high bits.
+	// The generation is bumped every time a slot is released, so a stale ID never aliases the
+	// element that reuses its slot. Elements are built with T(ID, Data) and expose T::id().
+	static const unsigned int IndexBits = sizeof(ID) >= 8 ? 32 : 24;
+	static const ID IndexMask = (static_cast<ID>(1) << IndexBits) - 1;
+	static const ID GenerationMask = (~static_cast<ID>(0)) >> IndexBits;
+
+	// NOTE : Never returned by insert, the slot index would have to fill all the index bits
+	static const ID Invalid = ~static_cast<ID>(0);
+
+	static inline ID index(ID id) { return id & IndexMask; }
+	static inline ID generation(ID id) { return (id >> IndexBits) & GenerationMask; }
+
+	template <class D>
+	ID insert(const D& data)
+	{
+		ID slot;
+
+		if (m_FreeSlots.empty())
+		{
+			slot = m_Slots.size();
+			m_Slots.push_back(Slot());
+		}
+		else
+		{
+			slot = m_FreeSlots.back();
+			m_FreeSlots.pop_back();
+		}
+
+		ID id = (m_Slots[slot].Generation << IndexBits) | slot;
+
+		m_Slots[slot].Dense = m_Dense.size();
+		m_Dense.push_back(T(id, data));
+
+		return id;
+	}
+
+	bool remove(ID id)
+	{
+		if (find(id) == NULL)
+			return false;
+
+		ID slot = index(id);
+		ID dense = m_Slots[slot].Dense;
+
+		// NOTE : Swap with the last element to keep the storage dense
+		if (dense != m_Dense.size() - 1)
+		{
+			std::swap(m_Dense[dense], m_Dense.back());
+			m_Slots[index(m_Dense[dense].id())].Dense = dense;
+		}
+		m_Dense.pop_back();
+
+		m_Slots[slot].Generation = (m_Slots[slot].Generation + 1) & GenerationMask;
+		m_FreeSlots.push_back(slot);
+
+		return true;
+	}
+
+	inline T* find(ID id)
+	{
+		ID slot = index(id);
+		if (slot >= m_Slots.size())
+			return NULL;
+
+		ID dense = m_Slots[slot].Dense;
+		if (dense >= m_Dense.size() || m_Dense[dense].id() != id)
+			return NULL;
+
+		return &m_Dense[dense];
+	}
+
+	inline bool contains(ID id) { return find(id) != NULL; }
+
+	void clear()
+	{
+		m_Dense.clear();
+		m_Slots.clear();
+		m_FreeSlots.clear();
+	}
+
+	void reserve(unsigned long capacity)
+	{
+		m_Dense.reserve(capacity);
+		m_Slots.reserve(capacity);
+	}
+
+	inline unsigned long size() const { return m_Dense.size(); }
+	inline T& operator[](unsigned long dense) { return m_Dense[dense]; }
+
+	inline iterator begin() { return m_Dense.begin(); }
+	inline iterator end() { return m_Dense.end(); }
+
+private:
+	struct Slot
+	{
+		Slot() : Dense(0), Generation(0) {}
+
+		ID Dense;
+		ID Generation;
+	};
+
+	std::vector<T> m_Dense;
+	std::vector<Slot> m_Slots;
+	std::vector<ID> m_FreeSlots;
 };
 
 class Node
@@ -73,13 +198,9 @@ public:
 	// Property setters
 	inline void data(Data& d) { m_Data = d; }
 
-	// Accessors
-	inline Variables& attributes() { return m_Attributes; }
-
 private:
 	ID m_ID;
 	Data m_Data;
-	Variables m_Attributes;
 };
 
 class Edge
@@ -116,13 +237,9 @@ public:
 	// Property setters
 	inline void data(Data& d) { m_Data = d; }
 
-	// Accessors
-	inline Variables& attributes() { return m_Attributes; }
-
 private:
 	ID m_ID;
 	Data m_Data;
-	Variables m_Attributes;
 };
 
 class Sphere
@@ -159,13 +276,215 @@ public:
 	// Property setters
 	inline void data(Data& d) { m_Data = d; }
 
-	// Accessors
-	inline Variables& attributes() { return m_Attributes; }
-
 private:
 	ID m_ID;
 	Data m_Data;
-	Variables m_Attributes;
+};
+
+// Compressed sparse row (CSR) index of the incoming and outgoing edges of every node.
+// Rows are addressed by node slot index. New edges go to a delta buffer that is merged lazily,
+// removed edges are tombstoned in place and compacted away on the next merge.
+class GraphAdjacency
+{
+public:
+	struct Incidence
+	{
+		Node::ID Neighbor;
+		Edge::ID EdgeID;
+	};
+
+	GraphAdjacency()
+	{
+		m_Tombstones = 0;
+	}
+
+	void addEdge(Edge::ID edge, Node::ID node1, Node::ID node2)
+	{
+		Delta delta;
+		delta.EdgeID = edge;
+		delta.Node1 = node1;
+		delta.Node2 = node2;
+		m_Delta.push_back(delta);
+	}
+
+	// NOTE : O(degree) when the edge is already merged, O(delta) otherwise.
+	void removeEdge(Edge::ID edge, Node::ID node1, Node::ID node2)
+	{
+		for (unsigned long i = 0; i < m_Delta.size(); i++)
+		{
+			if (m_Delta[i].EdgeID == edge)
+			{
+				m_Delta[i] = m_Delta.back();
+				m_Delta.pop_back();
+				return;
+			}
+		}
+
+		m_Tombstones += tombstone(m_Out, row(node1), edge);
+		m_Tombstones += tombstone(m_In, row(node2), edge);
+	}
+
+	void clear()
+	{
+		m_Out.clear();
+		m_In.clear();
+		m_Delta.clear();
+		m_Tombstones = 0;
+	}
+
+	// Calls f(Incidence) for every edge touching the node. Self loops are reported once.
+	template <class F>
+	void foreachIncidence(Node::ID node, F f)
+	{
+		prepare();
+
+		unsigned long r = row(node);
+
+		if (r + 1 < m_Out.Offsets.size())
+		{
+			for (unsigned long i = m_Out.Offsets[r]; i < m_Out.Offsets[r + 1]; i++)
+				if (m_Out.Entries[i].EdgeID != Invalid)
+					f(m_Out.Entries[i]);
+		}
+
+		if (r + 1 < m_In.Offsets.size())
+		{
+			for (unsigned long i = m_In.Offsets[r]; i < m_In.Offsets[r + 1]; i++)
+				if (m_In.Entries[i].EdgeID != Invalid && m_In.Entries[i].Neighbor != node)
+					f(m_In.Entries[i]);
+		}
+
+		for (unsigned long i = 0; i < m_Delta.size(); i++)
+		{
+			if (m_Delta[i].Node1 == node)
+				f(incidence(m_Delta[i].Node2, m_Delta[i].EdgeID));
+			else if (m_Delta[i].Node2 == node)
+				f(incidence(m_Delta[i].Node1, m_Delta[i].EdgeID));
+		}
+	}
+
+	// Rebuilds the CSR arrays from the merged rows and the delta buffer, dropping tombstones.
+	void merge()
+	{
+		if (m_Delta.empty() && m_Tombstones == 0)
+			return;
+
+		unsigned long rows = std::max(m_Out.rows(), m_In.rows());
+		for (unsigned long i = 0; i < m_Delta.size(); i++)
+			rows = std::max(rows, std::max(row(m_Delta[i].Node1), row(m_Delta[i].Node2)) + 1);
+
+		m_Out = rebuild(m_Out, rows, true);
+		m_In = rebuild(m_In, rows, false);
+
+		m_Delta.clear();
+		m_Tombstones = 0;
+	}
+
+	inline unsigned long countPending() const { return m_Delta.size() + m_Tombstones; }
+
+private:
+	static const Edge::ID Invalid = ~static_cast<Edge::ID>(0);
+
+	// NOTE : Below this size the delta buffer is scanned on every query instead of being merged
+	static const unsigned long MaxDelta = 256;
+
+	struct Delta
+	{
+		Edge::ID EdgeID;
+		Node::ID Node1;
+		Node::ID Node2;
+	};
+
+	struct CSR
+	{
+		std::vector<unsigned long> Offsets;
+		std::vector<Incidence> Entries;
+
+		inline unsigned long rows() const { return Offsets.empty() ? 0 : Offsets.size() - 1; }
+
+		void clear()
+		{
+			Offsets.clear();
+			Entries.clear();
+		}
+	};
+
+	static inline unsigned long row(Node::ID node) { return SlotMap<Node>::index(node); }
+
+	static inline Incidence incidence(Node::ID neighbor, Edge::ID edge)
+	{
+		Incidence result;
+		result.Neighbor = neighbor;
+		result.EdgeID = edge;
+		return result;
+	}
+
+	static unsigned long tombstone(CSR& csr, unsigned long r, Edge::ID edge)
+	{
+		if (r + 1 >= csr.Offsets.size())
+			return 0;
+
+		for (unsigned long i = csr.Offsets[r]; i < csr.Offsets[r + 1]; i++)
+		{
+			if (csr.Entries[i].EdgeID == edge)
+			{
+				csr.Entries[i].EdgeID = Invalid;
+				return 1;
+			}
+		}
+		return 0;
+	}
+
+	void prepare()
+	{
+		unsigned long maxTombstones = m_Out.Entries.size() / 4;
+		if (maxTombstones < MaxDelta)
+			maxTombstones = MaxDelta;
+
+		if (m_Delta.size() > MaxDelta || m_Tombstones > maxTombstones)
+			merge();
+	}
+
+	CSR rebuild(const CSR& csr, unsigned long rows, bool outgoing)
+	{
+		CSR result;
+		result.Offsets.assign(rows + 1, 0);
+
+		for (unsigned long r = 0; r < csr.rows(); r++)
+			for (unsigned long i = csr.Offsets[r]; i < csr.Offsets[r + 1]; i++)
+				if (csr.Entries[i].EdgeID != Invalid)
+					result.Offsets[r + 1]++;
+
+		for (unsigned long i = 0; i < m_Delta.size(); i++)
+			result.Offsets[row(outgoing ? m_Delta[i].Node1 : m_Delta[i].Node2) + 1]++;
+
+		for (unsigned long r = 0; r < rows; r++)
+			result.Offsets[r + 1] += result.Offsets[r];
+
+		result.Entries.resize(result.Offsets[rows]);
+
+		std::vector<unsigned long> cursor(result.Offsets.begin(), result.Offsets.end() - 1);
+
+		for (unsigned long r = 0; r < csr.rows(); r++)
+			for (unsigned long i = csr.Offsets[r]; i < csr.Offsets[r + 1]; i++)
+				if (csr.Entries[i].EdgeID != Invalid)
+					result.Entries[cursor[r]++] = csr.Entries[i];
+
+		for (unsigned long i = 0; i < m_Delta.size(); i++)
+		{
+			if (outgoing)
+				result.Entries[cursor[row(m_Delta[i].Node1)]++] = incidence(m_Delta[i].Node2, m_Delta[i].EdgeID);
+			else
+				result.Entries[cursor[row(m_Delta[i].Node2)]++] = incidence(m_Delta[i].Node1, m_Delta[i].EdgeID);
+		}
+
+		return result;
+	}
+
+	CSR m_Out;
+	CSR m_In;
+	std::vector<Delta> m_Delta;
+	unsigned long m_Tombstones;
 };
 
 class GraphModel : public EntityModel
@@ -174,8 +493,6 @@ public:
 
 	GraphModel()
 	{
-		m_NodeCounter = 0;
-		m_EdgeCounter = 0;
 	}
 
 	~GraphModel()
@@ -186,15 +503,15 @@ public:
 
 	Node::ID addNode(Node::Data data)
 	{
-		Node n(m_NodeCounter, data);
-		m_Nodes.push_back(n);
-		m_NodeCounter++;
-
-		return n.id();
+		return m_Nodes.insert(data);
 	}
 
 	void removeNode(Node::ID id)
 	{
+		// NOTE : A stale ID would address the adjacency row of the node that reuses its slot
+		if (!m_Nodes.contains(id))
+			return;
+
 		if (m_SelectedNodes.find(id) != m_SelectedNodes.end())
 			m_SelectedNodes.erase(id);
 
@@ -204,40 +521,22 @@ public:
 			std::vector<Node::ID>::iterator itsn;
 			for (itsn = its->data().Nodes.begin(); itsn != its->data().Nodes.end();)
 				if (*itsn == id)
-					its->data().Nodes.erase(itsn);
+					itsn = its->data().Nodes.erase(itsn);
 				else
 					++itsn;
 		}
 
-		std::vector<Edge>::iterator itl;
-		for (itl = m_Edges.begin(); itl != m_Edges.end();)
-		{
-			if (itl->data().Node1 == id || itl->data().Node2 == id)
-				m_Edges.erase(itl);
-			else
-				++itl;
-		}
+		std::vector<Edge::ID> edges = incidentEdges(id);
+		for (auto eid : edges)
+			removeEdge(eid);
 
-		std::vector<Node>::iterator itn;
-		for (itn = m_Nodes.begin(); itn != m_Nodes.end(); ++itn)
-		{
-			if (itn->id() == id)
-			{
-				m_Nodes.erase(itn);
-				break;
-			}
-		}
+		m_NodeAttributes.erase(SlotMap<Node>::index(id));
+		m_Nodes.remove(id);
 	}
 	inline unsigned long countNodes() const { return m_Nodes.size(); }
+	inline void reserveNodes(unsigned long count) { m_Nodes.reserve(m_Nodes.size() + count); }
 
-	Node* node(Node::ID id)
-	{
-		std::vector<Node>::iterator itn;
-		for (itn = m_Nodes.begin(); itn != m_Nodes.end(); ++itn)
-			if (itn->id() == id)
-				return &(*itn);
-		return NULL;
-	}
+	inline Node* node(Node::ID id) { return m_Nodes.find(id); }
 
 	inline const std::vector<Node>::iterator nodes_begin() { return m_Nodes.begin(); }
 	inline const std::vector<Node>::iterator nodes_end() { return m_Nodes.end(); }
@@ -247,53 +546,76 @@ public:
 	inline unsigned long countSelectedNodes() const { return m_SelectedNodes.size(); }
 	inline Node& selectedNode(unsigned int index)
 	{
-		std::set<Node::ID>::iterator it;
-		unsigned int count = 0;
-		for (it = m_SelectedNodes.begin(); it!= m_SelectedNodes.end(); ++it)
-			if (count == index)
-				break;
-		return m_Nodes[*it];
+		std::set<Node::ID>::iterator it = m_SelectedNodes.begin();
+		std::advance(it, index);
+		return *m_Nodes.find(*it);
 	}
 	inline const std::set<Node::ID>::iterator selectedNodes_begin() { return m_SelectedNodes.begin(); }
 	inline const std::set<Node::ID>::iterator selectedNodes_end() { return m_SelectedNodes.end(); }
 
 	// ----- Edges -----
 
+	// Returns SlotMap<Edge>::Invalid when an endpoint isn't a live node
 	Edge::ID addEdge(Edge::Data data)
 	{
-		Edge l(m_EdgeCounter, data);
-		m_Edges.push_back(l);
-		m_EdgeCounter++;
+		if (!m_Nodes.contains(data.Node1) || !m_Nodes.contains(data.Node2))
+			return SlotMap<Edge>::Invalid;
 
-		return l.id();
+		Edge::ID id = m_Edges.insert(data);
+		m_Adjacency.addEdge(id, data.Node1, data.Node2);
+		return id;
 	}
 
 	void removeEdge(Edge::ID id)
 	{
-		std::vector<Edge>::iterator it;
-		for (it = m_Edges.begin(); it != m_Edges.end(); ++it)
-		{
-			if (it->id() == id)
-			{
-				m_Edges.erase(it);
-				break;
-			}
-		}
-	}
+		Edge* edge = m_Edges.find(id);
+		if (edge == NULL)
+			return;
 
-	Edge* edge(Edge::ID id)
-	{
-		std::vector<Edge>::iterator ite;
-		for (ite = m_Edges.begin(); ite != m_Edges.end(); ++ite)
-			if (ite->id() == id)
-				return &(*ite);
-		return NULL;
+		m_Adjacency.removeEdge(id, edge->data().Node1, edge->data().Node2);
+		m_EdgeAttributes.erase(SlotMap<Edge>::index(id));
+		m_Edges.remove(id);
 	}
 
+	inline Edge* edge(Edge::ID id) { return m_Edges.find(id); }
+	inline void reserveEdges(unsigned long count) { m_Edges.reserve(m_Edges.size() + count); }
+
     inline unsigned long countEdges() const { return m_Edges.size(); }
 	inline const std::vector<Edge>::iterator edges_begin() { return m_Edges.begin(); }
 	inline const std::vector<Edge>::iterator edges_end() { return m_Edges.end(); }
 
+	// ----- Adjacency -----
+
+	// NOTE : Stale or unknown IDs have no neighbors, the adjacency rows are addressed by slot only
+	std::vector<Node::ID> neighbors(Node::ID id)
+	{
+		std::vector<Node::ID> result;
+		if (!m_Nodes.contains(id))
+			return result;
+		m_Adjacency.foreachIncidence(id, [&result](const GraphAdjacency::Incidence& incidence) { result.push_back(incidence.Neighbor); });
+		return result;
+	}
+
+	std::vector<Edge::ID> incidentEdges(Node::ID id)
+	{
+		std::vector<Edge::ID> result;
+		if (!m_Nodes.contains(id))
+			return result;
+		m_Adjacency.foreachIncidence(id, [&result](const GraphAdjacency::Incidence& incidence) { result.push_back(incidence.EdgeID); });
+		return result;
+	}
+
+	unsigned long degree(Node::ID id)
+	{
+		unsigned long result = 0;
+		if (!m_Nodes.contains(id))
+			return result;
+		m_Adjacency.foreachIncidence(id, [&result](const GraphAdjacency::Incidence&) { result++; });
+		return result;
+	}
+
+	inline GraphAdjacency& adjacency() { return m_Adjacency; }
+
 	// ----- Spheres -----
 
 	Sphere::ID addSphere(Sphere::Data data)
@@ -318,34 +640,79 @@ public:
 
 	inline Variables& attributes() { return m_Attributes; }
 
+	bool setNodeAttribute(Node::ID id, const std::string& name, VariableType type, const std::string& value)
+	{
+		if (!m_Nodes.contains(id))
+			return false;
+		m_NodeAttributes.set(SlotMap<Node>::index(id), name, type, value);
+		return true;
+	}
+
+	bool setNodeAttribute(Node::ID id, AttributeColumn* column, IVariable& value)
+	{
+		if (!m_Nodes.contains(id))
+			return false;
+		m_NodeAttributes.set(SlotMap<Node>::index(id), column, value);
+		return true;
+	}
+
+	IVariable* getNodeAttribute(Node::ID id, const std::string& name)
+	{
+		if (!m_Nodes.contains(id))
+			return NULL;
+		return m_NodeAttributes.get(SlotMap<Node>::index(id), name);
+	}
+
+	bool setEdgeAttribute(Edge::ID id, const std::string& name, VariableType type, const std::string& value)
+	{
+		if (!m_Edges.contains(id))
+			return false;
+		m_EdgeAttributes.set(SlotMap<Edge>::index(id), name, type, value);
+		return true;
+	}
+
+	bool setEdgeAttribute(Edge::ID id, AttributeColumn* column, IVariable& value)
+	{
+		if (!m_Edges.contains(id))
+			return false;
+		m_EdgeAttributes.set(SlotMap<Edge>::index(id), column, value);
+		return true;
+	}
+
+	IVariable* getEdgeAttribute(Edge::ID id, const std::string& name)
+	{
+		if (!m_Edges.contains(id))
+			return NULL;
+		return m_EdgeAttributes.get(SlotMap<Edge>::index(id), name);
+	}
+
+	// NOTE : Columns are indexed by SlotMap<Node>::index(id) and SlotMap<Edge>::index(id)
+	inline AttributeStore& nodeAttributes() { return m_NodeAttributes; }
+	inline AttributeStore& edgeAttributes() { return m_EdgeAttributes; }
+
 	// ----- Helpers -----
 
 	std::pair<Node::ID, Edge::ID> addNeighbor(Node::Data ndata, Edge::Data edata, Node::ID neighbor)
 	{
-		Node node(m_NodeCounter, ndata);
-		m_Nodes.push_back(node);
+		Node::ID nid = addNode(ndata);
 
 		edata.Node1 = neighbor;
-		edata.Node2 = node.id();
-
-		Edge edge(m_EdgeCounter, edata);
-		m_Edges.push_back(edge);
+		edata.Node2 = nid;
 
-		m_NodeCounter++;
-		m_EdgeCounter++;
+		Edge::ID eid = addEdge(edata);
 
-		return std::pair<Node::ID, Edge::ID>(node.id(), edge.id());
+		return std::pair<Node::ID, Edge::ID>(nid, eid);
 	}
 
 private:
-	std::vector<Node> m_Nodes;
-	std::vector<Edge> m_Edges;
+	SlotMap<Node> m_Nodes;
+	SlotMap<Edge> m_Edges;
+	GraphAdjacency m_Adjacency;
 	std::vector<Sphere> m_Spheres;
 
 	std::set<Node::ID> m_SelectedNodes;
 
 	Variables m_Attributes;
-
-	Node::ID m_NodeCounter;
-	Edge::ID m_EdgeCounter;
+	AttributeStore m_NodeAttributes;
+	AttributeStore m_EdgeAttributes;
 };
@@ -0,0 +1,506 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
+
+#include <graphiti/Entities/MVC.hh>
+#include <graphiti/Entities/Graph/GraphSnapshotFormat.hh>
+
+// Saves and loads the whole graph as a binary snapshot (.ogs, see GraphSnapshotFormat.hh), loaded through mmap.
+class GraphSnapshot
+{
+public:
+    static const unsigned int Version = GraphSnapshotFormat::Version;
+
+    GraphSnapshot(GraphEntity* graph)
+    : m_Graph(graph)
+    {
+    }
+
+    bool save(const char* filename)
+    {
+        GraphModel* model = m_Graph->model();
+
+        FILE* file = fopen(filename, "wb");
+        if (file == NULL)
+        {
+            LOG("[SNAPSHOT] Couldn't open '%s' for writing!\n", filename);
+            return false;
+        }
+
+        // NOTE : Element rows are slot indices, translate them to iteration order
+        std::vector<unsigned int> nodeIndices;
+        std::vector<unsigned long> nodeRows;
+        for (auto it = model->nodes_begin(); it != model->nodes_end(); ++it)
+        {
+            unsigned long row = SlotMap<Node>::index(it->id());
+            if (row >= nodeIndices.size())
+                nodeIndices.resize(row + 1, 0);
+            nodeIndices[row] = nodeRows.size();
+            nodeRows.push_back(row);
+        }
+
+        std::vector<unsigned long> edgeRows;
+        std::vector<unsigned int> node1s;
+        std::vector<unsigned int> node2s;
+        for (auto it = model->edges_begin(); it != model->edges_end(); ++it)
+        {
+            edgeRows.push_back(SlotMap<Edge>::index(it->id()));
+            node1s.push_back(nodeIndices[SlotMap<Node>::index(it->data().Node1)]);
+            node2s.push_back(nodeIndices[SlotMap<Node>::index(it->data().Node2)]);
+        }
+
+        std::vector<unsigned int> labels;
+        for (auto it = model->nodes_begin(); it != model->nodes_end(); ++it)
+            labels.push_back(intern(it->data().Label));
+
+        std::vector<Column> nodeColumns;
+        std::vector<Column> edgeColumns;
+        collect(model->nodeAttributes(), nodeRows, nodeColumns);
+        collect(model->edgeAttributes(), edgeRows, edgeColumns);
+
+        // NOTE : View attributes are stored as regular columns (the ones save_json writes), except for
+        // positions and colors which are exported in bulk as view arrays below.
+        const char* nodeViews[] = { "og:space:locked", "og:space:lod", "og:space:activity", "og:space:mark", "og:space:size" };
+        const char* edgeViews[] = { "og:space:activity", "og:space:color1", "og:space:color2", "og:space:width", "og:space:lod" };
+        for (auto name : nodeViews)
+            collectView(name, true, nodeColumns);
+        for (auto name : edgeViews)
+            collectView(name, false, edgeColumns);
+
+        std::vector<std::vector<float>> arrays;
+        std::vector<unsigned int> arrayComponents;
+        std::vector<unsigned int> arrayNames;
+        const char* views[] = { "og:space:position", "og:space:color" };
+        for (auto name : views)
+        {
+            std::vector<float> array;
+            unsigned int components = m_Graph->readNodeArray(name, array);
+            if (components > 0)
+            {
+                arrays.push_back(std::vector<float>());
+                arrays.back().swap(array);
+                arrayComponents.push_back(components);
+                arrayNames.push_back(intern(name));
+            }
+        }
+
+        Header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.Magic, "OGS", 4);
+        header.Version = Version;
+        header.NodeCount = labels.size();
+        header.EdgeCount = node1s.size();
+        header.StringCount = m_Strings.size();
+        header.NodeColumnCount = nodeColumns.size();
+        header.EdgeColumnCount = edgeColumns.size();
+        header.ArrayCount = arrays.size();
+
+        Writer writer(file);
+        writer.write(&header, sizeof(header));
+
+        std::vector<unsigned long long> offsets(1, 0);
+        for (auto& s : m_Strings)
+            offsets.push_back(offsets.back() + s.size());
+        writer.write(offsets);
+        for (auto& s : m_Strings)
+            fwrite(s.data(), 1, s.size(), file);
+        writer.advance(offsets.back());
+
+        writer.write(labels);
+        writer.write(node1s);
+        writer.write(node2s);
+
+        for (auto& c : nodeColumns)
+            write(writer, c);
+        for (auto& c : edgeColumns)
+            write(writer, c);
+
+        for (unsigned long i = 0; i < arrays.size(); i++)
+        {
+            ArrayHeader array;
+            array.Name = arrayNames[i];
+            array.Components = arrayComponents[i];
+            array.Count = arrays[i].size();
+            writer.write(&array, sizeof(array));
+            writer.write(arrays[i]);
+        }
+
+        bool ok = ferror(file) == 0;
+        fclose(file);
+
+        m_Strings.clear();
+        m_StringIndex.clear();
+
+        LOG("[SNAPSHOT] Saved %lu nodes and %lu edges in '%s'.\n", labels.size(), node1s.size(), filename);
+        return ok;
+    }
+
+    bool load(const char* filename)
+    {
+#ifdef _WIN32
+        LOG("[SNAPSHOT] Snapshots are not supported on this platform!\n");
+        (void) filename;
+        return false;
+#else
+        int fd = open(filename, O_RDONLY);
+        if (fd < 0)
+        {
+            LOG("[SNAPSHOT] Couldn't open '%s'!\n", filename);
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<unsigned long>(st.st_size) < sizeof(Header))
+        {
+            LOG("[SNAPSHOT] '%s' is not a snapshot!\n", filename);
+            ::close(fd);
+            return false;
+        }
+
+        void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED)
+        {
+            LOG("[SNAPSHOT] Couldn't map '%s'!\n", filename);
+            return false;
+        }
+
+        bool ok = read(static_cast<const char*>(data), st.st_size);
+        if (!ok)
+            LOG("[SNAPSHOT] '%s' is corrupted or has an unsupported version!\n", filename);
+
+        munmap(data, st.st_size);
+        return ok;
+#endif
+    }
+
+private:
+    typedef GraphSnapshotFormat::Header Header;
+    typedef GraphSnapshotFormat::ColumnHeader ColumnHeader;
+    typedef GraphSnapshotFormat::ArrayHeader ArrayHeader;
+    typedef GraphSnapshotFormat::Writer Writer;
+    typedef GraphSnapshotFormat::Reader Reader;
+
+    // Column values gathered in iteration order
+    struct Column
+    {
+        ColumnHeader Header;
+        std::vector<unsigned int> Rows;
+        std::vector<float> Floats;
+        std::vector<long long> Integers;
+    };
+
+    void write(Writer& writer, const Column& column)
+    {
+        writer.write(&column.Header, sizeof(column.Header));
+        writer.write(column.Rows);
+        writer.write(column.Floats);
+        writer.write(column.Integers);
+    }
+
+    unsigned int intern(const std::string& s)
+    {
+        auto it = m_StringIndex.find(s);
+        if (it != m_StringIndex.end())
+            return it->second;
+
+        unsigned int index = m_Strings.size();
+        m_Strings.push_back(s);
+        m_StringIndex[s] = index;
+        return index;
+    }
+
+    void collect(AttributeStore& store, const std::vector<unsigned long>& rows, std::vector<Column>& columns)
+    {
+        for (auto c : store.columns())
+        {
+            if (c->count() == 0)
+                continue;
+
+            Column column;
+            column.Header.Name = intern(c->name());
+            column.Header.Type = static_cast<unsigned int>(c->type());
+            column.Header.Components = GraphSnapshotFormat::components(column.Header.Type);
+            column.Header.Reserved = 0;
+
+            for (unsigned long i = 0; i < rows.size(); i++)
+            {
+                unsigned long row = rows[i];
+                if (!c->has(row))
+                    continue;
+
+                column.Rows.push_back(i);
+                if (c->components() > 0)
+                    column.Floats.insert(column.Floats.end(), c->floats() + row * c->components(), c->floats() + (row + 1) * c->components());
+                else if (c->type() == RD_STRING)
+                    column.Integers.push_back(intern(store.dictionary().get(static_cast<StringDictionary::ID>(c->integers()[row]))));
+                else
+                    column.Integers.push_back(c->integers()[row]);
+            }
+
+            column.Header.Count = column.Rows.size();
+            columns.push_back(column);
+        }
+    }
+
+    void collectView(const char* name, bool node, std::vector<Column>& columns)
+    {
+        GraphModel* model = m_Graph->model();
+
+        Column column;
+        bool typed = false;
+
+        unsigned int i = 0;
+        auto add = [&](IVariable* value)
+        {
+            if (value != NULL && !typed)
+            {
+                column.Header.Type = value->type();
+                typed = true;
+            }
+
+            if (value != NULL && value->type() == column.Header.Type)
+            {
+                column.Rows.push_back(i);
+                switch (value->type())
+                {
+                case RD_STRING:  column.Integers.push_back(intern(static_cast<StringVariable*>(value)->value())); break;
+                case RD_INT:     column.Integers.push_back(static_cast<IntVariable*>(value)->value()); break;
+                case RD_BOOLEAN: column.Integers.push_back(static_cast<BooleanVariable*>(value)->value() ? 1 : 0); break;
+                case RD_FLOAT:   column.Floats.push_back(static_cast<FloatVariable*>(value)->value()); break;
+                case RD_VEC2:    for (int k = 0; k < 2; k++) column.Floats.push_back(static_cast<Vec2Variable*>(value)->value()[k]); break;
+                case RD_VEC3:    for (int k = 0; k < 3; k++) column.Floats.push_back(static_cast<Vec3Variable*>(value)->value()[k]); break;
+                case RD_VEC4:    for (int k = 0; k < 4; k++) column.Floats.push_back(static_cast<Vec4Variable*>(value)->value()[k]); break;
+                default:         column.Rows.pop_back(); break;
+                }
+            }
+
+            delete value;
+            i++;
+        };
+
+        if (node)
+            for (auto it = model->nodes_begin(); it != model->nodes_end(); ++it)
+                add(m_Graph->getNodeAttribute(it->id(), name));
+        else
+            for (auto it = model->edges_begin(); it != model->edges_end(); ++it)
+                add(m_Graph->getEdgeAttribute(it->id(), name));
+
+        if (column.Rows.empty())
+            return;
+
+        column.Header.Name = intern(name);
+        column.Header.Components = GraphSnapshotFormat::components(column.Header.Type);
+        column.Header.Reserved = 0;
+        column.Header.Count = column.Rows.size();
+        columns.push_back(column);
+    }
+
+    static const char* typeName(unsigned int type)
+    {
+        switch (type)
+        {
+        case RD_STRING:  return "string";
+        case RD_INT:     return "int";
+        case RD_FLOAT:   return "float";
+        case RD_BOOLEAN: return "bool";
+        case RD_VEC2:    return "vec2";
+        case RD_VEC3:    return "vec3";
+        case RD_VEC4:    return "vec4";
+        default:         return NULL;
+        }
+    }
+
+    // Sections of a snapshot, pointing into the mapped file
+    struct ColumnSection
+    {
+        const ColumnHeader* Header;
+        const unsigned int* Rows;
+        const float* Floats;
+        const long long* Integers;
+    };
+
+    struct ArraySection
+    {
+        const ArrayHeader* Header;
+        const float* Values;
+    };
+
+    bool read(const char* data, unsigned long long size)
+    {
+        // NOTE : Every section is validated before the graph is touched, a corrupted file leaves it unchanged
+
+        Reader reader(data, size);
+
+        const Header* header = reader.take<Header>(1);
+        if (header == NULL || memcmp(header->Magic, "OGS", 4) != 0 || header->Version != Version)
+            return false;
+
+        const unsigned long long* offsets = reader.take<unsigned long long>(header->StringCount + 1);
+        if (offsets == NULL)
+            return false;
+        const char* characters = reader.take<char>(offsets[header->StringCount]);
+        if (characters == NULL)
+            return false;
+
+        std::vector<std::string> strings(header->StringCount);
+        for (unsigned long i = 0; i < header->StringCount; i++)
+        {
+            if (offsets[i] > offsets[i + 1])
+                return false;
+            strings[i].assign(characters + offsets[i], offsets[i + 1] - offsets[i]);
+        }
+
+        const unsigned int* labels = reader.take<unsigned int>(header->NodeCount);
+        const unsigned int* node1s = reader.take<unsigned int>(header->EdgeCount);
+        const unsigned int* node2s = reader.take<unsigned int>(header->EdgeCount);
+        if (labels == NULL || node1s == NULL || node2s == NULL)
+            return false;
+
+        std::vector<std::string> nodeLabels(header->NodeCount);
+        for (unsigned long i = 0; i < header->NodeCount; i++)
+        {
+            if (labels[i] >= strings.size())
+                return false;
+            nodeLabels[i] = strings[labels[i]];
+        }
+
+        for (unsigned long i = 0; i < header->EdgeCount; i++)
+            if (node1s[i] >= header->NodeCount || node2s[i] >= header->NodeCount)
+                return false;
+
+        std::vector<ColumnSection> columns(header->NodeColumnCount + header->EdgeColumnCount);
+        for (unsigned long c = 0; c < columns.size(); c++)
+        {
+            bool node = c < header->NodeColumnCount;
+
+            const ColumnHeader* column = reader.take<ColumnHeader>(1);
+            if (column == NULL || column->Name >= strings.size() || typeName(column->Type) == NULL)
+                return false;
+            if (column->Components != GraphSnapshotFormat::components(column->Type))
+                return false;
+
+            unsigned int n = column->Components;
+            columns[c].Header = column;
+            columns[c].Rows = reader.take<unsigned int>(column->Count);
+            columns[c].Floats = reader.take<float>(column->Count * n);
+            columns[c].Integers = reader.take<long long>(n == 0 ? column->Count : 0);
+            if (columns[c].Rows == NULL || columns[c].Floats == NULL || columns[c].Integers == NULL)
+                return false;
+
+            for (unsigned long i = 0; i < column->Count; i++)
+                if (columns[c].Rows[i] >= (node ? header->NodeCount : header->EdgeCount) || (column->Type == RD_STRING && static_cast<unsigned long long>(columns[c].Integers[i]) >= strings.size()))
+                    return false;
+        }
+
+        std::vector<ArraySection> arrays(header->ArrayCount);
+        for (unsigned long a = 0; a < arrays.size(); a++)
+        {
+            arrays[a].Header = reader.take<ArrayHeader>(1);
+            if (arrays[a].Header == NULL || arrays[a].Header->Name >= strings.size())
+                return false;
+            arrays[a].Values = reader.take<float>(arrays[a].Header->Count);
+            if (arrays[a].Values == NULL || arrays[a].Header->Count != header->NodeCount * arrays[a].Header->Components)
+                return false;
+        }
+
+        // ----- Nodes -----
+
+        unsigned long base = m_Graph->countNodes();
+        std::vector<Node::ID> nodes = m_Graph->addNodes(nodeLabels);
+
+        // ----- Edges -----
+
+        std::vector<Node::ID> uid1s(header->EdgeCount);
+        std::vector<Node::ID> uid2s(header->EdgeCount);
+        for (unsigned long i = 0; i < header->EdgeCount; i++)
+        {
+            uid1s[i] = nodes[node1s[i]];
+            uid2s[i] = nodes[node2s[i]];
+        }
+
+        std::vector<Edge::ID> edges = m_Graph->addEdges(uid1s, uid2s);
+
+        // ----- Attributes -----
+
+        for (unsigned long c = 0; c < columns.size(); c++)
+        {
+            bool node = c < header->NodeColumnCount;
+
+            const ColumnHeader* column = columns[c].Header;
+            const unsigned int* rows = columns[c].Rows;
+            const float* floats = columns[c].Floats;
+            const long long* integers = columns[c].Integers;
+
+            unsigned int n = column->Components;
+            const std::string& name = strings[column->Name];
+            const char* type = typeName(column->Type);
+
+            // NOTE : Node::ID and Edge::ID are the same type, so both go through the same batches
+            const std::vector<unsigned long>& elements = node ? nodes : edges;
+            std::vector<unsigned long> ids(column->Count);
+            for (unsigned long i = 0; i < column->Count; i++)
+                ids[i] = elements[rows[i]];
+
+            GraphAttribute::ID handle = node ? m_Graph->registerNodeAttribute(name.c_str(), type) : m_Graph->registerEdgeAttribute(name.c_str(), type);
+
+            if (column->Type == RD_STRING)
+            {
+                std::vector<std::string> values(column->Count);
+                for (unsigned long i = 0; i < column->Count; i++)
+                    values[i] = strings[integers[i]];
+
+                if (node)
+                    m_Graph->setNodeAttributes(ids, handle, values);
+                else
+                    m_Graph->setEdgeAttributes(ids, handle, values);
+            }
+            else
+            {
+                std::vector<double> values;
+                if (n > 0)
+                    values.assign(floats, floats + column->Count * n);
+                else
+                    values.assign(integers, integers + column->Count);
+
+                if (node)
+                    m_Graph->setNodeAttributes(ids, handle, values);
+                else
+                    m_Graph->setEdgeAttributes(ids, handle, values);
+            }
+        }
+
+        // ----- View Arrays -----
+
+        for (auto& array : arrays)
+        {
+            const char* name = strings[array.Header->Name].c_str();
+
+            std::vector<float> data;
+            unsigned int components = m_Graph->readNodeArray(name, data);
+            if (components == 0 || components != array.Header->Components)
+                continue;
+            if ((base + nodes.size()) * components != data.size())
+                continue;
+
+            memcpy(&data[base * components], array.Values, array.Header->Count * sizeof(float));
+            m_Graph->writeNodeArray(name, data);
+        }
+
+        LOG("[SNAPSHOT] Loaded %lu nodes and %lu edges.\n", nodes.size(), edges.size());
+        return true;
+    }
+
+    GraphEntity* m_Graph;
+
+    std::vector<std::string> m_Strings;
+    std::unordered_map<std::string, unsigned int> m_StringIndex;
+};
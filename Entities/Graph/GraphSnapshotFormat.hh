@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+#ifndef OG_HEADLESS
+# include <raindance/Core/Variables.hh>
+#endif
+
+// Versioned binary graph snapshot (.ogs) layout, shared by GraphSnapshot and the headless layout tool.
+//
+// Layout, every array is padded to 8 bytes :
+//   Header
+//   String offsets (uint64, StringCount + 1), string characters
+//   Node labels (uint32 string index, NodeCount)
+//   Edge endpoints (uint32 node index, EdgeCount), twice
+//   Node columns then edge columns : ColumnHeader, rows (uint32), values
+//     (float * components for float and vectors, int64 otherwise, string index for strings)
+//     The header repeats the number of floats per value, so readers can skip columns without knowing the types.
+//   View arrays : ArrayHeader, float values
+//
+// Nodes and edges are referenced by their index in the model iteration order, so a
+// snapshot is independent from the IDs of the graph it was saved from.
+namespace GraphSnapshotFormat
+{
+    static const unsigned int Version = 2;
+
+    struct Header
+    {
+        char Magic[4];
+        unsigned int Version;
+        unsigned long long NodeCount;
+        unsigned long long EdgeCount;
+        unsigned long long StringCount;
+        unsigned long long NodeColumnCount;
+        unsigned long long EdgeColumnCount;
+        unsigned long long ArrayCount;
+    };
+
+    struct ColumnHeader
+    {
+        unsigned int Name;
+        unsigned int Type;
+        unsigned long long Count;
+        unsigned int Components; // NOTE : Floats per value, 0 for the integer backed types
+        unsigned int Reserved;
+    };
+
+    struct ArrayHeader
+    {
+        unsigned int Name;
+        unsigned int Components;
+        unsigned long long Count;
+    };
+
+#ifndef OG_HEADLESS
+    // Number of floats per value of a column, 0 for the integer backed types
+    inline unsigned int components(unsigned int type)
+    {
+        switch (type)
+        {
+        case RD_FLOAT: return 1;
+        case RD_VEC2:  return 2;
+        case RD_VEC3:  return 3;
+        case RD_VEC4:  return 4;
+        default:       return 0;
+        }
+    }
+#endif
+
+    class Writer
+    {
+    public:
+        Writer(FILE* file) : m_File(file), m_Size(0) {}
+
+        void write(const void* data, unsigned long size)
+        {
+            fwrite(data, 1, size, m_File);
+            advance(size);
+        }
+
+        template <typename T>
+        void write(const std::vector<T>& values)
+        {
+            write(values.data(), values.size() * sizeof(T));
+        }
+
+        // Accounts for data written directly and pads to 8 bytes
+        void advance(unsigned long size)
+        {
+            static const char zeros[8] = { 0 };
+            m_Size += size;
+            unsigned long padding = (8 - (m_Size & 7)) & 7;
+            fwrite(zeros, 1, padding, m_File);
+            m_Size += padding;
+        }
+
+    private:
+        FILE* m_File;
+        unsigned long long m_Size;
+    };
+
+    // Bounds checked cursor over the mapped file
+    class Reader
+    {
+    public:
+        Reader(const char* data, unsigned long long size) : m_Data(data), m_Size(size), m_Position(0) {}
+
+        template <typename T>
+        const T* take(unsigned long long count)
+        {
+            unsigned long long size = count * sizeof(T);
+            if (m_Position + size > m_Size || size / sizeof(T) != count)
+                return NULL;
+            const T* result = reinterpret_cast<const T*>(m_Data + m_Position);
+            m_Position += (size + 7) & ~7ULL;
+            return result;
+        }
+
+        inline unsigned long long position() const { return m_Position; }
+
+    private:
+        const char* m_Data;
+        unsigned long long m_Size;
+        unsigned long long m_Position;
+    };
+}
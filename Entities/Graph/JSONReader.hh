@@ -0,0 +1,374 @@
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Streaming pull tokenizer over a JSON file. Only the current token is held in memory,
+// so arbitrarily large exports can be read with a fixed size read buffer.
+class JSONReader
+{
+public:
+    enum Token { END, ERROR, OBJECT_BEGIN, OBJECT_END, ARRAY_BEGIN, ARRAY_END, KEY, STRING, NUMBER, TRUE, FALSE, NULL_VALUE };
+
+    JSONReader()
+    {
+        m_File = NULL;
+        m_Buffer.resize(1 << 20);
+        m_Position = 0;
+        m_Size = 0;
+        m_Offset = 0;
+    }
+
+    ~JSONReader()
+    {
+        close();
+    }
+
+    bool open(const char* path)
+    {
+        close();
+        m_File = fopen(path, "rb");
+        return m_File != NULL;
+    }
+
+    void close()
+    {
+        if (m_File != NULL)
+            fclose(m_File);
+        m_File = NULL;
+        m_Position = m_Size = 0;
+        m_Offset = 0;
+    }
+
+    // Returns the next token, separators are consumed silently.
+    // A string followed by ':' is returned as a KEY.
+    Token next()
+    {
+        int c = skipSeparators();
+
+        switch (c)
+        {
+        case EOF: return END;
+        case '{': get(); return OBJECT_BEGIN;
+        case '}': get(); return OBJECT_END;
+        case '[': get(); return ARRAY_BEGIN;
+        case ']': get(); return ARRAY_END;
+        case '"':
+            get();
+            if (!readString())
+                return ERROR;
+            if (skipWhitespaces() == ':')
+            {
+                get();
+                return KEY;
+            }
+            return STRING;
+        case 't': return readLiteral("true") ? TRUE : ERROR;
+        case 'f': return readLiteral("false") ? FALSE : ERROR;
+        case 'n': return readLiteral("null") ? NULL_VALUE : ERROR;
+        default:
+            if (c == '-' || (c >= '0' && c <= '9'))
+                return readNumber() ? NUMBER : ERROR;
+            return ERROR;
+        }
+    }
+
+    // Skips the rest of a value whose first token was just returned by next().
+    bool skip(Token first)
+    {
+        if (first != OBJECT_BEGIN && first != ARRAY_BEGIN)
+            return first != ERROR && first != END;
+
+        unsigned long depth = 1;
+        while (depth > 0)
+        {
+            Token token = next();
+            if (token == OBJECT_BEGIN || token == ARRAY_BEGIN)
+                depth++;
+            else if (token == OBJECT_END || token == ARRAY_END)
+                depth--;
+            else if (token == ERROR || token == END)
+                return false;
+        }
+        return true;
+    }
+
+    // Text of the last KEY, STRING or NUMBER token, strings are unescaped.
+    inline const std::string& text() const { return m_Text; }
+
+    // Whether the last NUMBER token has a fraction or an exponent.
+    inline bool isReal() const { return m_Text.find_first_of(".eE") != std::string::npos; }
+
+    inline unsigned long long offset() const { return m_Offset + m_Position; }
+
+private:
+    inline int peek()
+    {
+        if (m_Position == m_Size && !fill())
+            return EOF;
+        return static_cast<unsigned char>(m_Buffer[m_Position]);
+    }
+
+    inline int get()
+    {
+        int c = peek();
+        if (c != EOF)
+            m_Position++;
+        return c;
+    }
+
+    bool fill()
+    {
+        if (m_File == NULL)
+            return false;
+        m_Offset += m_Size;
+        m_Size = fread(&m_Buffer[0], 1, m_Buffer.size(), m_File);
+        m_Position = 0;
+        return m_Size > 0;
+    }
+
+    int skipWhitespaces()
+    {
+        int c = peek();
+        while (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+        {
+            m_Position++;
+            c = peek();
+        }
+        return c;
+    }
+
+    int skipSeparators()
+    {
+        int c = skipWhitespaces();
+        while (c == ',' || c == ':')
+        {
+            m_Position++;
+            c = skipWhitespaces();
+        }
+        return c;
+    }
+
+    bool readLiteral(const char* literal)
+    {
+        for (const char* l = literal; *l != '\0'; l++)
+            if (get() != *l)
+                return false;
+        return true;
+    }
+
+    bool readNumber()
+    {
+        m_Text.clear();
+        int c = peek();
+        while (c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E' || (c >= '0' && c <= '9'))
+        {
+            m_Text.push_back(static_cast<char>(c));
+            m_Position++;
+            c = peek();
+        }
+        return !m_Text.empty();
+    }
+
+    bool readString()
+    {
+        m_Text.clear();
+
+        while (true)
+        {
+            // NOTE : Copy unescaped runs straight from the buffer
+            unsigned long start = m_Position;
+            while (m_Position < m_Size && m_Buffer[m_Position] != '"' && m_Buffer[m_Position] != '\\')
+                m_Position++;
+            m_Text.append(&m_Buffer[0] + start, m_Position - start);
+
+            int c = get();
+            if (c == EOF)
+                return false;
+            if (c == '"')
+                return true;
+            if (c != '\\')
+            {
+                m_Position--;
+                continue;
+            }
+
+            c = get();
+            switch (c)
+            {
+            case '"': case '\\': case '/': m_Text.push_back(static_cast<char>(c)); break;
+            case 'b': m_Text.push_back('\b'); break;
+            case 'f': m_Text.push_back('\f'); break;
+            case 'n': m_Text.push_back('\n'); break;
+            case 'r': m_Text.push_back('\r'); break;
+            case 't': m_Text.push_back('\t'); break;
+            case 'u':
+                {
+                    unsigned long code = readHex();
+                    if (code >= 0xD800 && code <= 0xDBFF && get() == '\\' && get() == 'u')
+                        code = 0x10000 + ((code - 0xD800) << 10) + (readHex() - 0xDC00);
+                    appendUTF8(code);
+                }
+                break;
+            default:
+                return false;
+            }
+        }
+    }
+
+    unsigned long readHex()
+    {
+        unsigned long code = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            int c = get();
+            code <<= 4;
+            if (c >= '0' && c <= '9')
+                code |= c - '0';
+            else if (c >= 'a' && c <= 'f')
+                code |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F')
+                code |= c - 'A' + 10;
+        }
+        return code;
+    }
+
+    void appendUTF8(unsigned long code)
+    {
+        if (code < 0x80)
+            m_Text.push_back(static_cast<char>(code));
+        else if (code < 0x800)
+        {
+            m_Text.push_back(static_cast<char>(0xC0 | (code >> 6)));
+            m_Text.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+        else if (code < 0x10000)
+        {
+            m_Text.push_back(static_cast<char>(0xE0 | (code >> 12)));
+            m_Text.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            m_Text.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+        else
+        {
+            m_Text.push_back(static_cast<char>(0xF0 | (code >> 18)));
+            m_Text.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+            m_Text.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            m_Text.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+    }
+
+    FILE* m_File;
+    std::vector<char> m_Buffer;
+    unsigned long m_Position;
+    unsigned long m_Size;
+    unsigned long long m_Offset;
+    std::string m_Text;
+};
+
+// Attribute value as found in the JSON format, typed like Scripts/standard.py::get_attribute_info.
+struct JSONAttribute
+{
+    std::string Type;
+    std::string Text; // Attribute string form ("x y z" for vectors)
+    double Numbers[4];
+    unsigned int Count;
+
+    // Reads the value starting at 'first', returns false (with the value skipped) if it has no attribute type.
+    bool read(JSONReader& reader, JSONReader::Token first)
+    {
+        Count = 0;
+
+        switch (first)
+        {
+        case JSONReader::STRING:
+            Type = "string";
+            Text = reader.text();
+            return true;
+        case JSONReader::TRUE:
+        case JSONReader::FALSE:
+            Type = "bool";
+            Text = first == JSONReader::TRUE ? "true" : "false";
+            Numbers[Count++] = first == JSONReader::TRUE ? 1.0 : 0.0;
+            return true;
+        case JSONReader::NUMBER:
+            Type = reader.isReal() ? "float" : "int";
+            Text = reader.text();
+            Numbers[Count++] = strtod(Text.c_str(), NULL);
+            return true;
+        case JSONReader::ARRAY_BEGIN:
+            {
+                Text.clear();
+                JSONReader::Token token;
+                while ((token = reader.next()) == JSONReader::NUMBER)
+                {
+                    if (Count == 4)
+                        break;
+                    if (Count > 0)
+                        Text.push_back(' ');
+                    Text.append(reader.text());
+                    Numbers[Count++] = strtod(reader.text().c_str(), NULL);
+                }
+
+                if (token == JSONReader::ARRAY_END && Count >= 2)
+                {
+                    Type = Count == 2 ? "vec2" : Count == 3 ? "vec3" : "vec4";
+                    return true;
+                }
+
+                if (token == JSONReader::OBJECT_BEGIN || token == JSONReader::ARRAY_BEGIN)
+                    reader.skip(token);
+                if (token != JSONReader::ARRAY_END)
+                    reader.skip(JSONReader::ARRAY_BEGIN);
+                return false;
+            }
+        default:
+            reader.skip(first);
+            return false;
+        }
+    }
+};
+
+// Value formatting shared by the JSON writers (GraphJSONWriter and graphiti-layout).
+namespace JSONWriter
+{
+    // NOTE : Floats always carry a fraction so they are read back as floats, NaN and infinities have no JSON form and become null
+    inline void number(FILE* file, float value)
+    {
+        char text[32];
+        if (!std::isfinite(value))
+            strcpy(text, "null");
+        else
+        {
+            snprintf(text, sizeof(text), "%.9g", value);
+            if (strpbrk(text, ".eE") == NULL)
+                strcat(text, ".0");
+        }
+        fputs(text, file);
+    }
+
+    inline void string(FILE* file, const std::string& value)
+    {
+        fputc('"', file);
+        for (auto c : value)
+        {
+            switch (c)
+            {
+            case '"':  fputs("\\\"", file); break;
+            case '\\': fputs("\\\\", file); break;
+            case '\n': fputs("\\n", file); break;
+            case '\r': fputs("\\r", file); break;
+            case '\t': fputs("\\t", file); break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                    fprintf(file, "\\u%04x", static_cast<unsigned char>(c));
+                else
+                    fputc(c, file);
+            }
+        }
+        fputc('"', file);
+    }
+}
@@ -0,0 +1,79 @@
+#include "Headless.hh"
+
+// graphiti-layout : lays a JSON or snapshot graph out without a display and writes "og:space:position" back.
+// Links the layout engines only, no window, GL context or Python.
+
+static void usage()
+{
+	printf("Usage : graphiti-layout [options] <input.json|input.ogs> <output>\n");
+	printf("  -m, --method <forces|multilevel|stress>  Layout to run (default : forces)\n");
+	printf("  -n, --iterations <count>                 Stop after this many force iterations (default : until convergence)\n");
+	printf("  -t, --threads <count>                    Worker threads (default : all the cores)\n");
+	printf("      --tolerance <value>                  Convergence threshold, relative to the temperature (default : 0.01)\n");
+	printf("      --theta <value>                      Barnes-Hut opening angle (default : 0.8)\n");
+	printf("      --exact                              Exact O(n^2) repulsion instead of Barnes-Hut\n");
+	printf("The output has the format of the input.\n");
+}
+
+int main(int argc, char** argv)
+{
+	HeadlessLayout layout;
+	std::vector<const char*> files;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool value = i + 1 < argc;
+
+		if ((arg == "-m" || arg == "--method") && value)
+		{
+			std::string method = argv[++i];
+			if (method == "forces")
+				layout.setMethod(HeadlessLayout::FORCES);
+			else if (method == "multilevel")
+				layout.setMethod(HeadlessLayout::MULTILEVEL);
+			else if (method == "stress")
+				layout.setMethod(HeadlessLayout::STRESS);
+			else
+			{
+				usage();
+				return 1;
+			}
+		}
+		else if ((arg == "-n" || arg == "--iterations") && value)
+			layout.setIterations(strtoul(argv[++i], NULL, 10));
+		else if ((arg == "-t" || arg == "--threads") && value)
+			layout.setThreads(strtoul(argv[++i], NULL, 10));
+		else if (arg == "--tolerance" && value)
+			layout.setTolerance(strtod(argv[++i], NULL));
+		else if (arg == "--theta" && value)
+			layout.setTheta(strtod(argv[++i], NULL));
+		else if (arg == "--exact")
+			layout.setExact(true);
+		else if (arg == "-h" || arg == "--help")
+		{
+			usage();
+			return 0;
+		}
+		else if (arg[0] != '-')
+			files.push_back(argv[i]);
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+
+	if (files.size() != 2)
+	{
+		usage();
+		return 1;
+	}
+
+	if (!layout.load(files[0]))
+		return 1;
+
+	layout.run();
+
+	return layout.save(files[1]) ? 0 : 1;
+}
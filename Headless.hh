@@ -0,0 +1,708 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/resource.h>
+# include <sys/stat.h>
+#endif
+
+#include <graphiti/Layout/Headers.hh>
+
+#include <graphiti/Entities/Graph/JSONReader.hh>
+#include <graphiti/Entities/Graph/GraphSnapshotFormat.hh>
+#include <graphiti/Visualizers/Space/SpaceLayout.hh>
+
+// Lays a graph file out without a window or a GL context, for batch servers (see Headless.cc).
+// Only the node ids, the edge endpoints and the existing "og:space:position" values are read, the space
+// layout then runs on all the cores and the input is written back with the new positions.
+// JSON files are streamed through again (everything else is kept as is), snapshots get their
+// position array replaced.
+class HeadlessLayout
+{
+public:
+    enum Method { FORCES, MULTILEVEL, STRESS };
+
+    HeadlessLayout()
+    {
+        m_Method = FORCES;
+        m_Iterations = 0;
+        m_Tolerance = 0.01f;
+        m_Threads = 0;
+        m_Theta = 0.8f;
+        m_Exact = false;
+
+        m_Snapshot = false;
+        m_Nodes = 0;
+        m_HasPositions = false;
+
+        m_Data = NULL;
+        m_Size = 0;
+        m_Header = NULL;
+        m_Begin = 0;
+        m_End = 0;
+
+        m_Output = NULL;
+        m_Value = false;
+    }
+
+    ~HeadlessLayout()
+    {
+        unmap();
+    }
+
+    inline void setMethod(Method method) { m_Method = method; }
+    // 0 runs until convergence. With the multilevel and stress methods, force iterations refining its result.
+    inline void setIterations(unsigned long iterations) { m_Iterations = iterations; }
+    inline void setTolerance(float tolerance) { m_Tolerance = tolerance; }
+    // 0 uses all the cores
+    inline void setThreads(unsigned int threads) { m_Threads = threads; }
+    inline void setTheta(float theta) { m_Theta = theta; }
+    inline void setExact(bool exact) { m_Exact = exact; }
+
+    bool load(const char* path)
+    {
+        m_Input = path;
+
+        auto start = std::chrono::steady_clock::now();
+
+        FILE* file = fopen(path, "rb");
+        if (file == NULL)
+        {
+            LOG("[LAYOUT] Couldn't open '%s'!\n", path);
+            return false;
+        }
+        char magic[4] = { 0 };
+        m_Snapshot = fread(magic, 1, 4, file) == 4 && memcmp(magic, "OGS", 4) == 0;
+        fclose(file);
+
+        bool ok = m_Snapshot ? loadSnapshot(path) : loadJSON(path);
+        if (!ok)
+            return false;
+
+        if (!m_HasPositions)
+        {
+            // NOTE : Same volume as the space forces, the graph should fit in a 20 * 20 * 20 cube
+            m_Positions.resize(m_Nodes);
+            for (auto& position : m_Positions)
+                position = 20.0f * glm::vec3(random() - 0.5f, random() - 0.5f, random() - 0.5f);
+        }
+
+        LOG("[LAYOUT] Loaded %lu nodes and %lu edges in %.2f s%s.\n", m_Nodes, m_Links.size() / 2, seconds(start), m_HasPositions ? ", starting from their positions" : "");
+        usage();
+        return true;
+    }
+
+    void run()
+    {
+        if (m_Nodes == 0)
+            return;
+
+        auto start = std::chrono::steady_clock::now();
+
+        SpaceLayout layout;
+        layout.setThreads(m_Threads);
+        layout.setRepulsion(m_Exact ? NodeRepulsionForce::EXACT : NodeRepulsionForce::BARNES_HUT);
+        layout.setTheta(m_Theta);
+        layout.setTolerance(m_Tolerance);
+        layout.setMaxIterations(m_Iterations);
+
+        for (unsigned long n = 0; n < m_Nodes; n++)
+            layout.addNode(n, m_Positions[n]);
+        for (unsigned long l = 0; l < m_Links.size(); l += 2)
+            layout.addEdge(l / 2, m_Links[l], m_Links[l + 1]);
+
+        if (m_Method == MULTILEVEL)
+            layout.multilevel();
+        else if (m_Method == STRESS)
+            layout.stress();
+        if (m_Method == FORCES || m_Iterations > 0)
+            layout.play();
+
+        // NOTE : The worker publishes a frame per iteration, only the last one of the run matters
+        auto report = std::chrono::steady_clock::now();
+        while (true)
+        {
+            if (layout.update())
+            {
+                const SpaceLayout::Frame& frame = layout.frame();
+                if (frame.Sequence == layout.sequence() && !frame.Playing)
+                    break;
+
+                if (seconds(report) >= 1.0)
+                {
+                    LOG("[LAYOUT] Iteration %lu, energy %f, displacement %f\n", frame.Iteration, frame.Energy, frame.Displacement);
+                    report = std::chrono::steady_clock::now();
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        const SpaceLayout::Frame& frame = layout.frame();
+        for (unsigned long b = 0; b < frame.IDs.size(); b++)
+            m_Positions[frame.IDs[b]] = frame.Positions[b];
+
+        double elapsed = seconds(start);
+        LOG("[LAYOUT] %s layout : %lu iterations in %.2f s (%.1f iterations/s)%s.\n",
+            m_Method == MULTILEVEL ? "Multilevel" : m_Method == STRESS ? "Stress" : "Force", frame.Iteration, elapsed, elapsed > 0 ? frame.Iteration / elapsed : 0.0,
+            frame.Converged ? ", converged" : "");
+        usage();
+    }
+
+    bool save(const char* path)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        // NOTE : The output is written next to its destination and renamed over it once complete, the input
+        // can be the same file and is still read (JSON) or mapped (snapshot) while saving.
+        std::string temporary = std::string(path) + ".tmp";
+
+        m_Output = fopen(temporary.c_str(), "wb");
+        if (m_Output == NULL)
+        {
+            LOG("[LAYOUT] Couldn't open '%s' for writing!\n", temporary.c_str());
+            return false;
+        }
+
+        std::vector<char> buffer(1 << 20);
+        setvbuf(m_Output, &buffer[0], _IOFBF, buffer.size());
+
+        bool ok = m_Snapshot ? saveSnapshot() : saveJSON();
+        ok = ferror(m_Output) == 0 && ok;
+        fclose(m_Output);
+        m_Output = NULL;
+
+        if (!ok)
+        {
+            LOG("[LAYOUT] Couldn't write '%s'!\n", temporary.c_str());
+            remove(temporary.c_str());
+            return false;
+        }
+
+#ifdef _WIN32
+        remove(path); // NOTE : rename doesn't replace an existing file on Windows
+#endif
+        if (rename(temporary.c_str(), path) != 0)
+        {
+            LOG("[LAYOUT] Couldn't rename '%s' to '%s'!\n", temporary.c_str(), path);
+            remove(temporary.c_str());
+            return false;
+        }
+
+        LOG("[LAYOUT] Saved '%s' in %.2f s.\n", path, seconds(start));
+        return true;
+    }
+
+private:
+    // View array of an input snapshot, copied as is unless it holds the positions
+    struct Array
+    {
+        std::string Name;
+        const GraphSnapshotFormat::ArrayHeader* Header;
+        const float* Values;
+    };
+
+    static inline float random() { return (float) rand() / RAND_MAX; }
+
+    static double seconds(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    static void usage()
+    {
+#ifndef _WIN32
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0)
+            LOG("[LAYOUT] Peak RSS : %ld MB\n", usage.ru_maxrss / 1024);
+#endif
+    }
+
+    // ----- JSON -----
+
+    bool loadJSON(const char* path)
+    {
+        JSONReader reader;
+        if (!reader.open(path))
+        {
+            LOG("[LAYOUT] Couldn't open '%s'!\n", path);
+            return false;
+        }
+
+        std::unordered_map<std::string, unsigned int> nodes;
+        m_Nodes = 0;
+        m_HasPositions = true;
+
+        bool ok = reader.next() == JSONReader::OBJECT_BEGIN;
+
+        JSONReader::Token token;
+        while (ok && (token = reader.next()) == JSONReader::KEY)
+        {
+            std::string section = reader.text();
+            JSONReader::Token first = reader.next();
+
+            if (section == "nodes" && first == JSONReader::ARRAY_BEGIN)
+            {
+                while (ok && (token = reader.next()) == JSONReader::OBJECT_BEGIN)
+                    ok = readNode(reader, nodes);
+                ok = ok && token == JSONReader::ARRAY_END;
+            }
+            else if (section == "edges" && first == JSONReader::ARRAY_BEGIN)
+            {
+                while (ok && (token = reader.next()) == JSONReader::OBJECT_BEGIN)
+                    ok = readEdge(reader, nodes);
+                ok = ok && token == JSONReader::ARRAY_END;
+            }
+            else
+                ok = reader.skip(first);
+        }
+
+        if (!ok)
+        {
+            LOG("[LAYOUT] Parse error around byte %llu!\n", reader.offset());
+            return false;
+        }
+
+        // NOTE : Start from the existing positions only when every node has one
+        m_HasPositions = m_HasPositions && m_Nodes > 0;
+        return true;
+    }
+
+    bool readNode(JSONReader& reader, std::unordered_map<std::string, unsigned int>& nodes)
+    {
+        JSONAttribute attribute;
+        bool placed = false;
+
+        JSONReader::Token token;
+        while ((token = reader.next()) == JSONReader::KEY)
+        {
+            std::string name = reader.text();
+            JSONReader::Token first = reader.next();
+
+            if (name == "id" && (first == JSONReader::STRING || first == JSONReader::NUMBER))
+                nodes[reader.text()] = m_Nodes;
+            else if (name == "og:space:position" && attribute.read(reader, first) && attribute.Count == 3)
+            {
+                m_Positions.resize(m_Nodes + 1);
+                m_Positions[m_Nodes] = glm::vec3(attribute.Numbers[0], attribute.Numbers[1], attribute.Numbers[2]);
+                placed = true;
+            }
+            else if (name != "og:space:position" && !reader.skip(first))
+                return false;
+        }
+
+        m_HasPositions = m_HasPositions && placed;
+        m_Nodes++;
+        return token == JSONReader::OBJECT_END;
+    }
+
+    bool readEdge(JSONReader& reader, std::unordered_map<std::string, unsigned int>& nodes)
+    {
+        std::string source;
+        std::string target;
+
+        JSONReader::Token token;
+        while ((token = reader.next()) == JSONReader::KEY)
+        {
+            std::string name = reader.text();
+            JSONReader::Token first = reader.next();
+            bool scalar = first == JSONReader::STRING || first == JSONReader::NUMBER;
+
+            if ((name == "src" || name == "source") && scalar)
+                source = reader.text();
+            else if ((name == "dst" || name == "target") && scalar)
+                target = reader.text();
+            else if (!reader.skip(first))
+                return false;
+        }
+
+        auto it1 = nodes.find(source);
+        auto it2 = nodes.find(target);
+        if (it1 != nodes.end() && it2 != nodes.end())
+        {
+            m_Links.push_back(it1->second);
+            m_Links.push_back(it2->second);
+        }
+
+        return token == JSONReader::OBJECT_END;
+    }
+
+    // Streams the input again, node objects get their "og:space:position" replaced (or added)
+    bool saveJSON()
+    {
+        JSONReader reader;
+        if (!reader.open(m_Input.c_str()))
+            return false;
+
+        m_First.clear();
+        m_Value = false;
+
+        if (reader.next() != JSONReader::OBJECT_BEGIN)
+            return false;
+        open('{');
+
+        unsigned long node = 0;
+
+        JSONReader::Token token;
+        while ((token = reader.next()) == JSONReader::KEY)
+        {
+            std::string section = reader.text();
+            JSONReader::Token first = reader.next();
+            key(section);
+
+            if (section != "nodes" || first != JSONReader::ARRAY_BEGIN)
+            {
+                if (!copy(reader, first))
+                    return false;
+                continue;
+            }
+
+            open('[');
+            while ((token = reader.next()) == JSONReader::OBJECT_BEGIN)
+            {
+                open('{');
+                while ((token = reader.next()) == JSONReader::KEY)
+                {
+                    std::string name = reader.text();
+                    first = reader.next();
+
+                    if (name == "og:space:position")
+                    {
+                        if (!reader.skip(first))
+                            return false;
+                        continue;
+                    }
+
+                    key(name);
+                    if (!copy(reader, first))
+                        return false;
+                }
+                if (token != JSONReader::OBJECT_END || node >= m_Nodes)
+                    return false;
+
+                key("og:space:position");
+                open('[');
+                for (unsigned int i = 0; i < 3; i++)
+                    number(m_Positions[node][i]);
+                close(']');
+
+                close('}');
+                node++;
+            }
+            if (token != JSONReader::ARRAY_END)
+                return false;
+            close(']');
+        }
+        if (token != JSONReader::OBJECT_END)
+            return false;
+        close('}');
+        fputc('\n', m_Output);
+
+        return true;
+    }
+
+    // Writes the value starting at 'first' back out, compacted
+    bool copy(JSONReader& reader, JSONReader::Token first)
+    {
+        JSONReader::Token token;
+
+        switch (first)
+        {
+        case JSONReader::OBJECT_BEGIN:
+            open('{');
+            while ((token = reader.next()) == JSONReader::KEY)
+            {
+                key(reader.text());
+                if (!copy(reader, reader.next()))
+                    return false;
+            }
+            if (token != JSONReader::OBJECT_END)
+                return false;
+            close('}');
+            return true;
+        case JSONReader::ARRAY_BEGIN:
+            open('[');
+            while ((token = reader.next()) != JSONReader::ARRAY_END)
+                if (!copy(reader, token))
+                    return false;
+            close(']');
+            return true;
+        case JSONReader::STRING:
+            separate();
+            string(reader.text());
+            return true;
+        case JSONReader::NUMBER:
+            separate();
+            fputs(reader.text().c_str(), m_Output);
+            return true;
+        case JSONReader::TRUE:
+        case JSONReader::FALSE:
+        case JSONReader::NULL_VALUE:
+            separate();
+            fputs(first == JSONReader::TRUE ? "true" : first == JSONReader::FALSE ? "false" : "null", m_Output);
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // NOTE : The reader drops the separators, commas go before every member but the first of each container
+    void separate()
+    {
+        if (m_Value)
+        {
+            m_Value = false;
+            return;
+        }
+        if (!m_First.empty() && !m_First.back())
+            fputc(',', m_Output);
+        if (!m_First.empty())
+            m_First.back() = false;
+    }
+
+    void open(char c)
+    {
+        separate();
+        fputc(c, m_Output);
+        m_First.push_back(true);
+    }
+
+    void close(char c)
+    {
+        m_First.pop_back();
+        fputc(c, m_Output);
+    }
+
+    void key(const std::string& name)
+    {
+        separate();
+        string(name);
+        fputc(':', m_Output);
+        m_Value = true;
+    }
+
+    void number(float value)
+    {
+        separate();
+        JSONWriter::number(m_Output, value);
+    }
+
+    void string(const std::string& value)
+    {
+        JSONWriter::string(m_Output, value);
+    }
+
+    // ----- Snapshot -----
+
+    bool loadSnapshot(const char* path)
+    {
+#ifdef _WIN32
+        LOG("[LAYOUT] Snapshots are not supported on this platform!\n");
+        (void) path;
+        return false;
+#else
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+        {
+            LOG("[LAYOUT] Couldn't open '%s'!\n", path);
+            return false;
+        }
+
+        struct stat st;
+        void* data = MAP_FAILED;
+        if (fstat(fd, &st) == 0)
+            data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED)
+        {
+            LOG("[LAYOUT] Couldn't map '%s'!\n", path);
+            return false;
+        }
+
+        m_Data = static_cast<const char*>(data);
+        m_Size = st.st_size;
+
+        if (!parseSnapshot())
+        {
+            LOG("[LAYOUT] '%s' is corrupted or has an unsupported version!\n", path);
+            return false;
+        }
+        return true;
+#endif
+    }
+
+    void unmap()
+    {
+#ifndef _WIN32
+        if (m_Data != NULL)
+            munmap(const_cast<char*>(m_Data), m_Size);
+#endif
+        m_Data = NULL;
+        m_Size = 0;
+    }
+
+    // NOTE : Only the edge endpoints and the view arrays are needed, the columns are skipped and copied back as is
+    bool parseSnapshot()
+    {
+        GraphSnapshotFormat::Reader reader(m_Data, m_Size);
+
+        m_Header = reader.take<GraphSnapshotFormat::Header>(1);
+        if (m_Header == NULL || memcmp(m_Header->Magic, "OGS", 4) != 0 || m_Header->Version != GraphSnapshotFormat::Version)
+            return false;
+
+        const unsigned long long* offsets = reader.take<unsigned long long>(m_Header->StringCount + 1);
+        if (offsets == NULL)
+            return false;
+        const char* characters = reader.take<char>(offsets[m_Header->StringCount]);
+        if (characters == NULL)
+            return false;
+
+        m_Strings.resize(m_Header->StringCount);
+        for (unsigned long i = 0; i < m_Header->StringCount; i++)
+        {
+            if (offsets[i] > offsets[i + 1])
+                return false;
+            m_Strings[i].assign(characters + offsets[i], offsets[i + 1] - offsets[i]);
+        }
+
+        m_Begin = reader.position();
+
+        const unsigned int* labels = reader.take<unsigned int>(m_Header->NodeCount);
+        const unsigned int* node1s = reader.take<unsigned int>(m_Header->EdgeCount);
+        const unsigned int* node2s = reader.take<unsigned int>(m_Header->EdgeCount);
+        if (labels == NULL || node1s == NULL || node2s == NULL)
+            return false;
+
+        m_Nodes = m_Header->NodeCount;
+        m_Links.reserve(2 * m_Header->EdgeCount);
+        for (unsigned long i = 0; i < m_Header->EdgeCount; i++)
+        {
+            if (node1s[i] >= m_Nodes || node2s[i] >= m_Nodes)
+                return false;
+            m_Links.push_back(node1s[i]);
+            m_Links.push_back(node2s[i]);
+        }
+
+        for (unsigned long c = 0; c < m_Header->NodeColumnCount + m_Header->EdgeColumnCount; c++)
+        {
+            const GraphSnapshotFormat::ColumnHeader* column = reader.take<GraphSnapshotFormat::ColumnHeader>(1);
+            if (column == NULL)
+                return false;
+
+            unsigned int n = column->Components;
+            if (n > 4)
+                return false;
+            if (reader.take<unsigned int>(column->Count) == NULL
+                || reader.take<float>(column->Count * n) == NULL
+                || reader.take<long long>(n == 0 ? column->Count : 0) == NULL)
+                return false;
+        }
+
+        m_End = reader.position();
+
+        for (unsigned long a = 0; a < m_Header->ArrayCount; a++)
+        {
+            Array array;
+            array.Header = reader.take<GraphSnapshotFormat::ArrayHeader>(1);
+            if (array.Header == NULL || array.Header->Name >= m_Strings.size())
+                return false;
+            array.Values = reader.take<float>(array.Header->Count);
+            if (array.Values == NULL)
+                return false;
+            array.Name = m_Strings[array.Header->Name];
+
+            if (array.Name == "og:space:position" && array.Header->Components == 3 && array.Header->Count == 3 * m_Nodes)
+            {
+                m_Positions.resize(m_Nodes);
+                for (unsigned long n = 0; n < m_Nodes; n++)
+                    m_Positions[n] = glm::vec3(array.Values[3 * n], array.Values[3 * n + 1], array.Values[3 * n + 2]);
+                m_HasPositions = true;
+            }
+            else
+                m_Arrays.push_back(array);
+        }
+
+        return true;
+    }
+
+    // Same header, strings (plus the array name if it was missing), elements and columns, then the arrays with the new positions
+    bool saveSnapshot()
+    {
+        std::vector<std::string> strings = m_Strings;
+        unsigned int name = std::find(strings.begin(), strings.end(), "og:space:position") - strings.begin();
+        if (name == strings.size())
+            strings.push_back("og:space:position");
+
+        GraphSnapshotFormat::Header header = *m_Header;
+        header.StringCount = strings.size();
+        header.ArrayCount = m_Arrays.size() + 1;
+
+        GraphSnapshotFormat::Writer writer(m_Output);
+        writer.write(&header, sizeof(header));
+
+        std::vector<unsigned long long> offsets(1, 0);
+        for (auto& s : strings)
+            offsets.push_back(offsets.back() + s.size());
+        writer.write(offsets);
+        for (auto& s : strings)
+            fwrite(s.data(), 1, s.size(), m_Output);
+        writer.advance(offsets.back());
+
+        // NOTE : Every section is padded to 8 bytes, the elements and columns can be copied verbatim
+        writer.write(m_Data + m_Begin, m_End - m_Begin);
+
+        for (auto& array : m_Arrays)
+        {
+            writer.write(array.Header, sizeof(*array.Header));
+            writer.write(array.Values, array.Header->Count * sizeof(float));
+        }
+
+        GraphSnapshotFormat::ArrayHeader array;
+        array.Name = name;
+        array.Components = 3;
+        array.Count = 3 * m_Nodes;
+        writer.write(&array, sizeof(array));
+        writer.write(m_Positions.data(), m_Positions.size() * sizeof(glm::vec3));
+
+        return true;
+    }
+
+    Method m_Method;
+    unsigned long m_Iterations;
+    float m_Tolerance;
+    unsigned int m_Threads;
+    float m_Theta;
+    bool m_Exact;
+
+    std::string m_Input;
+    bool m_Snapshot;
+
+    unsigned long m_Nodes;
+    std::vector<unsigned int> m_Links; // Pairs of node indices
+    std::vector<glm::vec3> m_Positions;
+    bool m_HasPositions;
+
+    // Mapped input snapshot
+    const char* m_Data;
+    unsigned long long m_Size;
+    const GraphSnapshotFormat::Header* m_Header;
+    std::vector<std::string> m_Strings;
+    unsigned long long m_Begin; // Elements and columns
+    unsigned long long m_End;
+    std::vector<Array> m_Arrays;
+
+    // JSON output
+    FILE* m_Output;
+    std::vector<bool> m_First;
+    bool m_Value;
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <graphiti/Layout/ThreadPool.hh>
+
+#include <atomic>
+#include <memory>
+
+// Compressed adjacency lists (CSR) over link pairs of body indices, as handed to the layouts.
+// Both directions of a link are stored, self loops and duplicates are kept.
+class LinkAdjacency
+{
+public:
+    LinkAdjacency()
+    {
+        m_Count = 0;
+    }
+
+    void build(unsigned long count, const std::vector<unsigned int>& links)
+    {
+        m_Count = count;
+
+        m_Offsets.assign(count + 1, 0);
+        for (auto b : links)
+            m_Offsets[b + 1]++;
+        for (unsigned long b = 0; b < count; b++)
+            m_Offsets[b + 1] += m_Offsets[b];
+
+        m_Neighbors.resize(links.size());
+        std::vector<unsigned int> cursor(m_Offsets.begin(), m_Offsets.end() - 1);
+        for (unsigned long l = 0; l + 1 < links.size(); l += 2)
+        {
+            m_Neighbors[cursor[links[l]]++] = links[l + 1];
+            m_Neighbors[cursor[links[l + 1]]++] = links[l];
+        }
+    }
+
+    inline unsigned long size() const { return m_Count; }
+
+    // Neighbors of b are neighbors()[begin(b)] to neighbors()[end(b) - 1]
+    inline unsigned int begin(unsigned int b) const { return m_Offsets[b]; }
+    inline unsigned int end(unsigned int b) const { return m_Offsets[b + 1]; }
+    inline const std::vector<unsigned int>& neighbors() const { return m_Neighbors; }
+
+    inline unsigned int degree(unsigned int b) const { return m_Offsets[b + 1] - m_Offsets[b]; }
+
+    // Level synchronous breadth first search : each level is expanded in parallel, nodes are claimed with a
+    // compare and swap so every node is reached once. Calls visit(worker, node, hops) for every reached node,
+    // from several workers at the same time. Returns the number of levels.
+    // NOTE : Narrow levels (e.g. along chains) are expanded inline, the pool only kicks in on wide ones.
+    template <typename F>
+    unsigned int bfs(ThreadPool* pool, unsigned int source, F visit)
+    {
+        if (m_Stamps == NULL || m_StampCount != m_Count)
+        {
+            m_Stamps.reset(new std::atomic<unsigned int>[m_Count]);
+            for (unsigned long b = 0; b < m_Count; b++)
+                m_Stamps[b] = 0;
+            m_StampCount = m_Count;
+            m_Stamp = 0;
+        }
+
+        // NOTE : Stamps save clearing the visited flags before every search
+        if (++m_Stamp == 0)
+        {
+            for (unsigned long b = 0; b < m_Count; b++)
+                m_Stamps[b] = 0;
+            m_Stamp = 1;
+        }
+
+        m_Nexts.resize(pool->size());
+
+        m_Frontier.assign(1, source);
+        m_Stamps[source] = m_Stamp;
+        visit(0, source, 0);
+
+        unsigned int hops = 0;
+        while (!m_Frontier.empty())
+        {
+            hops++;
+
+            for (auto& next : m_Nexts)
+                next.clear();
+
+            pool->parallelFor(m_Frontier.size(), 256, [&](unsigned int worker, unsigned long begin, unsigned long end)
+            {
+                std::vector<unsigned int>& next = m_Nexts[worker];
+                for (unsigned long f = begin; f < end; f++)
+                {
+                    unsigned int b = m_Frontier[f];
+                    for (unsigned int i = m_Offsets[b]; i < m_Offsets[b + 1]; i++)
+                    {
+                        unsigned int n = m_Neighbors[i];
+                        unsigned int stamp = m_Stamps[n].load(std::memory_order_relaxed);
+                        if (stamp != m_Stamp && m_Stamps[n].compare_exchange_strong(stamp, m_Stamp))
+                        {
+                            next.push_back(n);
+                            visit(worker, n, hops);
+                        }
+                    }
+                }
+            });
+
+            m_Frontier.clear();
+            for (auto& next : m_Nexts)
+                m_Frontier.insert(m_Frontier.end(), next.begin(), next.end());
+        }
+
+        return hops;
+    }
+
+private:
+    unsigned long m_Count;
+    std::vector<unsigned int> m_Offsets;
+    std::vector<unsigned int> m_Neighbors;
+
+    // Breadth first search
+    std::unique_ptr<std::atomic<unsigned int>[]> m_Stamps;
+    unsigned long m_StampCount;
+    unsigned int m_Stamp;
+    std::vector<unsigned int> m_Frontier;
+    std::vector<std::vector<unsigned int>> m_Nexts;
+};
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <graphiti/Layout/ForceKernels.hh>
+
+// Barnes-Hut octree for the n-body repulsion of force directed layouts.
+// Cells far enough from a body are approximated by their center of mass,
+// which brings an iteration down from O(N^2) to O(N log N).
+class BarnesHutTree
+{
+public:
+    // NOTE : Coincident bodies would split forever, they are merged in a leaf at this depth
+    static const unsigned int MaxDepth = 24;
+
+    struct Cell
+    {
+        glm::vec3 Center;       // Geometric center of the cube
+        float HalfSize;
+        glm::vec3 Mean;         // Center of mass, sum of the body positions while building
+        float Mass;
+        unsigned int First;     // Index of the 8 children, 0 for leaves
+        int Body;               // First body of a leaf, -1 otherwise
+    };
+
+    BarnesHutTree()
+    {
+        m_Theta = 0.8f;
+    }
+
+    // Rebuilds the tree over the first count positions, which must stay alive until the next build.
+    void build(const Vec3Array& positions, unsigned long count)
+    {
+        m_Positions = &positions;
+        m_Cells.clear();
+        m_Leaves.resize(count);
+
+        if (count == 0)
+            return;
+
+        glm::vec3 min = positions.get(0);
+        glm::vec3 max = positions.get(0);
+        for (unsigned long b = 1; b < count; b++)
+        {
+            glm::vec3 p = positions.get(b);
+            for (unsigned int i = 0; i < 3; i++)
+            {
+                min[i] = std::min(min[i], p[i]);
+                max[i] = std::max(max[i], p[i]);
+            }
+        }
+
+        float size = std::max(max[0] - min[0], std::max(max[1] - min[1], max[2] - min[2]));
+
+        m_Cells.reserve(2 * count);
+        m_Cells.push_back(cell((min + max) * 0.5f, size * 0.5f + 0.001f));
+
+        for (unsigned int b = 0; b < count; b++)
+            insert(b);
+
+        for (auto& c : m_Cells)
+            if (c.Mass > 0)
+                c.Mean = c.Mean / c.Mass;
+    }
+
+    // Repulsion received by a body, fr(x) = k * k / x summed over all the other bodies.
+    glm::vec3 repulsion(unsigned int body, float k2, unsigned long iteration) const
+    {
+        glm::vec3 force(0, 0, 0);
+
+        if (m_Cells.empty())
+            return force;
+
+        const glm::vec3 p = m_Positions->get(body);
+        const float theta2 = m_Theta * m_Theta;
+
+        unsigned int stack[8 * MaxDepth + 8];
+        unsigned int top = 0;
+        stack[top++] = 0;
+
+        while (top > 0)
+        {
+            unsigned int index = stack[--top];
+            const Cell& c = m_Cells[index];
+
+            glm::vec3 mean = c.Mean;
+            float mass = c.Mass;
+
+            if (c.First == 0)
+            {
+                // NOTE : Remove the body itself from its own leaf
+                if (index == m_Leaves[body])
+                {
+                    if (mass == 1)
+                        continue;
+                    mean = (mean * mass - p) / (mass - 1);
+                    mass -= 1;
+                }
+            }
+            else
+            {
+                glm::vec3 dir = p - mean;
+                float size = 2 * c.HalfSize;
+
+                if (size * size >= theta2 * glm::dot(dir, dir) || contains(c, p))
+                {
+                    for (unsigned int i = c.First; i < c.First + 8; i++)
+                        if (m_Cells[i].Mass > 0)
+                            stack[top++] = i;
+                    continue;
+                }
+            }
+
+            force += ForceKernels::repulse(p - mean, k2 * mass, body, index, iteration);
+        }
+
+        return force;
+    }
+
+    inline void setTheta(float theta) { m_Theta = theta; }
+    inline float getTheta() const { return m_Theta; }
+
+    inline const std::vector<Cell>& cells() const { return m_Cells; }
+
+private:
+    static inline Cell cell(const glm::vec3& center, float halfSize)
+    {
+        Cell c;
+        c.Center = center;
+        c.HalfSize = halfSize;
+        c.Mean = glm::vec3(0, 0, 0);
+        c.Mass = 0;
+        c.First = 0;
+        c.Body = -1;
+        return c;
+    }
+
+    static inline unsigned int octant(const Cell& c, const glm::vec3& p)
+    {
+        return (p.x > c.Center.x ? 1 : 0) | (p.y > c.Center.y ? 2 : 0) | (p.z > c.Center.z ? 4 : 0);
+    }
+
+    static inline bool contains(const Cell& c, const glm::vec3& p)
+    {
+        return fabs(p.x - c.Center.x) <= c.HalfSize && fabs(p.y - c.Center.y) <= c.HalfSize && fabs(p.z - c.Center.z) <= c.HalfSize;
+    }
+
+    void insert(unsigned int body)
+    {
+        const glm::vec3 p = m_Positions->get(body);
+
+        unsigned int current = 0;
+        unsigned int depth = 0;
+
+        while (true)
+        {
+            m_Cells[current].Mean += p;
+            m_Cells[current].Mass += 1;
+
+            if (m_Cells[current].First == 0)
+            {
+                if (m_Cells[current].Body < 0 || depth == MaxDepth)
+                {
+                    if (m_Cells[current].Body < 0)
+                        m_Cells[current].Body = body;
+                    m_Leaves[body] = current;
+                    return;
+                }
+
+                subdivide(current);
+            }
+
+            current = m_Cells[current].First + octant(m_Cells[current], p);
+            depth++;
+        }
+    }
+
+    // Splits a leaf holding a single body and moves that body down
+    void subdivide(unsigned int index)
+    {
+        unsigned int first = m_Cells.size();
+        float half = m_Cells[index].HalfSize * 0.5f;
+        glm::vec3 center = m_Cells[index].Center;
+
+        for (unsigned int i = 0; i < 8; i++)
+        {
+            glm::vec3 offset((i & 1) ? half : -half, (i & 2) ? half : -half, (i & 4) ? half : -half);
+            m_Cells.push_back(cell(center + offset, half));
+        }
+
+        Cell& parent = m_Cells[index];
+        unsigned int old = parent.Body;
+        parent.Body = -1;
+        parent.First = first;
+
+        Cell& child = m_Cells[first + octant(parent, m_Positions->get(old))];
+        child.Mean = m_Positions->get(old);
+        child.Mass = 1;
+        child.Body = old;
+        m_Leaves[old] = &child - &m_Cells[0];
+    }
+
+    const Vec3Array* m_Positions;
+    std::vector<Cell> m_Cells;
+    std::vector<unsigned int> m_Leaves;
+    float m_Theta;
+};
@@ -0,0 +1,473 @@
+#pragma once
+
+#include <graphiti/Layout/Headers.hh>
+#include <graphiti/Layout/Placement.hh>
+
+#include <algorithm>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define OG_LAYOUT_SIMD
+# include <immintrin.h>
+#endif
+
+// x, y and z components of one vector per body, kept in separate arrays so the force kernels can use SIMD.
+struct Vec3Array
+{
+    std::vector<float> X;
+    std::vector<float> Y;
+    std::vector<float> Z;
+
+    void resize(unsigned long count)
+    {
+        X.resize(count);
+        Y.resize(count);
+        Z.resize(count);
+    }
+
+    void zero(unsigned long count)
+    {
+        X.assign(count, 0.0f);
+        Y.assign(count, 0.0f);
+        Z.assign(count, 0.0f);
+    }
+
+    inline unsigned long size() const { return X.size(); }
+
+    inline glm::vec3 get(unsigned long i) const { return glm::vec3(X[i], Y[i], Z[i]); }
+
+    inline void set(unsigned long i, const glm::vec3& v)
+    {
+        X[i] = v.x;
+        Y[i] = v.y;
+        Z[i] = v.z;
+    }
+};
+
+// Force kernels of the force directed layouts over Vec3Array, with SSE and AVX2 versions picked at runtime.
+// All versions compute the same forces, only the summation order differs.
+namespace ForceKernels
+{
+    enum ISA { SCALAR, SSE, AVX2 };
+
+    inline ISA detect()
+    {
+#ifdef OG_LAYOUT_SIMD
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+            return AVX2;
+        if (__builtin_cpu_supports("sse2"))
+            return SSE;
+#endif
+        return SCALAR;
+    }
+
+    inline const char* name(ISA isa)
+    {
+        switch (isa)
+        {
+        case AVX2: return "avx2";
+        case SSE:  return "sse";
+        default:   return "scalar";
+        }
+    }
+
+    // NOTE : Bodies closer than this are pushed in a random direction
+    static const float MinDistance2 = 0.1f * 0.1f;
+
+    // Uniform in [0, 1), Placement::random seeded by the iteration over the pair and the draw
+    inline float random(unsigned long i, unsigned long j, unsigned long iteration, unsigned int draw)
+    {
+        return Placement::random(iteration, i, j * 2 + draw);
+    }
+
+    // Repulsive Force : fr(x) = k * k / x on body i from body j, random direction for bodies too close to each other.
+    // NOTE : The direction is a hash of the pair and the iteration, no shared generator between the threads and
+    // the same run gives the same layout. It flips with the order of the pair so both bodies get opposite forces.
+    inline glm::vec3 repulse(glm::vec3 dir, float k2, unsigned long i, unsigned long j, unsigned long iteration)
+    {
+        float d = glm::length(dir);
+        if (d * d < MinDistance2)
+        {
+            float rnd_theta = random(std::min(i, j), std::max(i, j), iteration, 0) * 2.0 * M_PI;
+            float rnd_z = 2.0 * random(std::min(i, j), std::max(i, j), iteration, 1) - 1.0;
+            float sign = i < j ? -1.0 : 1.0;
+            dir.x = sign * sqrt(1 - rnd_z * rnd_z) * cos(rnd_theta);
+            dir.y = sign * sqrt(1 - rnd_z * rnd_z) * sin(rnd_theta);
+            dir.z = sign * rnd_z;
+            d = 1.0;
+        }
+
+        return (dir / d) * (k2 / d);
+    }
+
+    // ----- Repulsion -----
+
+    // Repulsion between every row body in [begin, end) and the bodies before it, each pair is computed once.
+    inline void repulsionScalar(const Vec3Array& p, unsigned long begin, unsigned long end, float k2, unsigned long iteration, Vec3Array& f)
+    {
+        for (unsigned long i = begin; i < end; i++)
+        {
+            glm::vec3 pi = p.get(i);
+            glm::vec3 fi(0, 0, 0);
+
+            for (unsigned long j = 0; j < i; j++)
+            {
+                glm::vec3 fr = repulse(pi - p.get(j), k2, i, j, iteration);
+                fi += fr;
+                f.X[j] -= fr.x;
+                f.Y[j] -= fr.y;
+                f.Z[j] -= fr.z;
+            }
+
+            f.X[i] += fi.x;
+            f.Y[i] += fi.y;
+            f.Z[i] += fi.z;
+        }
+    }
+
+#ifdef OG_LAYOUT_SIMD
+    __attribute__((target("sse2")))
+    inline float hsum(__m128 v)
+    {
+        __m128 s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+        s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+        return _mm_cvtss_f32(s);
+    }
+
+    __attribute__((target("avx2,fma")))
+    inline float hsum(__m256 v)
+    {
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+        return _mm_cvtss_f32(s);
+    }
+
+    // NOTE : fr = dir / d * (k2 / d) = dir * k2 / d^2, no square root needed
+    __attribute__((target("sse2")))
+    inline void repulsionSSE(const Vec3Array& p, unsigned long begin, unsigned long end, float k2, unsigned long iteration, Vec3Array& f)
+    {
+        const __m128 vk2 = _mm_set1_ps(k2);
+        const __m128 vmin = _mm_set1_ps(MinDistance2);
+
+        for (unsigned long i = begin; i < end; i++)
+        {
+            const __m128 xi = _mm_set1_ps(p.X[i]);
+            const __m128 yi = _mm_set1_ps(p.Y[i]);
+            const __m128 zi = _mm_set1_ps(p.Z[i]);
+
+            __m128 fx = _mm_setzero_ps();
+            __m128 fy = _mm_setzero_ps();
+            __m128 fz = _mm_setzero_ps();
+            glm::vec3 fi(0, 0, 0);
+
+            unsigned long j = 0;
+            for (; j + 4 <= i; j += 4)
+            {
+                __m128 dx = _mm_sub_ps(xi, _mm_loadu_ps(&p.X[j]));
+                __m128 dy = _mm_sub_ps(yi, _mm_loadu_ps(&p.Y[j]));
+                __m128 dz = _mm_sub_ps(zi, _mm_loadu_ps(&p.Z[j]));
+                __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+                if (_mm_movemask_ps(_mm_cmplt_ps(d2, vmin)) != 0)
+                {
+                    for (unsigned long jj = j; jj < j + 4; jj++)
+                    {
+                        glm::vec3 fr = repulse(p.get(i) - p.get(jj), k2, i, jj, iteration);
+                        fi += fr;
+                        f.X[jj] -= fr.x;
+                        f.Y[jj] -= fr.y;
+                        f.Z[jj] -= fr.z;
+                    }
+                    continue;
+                }
+
+                __m128 s = _mm_div_ps(vk2, d2);
+                dx = _mm_mul_ps(dx, s);
+                dy = _mm_mul_ps(dy, s);
+                dz = _mm_mul_ps(dz, s);
+
+                fx = _mm_add_ps(fx, dx);
+                fy = _mm_add_ps(fy, dy);
+                fz = _mm_add_ps(fz, dz);
+
+                _mm_storeu_ps(&f.X[j], _mm_sub_ps(_mm_loadu_ps(&f.X[j]), dx));
+                _mm_storeu_ps(&f.Y[j], _mm_sub_ps(_mm_loadu_ps(&f.Y[j]), dy));
+                _mm_storeu_ps(&f.Z[j], _mm_sub_ps(_mm_loadu_ps(&f.Z[j]), dz));
+            }
+
+            for (; j < i; j++)
+            {
+                glm::vec3 fr = repulse(p.get(i) - p.get(j), k2, i, j, iteration);
+                fi += fr;
+                f.X[j] -= fr.x;
+                f.Y[j] -= fr.y;
+                f.Z[j] -= fr.z;
+            }
+
+            f.X[i] += fi.x + hsum(fx);
+            f.Y[i] += fi.y + hsum(fy);
+            f.Z[i] += fi.z + hsum(fz);
+        }
+    }
+
+    __attribute__((target("avx2,fma")))
+    inline void repulsionAVX2(const Vec3Array& p, unsigned long begin, unsigned long end, float k2, unsigned long iteration, Vec3Array& f)
+    {
+        const __m256 vk2 = _mm256_set1_ps(k2);
+        const __m256 vmin = _mm256_set1_ps(MinDistance2);
+
+        for (unsigned long i = begin; i < end; i++)
+        {
+            const __m256 xi = _mm256_set1_ps(p.X[i]);
+            const __m256 yi = _mm256_set1_ps(p.Y[i]);
+            const __m256 zi = _mm256_set1_ps(p.Z[i]);
+
+            __m256 fx = _mm256_setzero_ps();
+            __m256 fy = _mm256_setzero_ps();
+            __m256 fz = _mm256_setzero_ps();
+            glm::vec3 fi(0, 0, 0);
+
+            unsigned long j = 0;
+            for (; j + 8 <= i; j += 8)
+            {
+                __m256 dx = _mm256_sub_ps(xi, _mm256_loadu_ps(&p.X[j]));
+                __m256 dy = _mm256_sub_ps(yi, _mm256_loadu_ps(&p.Y[j]));
+                __m256 dz = _mm256_sub_ps(zi, _mm256_loadu_ps(&p.Z[j]));
+                __m256 d2 = _mm256_fmadd_ps(dz, dz, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dx, dx)));
+
+                if (_mm256_movemask_ps(_mm256_cmp_ps(d2, vmin, _CMP_LT_OQ)) != 0)
+                {
+                    for (unsigned long jj = j; jj < j + 8; jj++)
+                    {
+                        glm::vec3 fr = repulse(p.get(i) - p.get(jj), k2, i, jj, iteration);
+                        fi += fr;
+                        f.X[jj] -= fr.x;
+                        f.Y[jj] -= fr.y;
+                        f.Z[jj] -= fr.z;
+                    }
+                    continue;
+                }
+
+                __m256 s = _mm256_div_ps(vk2, d2);
+                dx = _mm256_mul_ps(dx, s);
+                dy = _mm256_mul_ps(dy, s);
+                dz = _mm256_mul_ps(dz, s);
+
+                fx = _mm256_add_ps(fx, dx);
+                fy = _mm256_add_ps(fy, dy);
+                fz = _mm256_add_ps(fz, dz);
+
+                _mm256_storeu_ps(&f.X[j], _mm256_sub_ps(_mm256_loadu_ps(&f.X[j]), dx));
+                _mm256_storeu_ps(&f.Y[j], _mm256_sub_ps(_mm256_loadu_ps(&f.Y[j]), dy));
+                _mm256_storeu_ps(&f.Z[j], _mm256_sub_ps(_mm256_loadu_ps(&f.Z[j]), dz));
+            }
+
+            for (; j < i; j++)
+            {
+                glm::vec3 fr = repulse(p.get(i) - p.get(j), k2, i, j, iteration);
+                fi += fr;
+                f.X[j] -= fr.x;
+                f.Y[j] -= fr.y;
+                f.Z[j] -= fr.z;
+            }
+
+            f.X[i] += fi.x + hsum(fx);
+            f.Y[i] += fi.y + hsum(fy);
+            f.Z[i] += fi.z + hsum(fz);
+        }
+    }
+#endif
+
+    inline void repulsion(ISA isa, const Vec3Array& p, unsigned long begin, unsigned long end, float k2, unsigned long iteration, Vec3Array& f)
+    {
+#ifdef OG_LAYOUT_SIMD
+        if (isa == AVX2)
+            return repulsionAVX2(p, begin, end, k2, iteration, f);
+        if (isa == SSE)
+            return repulsionSSE(p, begin, end, k2, iteration, f);
+#endif
+        (void) isa;
+        repulsionScalar(p, begin, end, k2, iteration, f);
+    }
+
+    // ----- Attraction -----
+
+    // Attractive Force : fa(x) = x * x / k along links [begin, end), links holds pairs of body indices.
+    // Links no longer than minDistance are ignored, so are the ones whose ends coincide (no direction to pull along).
+    inline void attractionScalar(const Vec3Array& p, const unsigned int* links, unsigned long begin, unsigned long end, float k, float minDistance, Vec3Array& f)
+    {
+        for (unsigned long l = begin; l < end; l++)
+        {
+            unsigned int i1 = links[2 * l];
+            unsigned int i2 = links[2 * l + 1];
+
+            glm::vec3 dir = p.get(i1) - p.get(i2);
+            float d = glm::length(dir);
+            if (d <= minDistance)
+                continue;
+
+            glm::vec3 fa = (dir / d) * (d * d / k);
+            f.X[i1] -= fa.x;
+            f.Y[i1] -= fa.y;
+            f.Z[i1] -= fa.z;
+            f.X[i2] += fa.x;
+            f.Y[i2] += fa.y;
+            f.Z[i2] += fa.z;
+        }
+    }
+
+#ifdef OG_LAYOUT_SIMD
+    // NOTE : Endpoints are gathered 8 links at a time, the results are scattered back one by one
+    // since two lanes can share a node. SSE has no gather so it uses the scalar kernel.
+    __attribute__((target("avx2,fma")))
+    inline void attractionAVX2(const Vec3Array& p, const unsigned int* links, unsigned long begin, unsigned long end, float k, float minDistance, Vec3Array& f)
+    {
+        const __m256i stride = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
+        const __m256 vk = _mm256_set1_ps(1.0f / k);
+        const __m256 vmin = _mm256_set1_ps(minDistance);
+
+        alignas(32) float fx[8];
+        alignas(32) float fy[8];
+        alignas(32) float fz[8];
+
+        unsigned long l = begin;
+        for (; l + 8 <= end; l += 8)
+        {
+            const int* base = reinterpret_cast<const int*>(links + 2 * l);
+            __m256i i1 = _mm256_i32gather_epi32(base, stride, 4);
+            __m256i i2 = _mm256_i32gather_epi32(base + 1, stride, 4);
+
+            __m256 dx = _mm256_sub_ps(_mm256_i32gather_ps(p.X.data(), i1, 4), _mm256_i32gather_ps(p.X.data(), i2, 4));
+            __m256 dy = _mm256_sub_ps(_mm256_i32gather_ps(p.Y.data(), i1, 4), _mm256_i32gather_ps(p.Y.data(), i2, 4));
+            __m256 dz = _mm256_sub_ps(_mm256_i32gather_ps(p.Z.data(), i1, 4), _mm256_i32gather_ps(p.Z.data(), i2, 4));
+            __m256 d = _mm256_sqrt_ps(_mm256_fmadd_ps(dz, dz, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dx, dx))));
+
+            // fa = dir / d * d * d / k = dir * d / k
+            __m256 s = _mm256_and_ps(_mm256_mul_ps(d, vk), _mm256_cmp_ps(d, vmin, _CMP_GT_OQ));
+
+            _mm256_store_ps(fx, _mm256_mul_ps(dx, s));
+            _mm256_store_ps(fy, _mm256_mul_ps(dy, s));
+            _mm256_store_ps(fz, _mm256_mul_ps(dz, s));
+
+            for (unsigned int lane = 0; lane < 8; lane++)
+            {
+                unsigned int n1 = links[2 * (l + lane)];
+                unsigned int n2 = links[2 * (l + lane) + 1];
+                f.X[n1] -= fx[lane];
+                f.Y[n1] -= fy[lane];
+                f.Z[n1] -= fz[lane];
+                f.X[n2] += fx[lane];
+                f.Y[n2] += fy[lane];
+                f.Z[n2] += fz[lane];
+            }
+        }
+
+        attractionScalar(p, links, l, end, k, minDistance, f);
+    }
+#endif
+
+    inline void attraction(ISA isa, const Vec3Array& p, const unsigned int* links, unsigned long begin, unsigned long end, float k, float minDistance, Vec3Array& f)
+    {
+#ifdef OG_LAYOUT_SIMD
+        if (isa == AVX2)
+            return attractionAVX2(p, links, begin, end, k, minDistance, f);
+#endif
+        (void) isa;
+        attractionScalar(p, links, begin, end, k, minDistance, f);
+    }
+
+    // ----- Dust -----
+
+    // Pulls the bodies in [begin, end) lying outside of the sphere back towards its center.
+    inline void dustScalar(const Vec3Array& p, unsigned long begin, unsigned long end, const glm::vec3& center, float radius, float factor, Vec3Array& f)
+    {
+        for (unsigned long i = begin; i < end; i++)
+        {
+            glm::vec3 d = center - p.get(i);
+            float d2 = glm::dot(d, d);
+            if (d2 > radius * radius)
+            {
+                d = d * (factor / sqrt(d2));
+                f.X[i] += d.x;
+                f.Y[i] += d.y;
+                f.Z[i] += d.z;
+            }
+        }
+    }
+
+#ifdef OG_LAYOUT_SIMD
+    __attribute__((target("sse2")))
+    inline void dustSSE(const Vec3Array& p, unsigned long begin, unsigned long end, const glm::vec3& center, float radius, float factor, Vec3Array& f)
+    {
+        const __m128 cx = _mm_set1_ps(center.x);
+        const __m128 cy = _mm_set1_ps(center.y);
+        const __m128 cz = _mm_set1_ps(center.z);
+        const __m128 vr2 = _mm_set1_ps(radius * radius);
+        const __m128 vfactor = _mm_set1_ps(factor);
+
+        unsigned long i = begin;
+        for (; i + 4 <= end; i += 4)
+        {
+            __m128 dx = _mm_sub_ps(cx, _mm_loadu_ps(&p.X[i]));
+            __m128 dy = _mm_sub_ps(cy, _mm_loadu_ps(&p.Y[i]));
+            __m128 dz = _mm_sub_ps(cz, _mm_loadu_ps(&p.Z[i]));
+            __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+            __m128 outside = _mm_cmpgt_ps(d2, vr2);
+            if (_mm_movemask_ps(outside) == 0)
+                continue;
+
+            __m128 s = _mm_and_ps(_mm_div_ps(vfactor, _mm_sqrt_ps(d2)), outside);
+            _mm_storeu_ps(&f.X[i], _mm_add_ps(_mm_loadu_ps(&f.X[i]), _mm_mul_ps(dx, s)));
+            _mm_storeu_ps(&f.Y[i], _mm_add_ps(_mm_loadu_ps(&f.Y[i]), _mm_mul_ps(dy, s)));
+            _mm_storeu_ps(&f.Z[i], _mm_add_ps(_mm_loadu_ps(&f.Z[i]), _mm_mul_ps(dz, s)));
+        }
+
+        dustScalar(p, i, end, center, radius, factor, f);
+    }
+
+    __attribute__((target("avx2,fma")))
+    inline void dustAVX2(const Vec3Array& p, unsigned long begin, unsigned long end, const glm::vec3& center, float radius, float factor, Vec3Array& f)
+    {
+        const __m256 cx = _mm256_set1_ps(center.x);
+        const __m256 cy = _mm256_set1_ps(center.y);
+        const __m256 cz = _mm256_set1_ps(center.z);
+        const __m256 vr2 = _mm256_set1_ps(radius * radius);
+        const __m256 vfactor = _mm256_set1_ps(factor);
+
+        unsigned long i = begin;
+        for (; i + 8 <= end; i += 8)
+        {
+            __m256 dx = _mm256_sub_ps(cx, _mm256_loadu_ps(&p.X[i]));
+            __m256 dy = _mm256_sub_ps(cy, _mm256_loadu_ps(&p.Y[i]));
+            __m256 dz = _mm256_sub_ps(cz, _mm256_loadu_ps(&p.Z[i]));
+            __m256 d2 = _mm256_fmadd_ps(dz, dz, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dx, dx)));
+
+            __m256 outside = _mm256_cmp_ps(d2, vr2, _CMP_GT_OQ);
+            if (_mm256_movemask_ps(outside) == 0)
+                continue;
+
+            __m256 s = _mm256_and_ps(_mm256_div_ps(vfactor, _mm256_sqrt_ps(d2)), outside);
+            _mm256_storeu_ps(&f.X[i], _mm256_fmadd_ps(dx, s, _mm256_loadu_ps(&f.X[i])));
+            _mm256_storeu_ps(&f.Y[i], _mm256_fmadd_ps(dy, s, _mm256_loadu_ps(&f.Y[i])));
+            _mm256_storeu_ps(&f.Z[i], _mm256_fmadd_ps(dz, s, _mm256_loadu_ps(&f.Z[i])));
+        }
+
+        dustScalar(p, i, end, center, radius, factor, f);
+    }
+#endif
+
+    inline void dust(ISA isa, const Vec3Array& p, unsigned long begin, unsigned long end, const glm::vec3& center, float radius, float factor, Vec3Array& f)
+    {
+#ifdef OG_LAYOUT_SIMD
+        if (isa == AVX2)
+            return dustAVX2(p, begin, end, center, radius, factor, f);
+        if (isa == SSE)
+            return dustSSE(p, begin, end, center, radius, factor, f);
+#endif
+        (void) isa;
+        dustScalar(p, begin, end, center, radius, factor, f);
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+// Common headers of the layout code.
+// The headless tool (graphiti-layout) is built with OG_HEADLESS and only needs glm, the rest of the application gets them from raindance.
+
+#ifdef OG_HEADLESS
+
+#include <cmath>
+#include <cstdio>
+
+#include <glm/glm.hpp>
+
+#ifndef LOG
+#define LOG(...) printf(__VA_ARGS__)
+#endif
+
+// NOTE : The space forces derive from the raindance force interface, which only provides a virtual destructor.
+namespace Physics
+{
+    class IForce
+    {
+    public:
+        virtual ~IForce() {}
+    };
+}
+
+#else
+
+#include <raindance/Core/Headers.hh>
+#include <raindance/Core/Physics.hh>
+
+#endif
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <graphiti/Layout/Adjacency.hh>
+#include <graphiti/Layout/BarnesHut.hh>
+#include <graphiti/Layout/Placement.hh>
+#include <graphiti/Layout/ThreadPool.hh>
+
+#include <algorithm>
+#include <chrono>
+
+// Multilevel force directed layout, along the lines of FM3 / multilevel ForceAtlas2.
+// The graph is coarsened by matching each node with its lightest unmatched neighbor (left over nodes join
+// a neighbor, like moons around a sun), the coarsest graph is laid out from scratch, then each level is
+// prolonged to the finer one (children start around their parent) and refined with a few cooling iterations.
+// The forces are Fruchterman-Reingold ones, fr = k * k / x and fa = x * x / k, with Barnes-Hut repulsion.
+// Locked nodes keep their positions, the others are moved so the layout stays centered on them.
+class MultilevelLayout
+{
+public:
+    MultilevelLayout()
+    {
+        m_ThreadPool = NULL;
+
+        m_MinCount = 32;
+        m_MaxRatio = 0.85f;
+        m_CoarsestIterations = 300;
+        m_LevelIterations = 60;
+        m_Seed = 0;
+    }
+
+    void bind(ThreadPool* pool)
+    {
+        m_ThreadPool = pool;
+    }
+
+    // Lays out positions.size() bodies, links holds pairs of body indices. Positions are overwritten but for
+    // the locked bodies (optional, one flag per body).
+    void run(std::vector<glm::vec3>& positions, const std::vector<unsigned int>& links, const std::vector<bool>& locked = std::vector<bool>())
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        m_Levels.clear();
+        m_Levels.push_back(Level());
+        m_Levels[0].Count = positions.size();
+        m_Levels[0].Masses.assign(positions.size(), 1.0f);
+        for (unsigned long l = 0; l + 1 < links.size(); l += 2)
+            if (links[l] != links[l + 1])
+            {
+                m_Levels[0].Links.push_back(links[l]);
+                m_Levels[0].Links.push_back(links[l + 1]);
+            }
+
+        if (positions.empty())
+            return;
+
+        while (m_Levels.back().Count > m_MinCount)
+        {
+            Level coarse;
+            coarsen(m_Levels.back(), coarse, m_Levels.size() - 1);
+
+            if (coarse.Count > m_MaxRatio * m_Levels.back().Count)
+                break;
+
+            m_Levels.push_back(Level());
+            m_Levels.back().Count = coarse.Count;
+            m_Levels.back().Links.swap(coarse.Links);
+            m_Levels.back().Masses.swap(coarse.Masses);
+        }
+
+        // Coarsest level, random start inside a cube holding the nodes at the natural spacing
+        unsigned int coarsest = m_Levels.size() - 1;
+        float side = Placement::spacing(m_Levels[coarsest].Count) * pow(m_Levels[coarsest].Count, 1.0 / 3.0);
+
+        m_Positions.resize(m_Levels[coarsest].Count);
+        for (unsigned long b = 0; b < m_Positions.size(); b++)
+            m_Positions.set(b, side * Placement::jitter(m_Seed, b, 4 * coarsest));
+
+        refine(m_Levels[coarsest], m_CoarsestIterations, side);
+
+        // Prolong and refine up to the original graph
+        for (int l = coarsest - 1; l >= 0; l--)
+        {
+            const Level& fine = m_Levels[l];
+            float k = Placement::spacing(fine.Count);
+
+            Vec3Array prolonged;
+            prolonged.resize(fine.Count);
+            for (unsigned long b = 0; b < fine.Count; b++)
+                prolonged.set(b, m_Positions.get(fine.Parents[b]) + 0.5f * k * Placement::jitter(m_Seed, b, 4 * l));
+            std::swap(m_Positions, prolonged);
+
+            refine(fine, m_LevelIterations, 2 * k);
+        }
+
+        // Move the layout so the locked nodes are centered on their actual positions
+        glm::vec3 offset = Placement::lockedOffset(positions, locked, [&](unsigned long b) { return m_Positions.get(b); });
+        for (unsigned long b = 0; b < positions.size(); b++)
+            if (!Placement::isLocked(locked, b))
+                positions[b] = m_Positions.get(b) + offset;
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        LOG("[MULTILEVEL] %lu nodes, %u levels (coarsest %lu nodes), %.2f s\n", positions.size(), (unsigned int) m_Levels.size(), m_Levels[coarsest].Count, seconds);
+    }
+
+    // NOTE : Coarsening stops below this many nodes or when a level does not shrink enough
+    inline void setMinCount(unsigned long count) { m_MinCount = count; }
+    inline void setIterations(unsigned int coarsest, unsigned int level) { m_CoarsestIterations = coarsest; m_LevelIterations = level; }
+    // NOTE : Runs with the same seed on the same graph give the same layout
+    inline void setSeed(unsigned long long seed) { m_Seed = seed; }
+
+    inline unsigned int levels() const { return m_Levels.size(); }
+
+private:
+    struct Level
+    {
+        unsigned long Count;
+        std::vector<unsigned int> Links;    // Pairs of node indices
+        std::vector<float> Masses;          // Number of original nodes merged in each node
+        std::vector<unsigned int> Parents;  // Node of the next coarser level, filled by coarsen()
+    };
+
+    // NOTE : Random draws of a level use 4 * level to 4 * level + 3, see run()
+    void coarsen(Level& fine, Level& coarse, unsigned int level)
+    {
+        const unsigned long n = fine.Count;
+
+        LinkAdjacency adjacency;
+        adjacency.build(n, fine.Links);
+        const std::vector<unsigned int>& neighbors = adjacency.neighbors();
+
+        // Match each node with its lightest unmatched neighbor, visiting nodes in random order
+        const unsigned int None = ~0u;
+        std::vector<unsigned int> order(n);
+        for (unsigned long b = 0; b < n; b++)
+            order[b] = b;
+        for (unsigned long b = n; b > 1; b--)
+            std::swap(order[b - 1], order[Placement::hash(m_Seed, b, 4 * level + 3) % b]);
+
+        fine.Parents.assign(n, None);
+        coarse.Count = 0;
+
+        for (auto u : order)
+        {
+            if (fine.Parents[u] != None)
+                continue;
+
+            unsigned int best = None;
+            for (unsigned int i = adjacency.begin(u); i < adjacency.end(u); i++)
+            {
+                unsigned int v = neighbors[i];
+                if (fine.Parents[v] == None && v != u && (best == None || fine.Masses[v] < fine.Masses[best]))
+                    best = v;
+            }
+
+            if (best != None)
+            {
+                fine.Parents[u] = fine.Parents[best] = coarse.Count++;
+            }
+        }
+
+        // Left over nodes join their lightest neighbor, isolated nodes stay on their own
+        std::vector<float> masses(coarse.Count, 0.0f);
+        for (unsigned long b = 0; b < n; b++)
+            if (fine.Parents[b] != None)
+                masses[fine.Parents[b]] += fine.Masses[b];
+
+        for (auto u : order)
+        {
+            if (fine.Parents[u] != None)
+                continue;
+
+            unsigned int best = None;
+            for (unsigned int i = adjacency.begin(u); i < adjacency.end(u); i++)
+            {
+                unsigned int parent = fine.Parents[neighbors[i]];
+                if (parent != None && (best == None || masses[parent] < masses[best]))
+                    best = parent;
+            }
+
+            if (best == None)
+            {
+                best = coarse.Count++;
+                masses.push_back(0.0f);
+            }
+
+            fine.Parents[u] = best;
+            masses[best] += fine.Masses[u];
+        }
+
+        coarse.Masses.swap(masses);
+
+        // Coarse links, without self loops and duplicates
+        std::vector<unsigned long long> keys;
+        keys.reserve(fine.Links.size() / 2);
+        for (unsigned long l = 0; l < fine.Links.size(); l += 2)
+        {
+            unsigned long long a = fine.Parents[fine.Links[l]];
+            unsigned long long b = fine.Parents[fine.Links[l + 1]];
+            if (a != b)
+                keys.push_back(a < b ? (a << 32) | b : (b << 32) | a);
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+        coarse.Links.clear();
+        coarse.Links.reserve(2 * keys.size());
+        for (auto key : keys)
+        {
+            coarse.Links.push_back(key >> 32);
+            coarse.Links.push_back(key & 0xFFFFFFFF);
+        }
+    }
+
+    // Iterations of the forces over one level, moves are capped by a temperature cooling down to a tenth of it
+    void refine(const Level& level, unsigned int iterations, float temperature)
+    {
+        const float k = Placement::spacing(level.Count);
+        const float cooling = pow(0.1, 1.0 / iterations);
+        const ForceKernels::ISA isa = ForceKernels::detect();
+
+        for (unsigned int it = 0; it < iterations; it++)
+        {
+            m_Forces.zero(level.Count);
+
+            m_Tree.build(m_Positions, level.Count);
+            m_ThreadPool->parallelFor(level.Count, 256, [&](unsigned int worker, unsigned long begin, unsigned long end)
+            {
+                (void) worker;
+                for (unsigned long b = begin; b < end; b++)
+                    m_Forces.set(b, m_Tree.repulsion(b, k * k, it));
+            });
+
+            m_Buffers.resize(m_ThreadPool->size());
+            for (auto& buffer : m_Buffers)
+                buffer.zero(level.Count);
+
+            m_ThreadPool->parallelFor(level.Links.size() / 2, 1024, [&](unsigned int worker, unsigned long begin, unsigned long end)
+            {
+                ForceKernels::attraction(isa, m_Positions, level.Links.data(), begin, end, k, 0.0f, m_Buffers[worker]);
+            });
+
+            m_ThreadPool->parallelFor(level.Count, 4096, [&](unsigned int worker, unsigned long begin, unsigned long end)
+            {
+                (void) worker;
+                for (unsigned long b = begin; b < end; b++)
+                {
+                    glm::vec3 force = m_Forces.get(b);
+                    for (auto& buffer : m_Buffers)
+                        force += buffer.get(b);
+
+                    float length = glm::length(force);
+                    if (length > temperature)
+                        force = force * (temperature / length);
+
+                    m_Positions.set(b, m_Positions.get(b) + force);
+                }
+            });
+
+            temperature *= cooling;
+        }
+    }
+
+    ThreadPool* m_ThreadPool;
+
+    unsigned long m_MinCount;
+    float m_MaxRatio;
+    unsigned int m_CoarsestIterations;
+    unsigned int m_LevelIterations;
+    unsigned long long m_Seed;
+
+    std::vector<Level> m_Levels;
+
+    Vec3Array m_Positions;
+    Vec3Array m_Forces;
+    std::vector<Vec3Array> m_Buffers;
+    BarnesHutTree m_Tree;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <graphiti/Layout/Headers.hh>
+
+#include <cmath>
+#include <vector>
+
+// Helpers shared by the global layouts (MultilevelLayout, StressLayout) to place bodies before and after a run.
+namespace Placement
+{
+    // NOTE : Same natural spacing as the space view forces, the graph should fit in a 20 * 20 * 20 cube
+    inline float spacing(unsigned long count)
+    {
+        const float volume = 20 * 20 * 20;
+        return pow(volume / count, 1.0 / 3.0);
+    }
+
+    // SplitMix64 finalizer over the seed, the index and the draw, the same seed gives the same numbers on any thread
+    inline unsigned long long hash(unsigned long long seed, unsigned long index, unsigned long draw)
+    {
+        unsigned long long x = seed * 0x9E3779B97F4A7C15ULL + index;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL + draw;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    // Uniform in [0, 1)
+    inline float random(unsigned long long seed, unsigned long index, unsigned long draw)
+    {
+        return (hash(seed, index, draw) >> 40) / 16777216.0f;
+    }
+
+    // Uniform in [-0.5, 0.5)^3, from three consecutive draws
+    inline glm::vec3 jitter(unsigned long long seed, unsigned long index, unsigned long draw)
+    {
+        return glm::vec3(random(seed, index, draw) - 0.5f, random(seed, index, draw + 1) - 0.5f, random(seed, index, draw + 2) - 0.5f);
+    }
+
+    inline bool isLocked(const std::vector<bool>& locked, unsigned long i)
+    {
+        return i < locked.size() && locked[i];
+    }
+
+    // Translation moving a layout so its locked bodies are centered on their actual positions, layout(i) returns
+    // where the run put body i. Zero when nothing is locked.
+    template <typename F>
+    glm::vec3 lockedOffset(const std::vector<glm::vec3>& positions, const std::vector<bool>& locked, F layout)
+    {
+        unsigned long lockedCount = 0;
+        glm::vec3 lockedCenter(0, 0, 0);
+        glm::vec3 layoutCenter(0, 0, 0);
+        for (unsigned long i = 0; i < locked.size() && i < positions.size(); i++)
+            if (locked[i])
+            {
+                lockedCenter += positions[i];
+                layoutCenter += layout(i);
+                lockedCount++;
+            }
+
+        if (lockedCount == 0)
+            return glm::vec3(0, 0, 0);
+        return (lockedCenter - layoutCenter) / (float) lockedCount;
+    }
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <graphiti/Layout/Placement.hh>
+#include <graphiti/Layout/ThreadPool.hh>
+
+#include <algorithm>
+#include <cmath>
+
+// Closed form layouts of the console 'layout' command (point, sphere, cube, cone, globe, seeds), see Scripts/console/layout.py.
+// Every node position only depends on its index and a few per node inputs, so they are computed in parallel.
+// NOTE : Random numbers come from a hash of the node index, the result doesn't depend on the number of threads.
+class ShapeLayout
+{
+public:
+    ShapeLayout()
+    {
+        m_ThreadPool = NULL;
+        m_Seed = 0;
+    }
+
+    void bind(ThreadPool* pool)
+    {
+        m_ThreadPool = pool;
+    }
+
+    void point(std::vector<glm::vec3>& positions)
+    {
+        parallel(positions.size(), [&](unsigned long i)
+        {
+            positions[i] = glm::vec3(0, 0, 0);
+        });
+    }
+
+    // Random points in a shell between 0.9 and 1 times the radius
+    void sphere(std::vector<glm::vec3>& positions, float radius)
+    {
+        const unsigned long long seed = reseed();
+
+        parallel(positions.size(), [&](unsigned long i)
+        {
+            float r1 = 2 * M_PI * Placement::random(seed, i, 0);
+            float r2 = 2 * M_PI * Placement::random(seed, i, 1);
+            float r3 = radius * (0.9f + 0.1f * Placement::random(seed, i, 2));
+
+            positions[i] = r3 * glm::vec3(sin(r1) * cos(r2), cos(r1), sin(r1) * sin(r2));
+        });
+    }
+
+    // Regular grid of spacing 5, layers stack up when the count isn't a cube
+    void cube(std::vector<glm::vec3>& positions)
+    {
+        const unsigned long size = std::max(1UL, (unsigned long) pow(positions.size(), 1.0 / 3.0));
+        const float half = size / 2;
+
+        parallel(positions.size(), [&](unsigned long i)
+        {
+            glm::vec3 cell(i % size, i / (size * size), (i % (size * size)) / size);
+            positions[i] = 5.0f * (cell - glm::vec3(half, half, half));
+        });
+    }
+
+    // Nodes on circles around the vertical axis, the higher the degree the higher and closer to the axis
+    void cone(std::vector<glm::vec3>& positions, const std::vector<unsigned int>& degrees)
+    {
+        const float maxRadius = 30.0f;
+        const float maxHeight = 20.0f;
+        const unsigned long long seed = reseed();
+
+        unsigned int maxDegree = 1;
+        for (auto degree : degrees)
+            maxDegree = std::max(maxDegree, degree);
+
+        parallel(positions.size(), [&](unsigned long i)
+        {
+            float ratio = (float) degrees[i] / maxDegree;
+            float radius = 1.0f + maxRadius * (1.0f - ratio);
+            float alpha = 2 * M_PI * Placement::random(seed, i, 0);
+
+            positions[i] = glm::vec3(radius * cos(alpha), maxHeight * ratio, radius * sin(alpha));
+        });
+    }
+
+    // Geolocations (latitude, longitude in degrees) on a globe of radius 50
+    void globe(std::vector<glm::vec3>& positions, const std::vector<glm::vec2>& geolocations)
+    {
+        const float radius = 50.0f;
+
+        parallel(positions.size(), [&](unsigned long i)
+        {
+            float latitude = geolocations[i].x * M_PI / 180.0;
+            float longitude = geolocations[i].y * M_PI / 180.0;
+
+            positions[i] = radius * glm::vec3(cos(latitude) * cos(longitude), sin(latitude), -cos(latitude) * sin(longitude));
+        });
+    }
+
+    // Evenly spread on a horizontal circle, a single node goes to the center
+    void seeds(std::vector<glm::vec3>& positions, float radius)
+    {
+        if (positions.size() == 1)
+            radius = 0.0f;
+
+        parallel(positions.size(), [&](unsigned long i)
+        {
+            float angle = 2 * M_PI * i / positions.size();
+            positions[i] = glm::vec3(radius * cos(angle), 0.0f, radius * sin(angle));
+        });
+    }
+
+private:
+    template <typename F>
+    void parallel(unsigned long count, F f)
+    {
+        m_ThreadPool->parallelFor(count, 4096, [&](unsigned int worker, unsigned long begin, unsigned long end)
+        {
+            (void) worker;
+            for (unsigned long i = begin; i < end; i++)
+                f(i);
+        });
+    }
+
+    // NOTE : Each call gets a new seed so running a random layout twice gives a different result
+    inline unsigned long long reseed() { return ++m_Seed; }
+
+    ThreadPool* m_ThreadPool;
+    unsigned long long m_Seed;
+};
@@ -0,0 +1,442 @@
+#pragma once
+
+#include <graphiti/Layout/Adjacency.hh>
+#include <graphiti/Layout/ForceKernels.hh>
+#include <graphiti/Layout/Placement.hh>
+#include <graphiti/Layout/ThreadPool.hh>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+// Sparse stress majorization, seeded by Pivot MDS (Brandes & Pich, then Ortmann, Klimenta & Brandes).
+// Graph distances are only known from k pivots : a breadth first search from each pivot (chosen by max-min)
+// fills an n * k hop matrix, the double centered matrix gives a first embedding through the top eigenvectors
+// of its small k * k square, then the stress is minimized with the links and the pivots as the only terms,
+// each pivot standing for the nodes of its region (the nodes it is the closest pivot of).
+// Locked nodes keep their positions, the others are placed around them.
+class StressLayout
+{
+public:
+    StressLayout()
+    {
+        m_ThreadPool = NULL;
+
+        m_PivotCount = 32;
+        m_MaxIterations = 200;
+        m_Tolerance = 1e-4f;
+        m_Unreachable = 0;
+        m_Seed = 0;
+    }
+
+    void bind(ThreadPool* pool)
+    {
+        m_ThreadPool = pool;
+    }
+
+    // Lays out positions.size() bodies, links holds pairs of body indices. Positions are overwritten but for
+    // the locked bodies (optional, one flag per body).
+    void run(std::vector<glm::vec3>& positions, const std::vector<unsigned int>& links, const std::vector<bool>& locked = std::vector<bool>())
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        const unsigned long n = positions.size();
+        if (n < 2)
+            return;
+
+        const unsigned int k = std::min<unsigned long>(m_PivotCount, n);
+        const float length = Placement::spacing(n);
+
+        m_Adjacency.build(n, links);
+
+        pivots(k);
+        embed(k);
+
+        // NOTE : Nodes with the same distances to every pivot (e.g. leaves of a star) get the same embedding,
+        // a little noise lets the stress pull them apart.
+        std::vector<glm::vec3> layout(n);
+        for (unsigned long i = 0; i < n; i++)
+            layout[i] = length * (m_Embedding[i] + 0.1f * Placement::jitter(m_Seed, i, 0));
+
+        // Move the embedding so the locked nodes are centered on their actual positions
+        glm::vec3 offset = Placement::lockedOffset(positions, locked, [&](unsigned long i) { return layout[i]; });
+        for (unsigned long i = 0; i < n; i++)
+            layout[i] = Placement::isLocked(locked, i) ? positions[i] : layout[i] + offset;
+
+        unsigned int iterations = majorize(k, length, layout, locked);
+
+        for (unsigned long i = 0; i < n; i++)
+            positions[i] = layout[i];
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        LOG("[STRESS] %lu nodes, %u pivots, %u iterations, %.2f s\n", n, k, iterations, seconds);
+    }
+
+    inline void setPivotCount(unsigned int count) { m_PivotCount = std::max(1u, count); }
+    inline void setMaxIterations(unsigned int iterations) { m_MaxIterations = iterations; }
+    // NOTE : Iterations stop once the stress improves by less than this fraction, or is below it per node
+    inline void setTolerance(float tolerance) { m_Tolerance = tolerance; }
+    // NOTE : Runs with the same seed on the same graph give the same layout
+    inline void setSeed(unsigned long long seed) { m_Seed = seed; }
+
+private:
+    // Breadth first searches from k pivots, each one the farthest node from the previous ones.
+    // Fills m_Distances (n * k hops, row major), m_Regions (closest pivot) and m_RegionCounts.
+    void pivots(unsigned int k)
+    {
+        const unsigned long n = m_Adjacency.size();
+        const float unreachable = -1.0f;
+
+        m_Distances.assign(n * k, unreachable);
+        m_Regions.assign(n, 0);
+        m_Pivots.clear();
+
+        std::vector<float> nearest(n, std::numeric_limits<float>::max());
+        std::vector<unsigned long> farthest(m_ThreadPool->size());
+
+        unsigned int pivot = Placement::hash(m_Seed, 0, 3) % n;
+        float maxDistance = 0;
+
+        for (unsigned int p = 0; p < k; p++)
+        {
+            m_Pivots.push_back(pivot);
+
+            unsigned int levels = m_Adjacency.bfs(m_ThreadPool, pivot, [&](unsigned int worker, unsigned int i, unsigned int hops)
+            {
+                (void) worker;
+                m_Distances[i * k + p] = hops;
+                if (hops < nearest[i])
+                {
+                    nearest[i] = hops;
+                    m_Regions[i] = p;
+                }
+            });
+            maxDistance = std::max(maxDistance, (float) (levels - 1));
+
+            // Next pivot : the node the farthest from all the pivots so far, nodes out of reach come first
+            for (auto& f : farthest)
+                f = pivot;
+
+            m_ThreadPool->parallelFor(n, 4096, [&](unsigned int worker, unsigned long begin, unsigned long end)
+            {
+                unsigned long best = farthest[worker];
+                for (unsigned long i = begin; i < end; i++)
+                    if (nearest[i] > nearest[best])
+                        best = i;
+                farthest[worker] = best;
+            });
+
+            for (auto f : farthest)
+                if (nearest[f] > nearest[pivot])
+                    pivot = f;
+        }
+
+        // NOTE : Other components are put just past the diameter for the embedding, the majorization skips them
+        m_Unreachable = maxDistance + 1;
+        m_ThreadPool->parallelFor(n, 4096, [&](unsigned int worker, unsigned long begin, unsigned long end)
+        {
+            (void) worker;
+            for (unsigned long i = begin * k; i < end * k; i++)
+                if (m_Distances[i] == unreachable)
+                    m_Distances[i] = m_Unreachable;
+        });
+
+        // Region sizes by distance to their pivot, for the stress weights
+        m_RegionCounts.assign(k, std::vector<unsigned int>());
+        for (unsigned long i = 0; i < n; i++)
+        {
+            unsigned int p = m_Regions[i];
+            if (m_Distances[i * k + p] >= m_Unreachable)
+                continue;
+            unsigned int hops = m_Distances[i * k + p];
+            if (m_RegionCounts[p].size() <= hops)
+                m_RegionCounts[p].resize(hops + 1, 0);
+            m_RegionCounts[p][hops]++;
+        }
+        for (auto& counts : m_RegionCounts)
+            for (unsigned int h = 1; h < counts.size(); h++)
+                counts[h] += counts[h - 1];
+    }
+
+    // Pivot MDS : with C the double centered squared distances (n * k), the embedding is C times the top three
+    // eigenvectors of C^T C, scaled to match the pivot distances. Fills m_Embedding, in hops.
+    void embed(unsigned int k)
+    {
+        const unsigned long n = m_Adjacency.size();
+        const unsigned int workers = m_ThreadPool->size();
+
+        // Column means of the squared distances
+        std::vector<std::vector<double>> sums(workers, std::vector<double>(k, 0.0));
+        m_ThreadPool->parallelFor(n, 4096, [&](unsigned int worker, unsigned long begin, unsigned long end)
+        {
+            std::vector<double>& sum = sums[worker];
+            for (unsigned long i = begin; i < end; i++)
+                for (unsigned int p = 0; p < k; p++)
+                    sum[p] += square(m_Distances[i * k + p]);
+        });
+
+        std::vector<double> columns(k, 0.0);
+        double mean = 0;
+        for (unsigned int p = 0; p < k; p++)
+        {
+            for (auto& sum : sums)
+                columns[p] += sum[p];
+            columns[p] /= n;
+            mean += columns[p] / k;
+        }
+
+        auto centered = [&](unsigned long i, double* row)
+        {
+            double rowMean = 0;
+            for (unsigned int p = 0; p < k; p++)
+                rowMean += square(m_Distances[i * k + p]);
+            rowMean /= k;
+
+            for (unsigned int p = 0; p < k; p++)
+                row[p] = -0.5 * (square(m_Distances[i * k + p]) - rowMean - columns[p] + mean);
+        };
+
+        // B = C^T C
+        std::vector<std::vector<double>> products(workers, std::vector<double>(k * k, 0.0));
+        m_ThreadPool->parallelFor(n, 4096, [&](unsigned int worker, unsigned long begin, unsigned long end)
+        {
+            std::vector<double>& B = products[worker];
+            std::vector<double> row(k);
+            for (unsigned long i = begin; i < end; i++)
+            {
+                centered(i, row.data());
+                for (unsigned int a = 0; a < k; a++)
+                    for (unsigned int b = a; b < k; b++)
+                        B[a * k + b] += row[a] * row[b];
+            }
+        });
+
+        std::vector<double> B(k * k, 0.0);
+        for (auto& product : products)
+            for (unsigned int a = 0; a < k; a++)
+                for (unsigned int b = a; b < k; b++)
+                    B[a * k + b] += product[a * k + b];
+        for (unsigned int a = 0; a < k; a++)
+            for (unsigned int b = 0; b < a; b++)
+                B[a * k + b] = B[b * k + a];
+
+        // Orthogonal iterations for the top three eigenvectors
+        const unsigned int dimensions = 3;
+        std::vector<double> V(dimensions * k);
+        for (unsigned long v = 0; v < V.size(); v++)
+            V[v] = Placement::random(m_Seed, v, 4) - 0.5;
+
+        std::vector<double> W(dimensions * k);
+        for (unsigned int it = 0; it < 100; it++)
+        {
+            for (unsigned int d = 0; d < dimensions; d++)
+                for (unsigned int a = 0; a < k; a++)
+                {
+                    double w = 0;
+                    for (unsigned int b = 0; b < k; b++)
+                        w += B[a * k + b] * V[d * k + b];
+                    W[d * k + a] = w;
+                }
+
+            // Gram-Schmidt
+            for (unsigned int d = 0; d < dimensions; d++)
+            {
+                for (unsigned int e = 0; e < d; e++)
+                {
+                    double dot = 0;
+                    for (unsigned int a = 0; a < k; a++)
+                        dot += W[d * k + a] * W[e * k + a];
+                    for (unsigned int a = 0; a < k; a++)
+                        W[d * k + a] -= dot * W[e * k + a];
+                }
+
+                double norm = 0;
+                for (unsigned int a = 0; a < k; a++)
+                    norm += W[d * k + a] * W[d * k + a];
+                norm = sqrt(norm);
+
+                // NOTE : Fewer pivots than dimensions, or a flat graph, leaves null directions
+                for (unsigned int a = 0; a < k; a++)
+                    W[d * k + a] = norm > 1e-12 ? W[d * k + a] / norm : 0.0;
+            }
+
+            std::swap(V, W);
+        }
+
+        m_Embedding.resize(n);
+        m_ThreadPool->parallelFor(n, 4096, [&](unsigned int worker, unsigned long begin, unsigned long end)
+        {
+            (void) worker;
+            std::vector<double> row(k);
+            for (unsigned long i = begin; i < end; i++)
+            {
+                centered(i, row.data());
+
+                double x[dimensions] = { 0, 0, 0 };
+                for (unsigned int d = 0; d < dimensions; d++)
+                    for (unsigned int p = 0; p < k; p++)
+                        x[d] += row[p] * V[d * k + p];
+
+                m_Embedding[i] = glm::vec3(x[0], x[1], x[2]);
+            }
+        });
+
+        // Least squares scale against the pivot distances
+        std::vector<double> dots(workers, 0.0);
+        std::vector<double> norms(workers, 0.0);
+        m_ThreadPool->parallelFor(n, 4096, [&](unsigned int worker, unsigned long begin, unsigned long end)
+        {
+            for (unsigned long i = begin; i < end; i++)
+                for (unsigned int p = 0; p < k; p++)
+                {
+                    double e = glm::length(m_Embedding[i] - m_Embedding[m_Pivots[p]]);
+                    dots[worker] += e * m_Distances[i * k + p];
+                    norms[worker] += e * e;
+                }
+        });
+
+        double dot = 0, norm = 0;
+        for (unsigned int w = 0; w < workers; w++)
+        {
+            dot += dots[w];
+            norm += norms[w];
+        }
+
+        float scale = norm > 0 ? dot / norm : 1.0f;
+        for (auto& x : m_Embedding)
+            x *= scale;
+    }
+
+    // Jacobi iterations of the sparse stress model, every node moves to the weighted average of the positions its
+    // terms want it at : links (length L, weight 1 / L^2) and pivots (length hops * L, weight s / d^2 where s is
+    // the number of nodes of the pivot region within half the distance). Returns the number of iterations.
+    unsigned int majorize(unsigned int k, float length, std::vector<glm::vec3>& layout, const std::vector<bool>& locked)
+    {
+        const unsigned long n = layout.size();
+        const unsigned int workers = m_ThreadPool->size();
+        const std::vector<unsigned int>& neighbors = m_Adjacency.neighbors();
+
+        // Pivot weights by hops, left empty for duplicate pivots (more pivots than nodes within reach)
+        // NOTE : Links already cover the pivots next to a node, weights start at 2 hops. Pivots out of reach get no
+        // weight, their distance is made up.
+        std::vector<std::vector<float>> weights(k);
+        for (unsigned int p = 0; p < k; p++)
+        {
+            if (m_Regions[m_Pivots[p]] != p)
+                continue;
+
+            const std::vector<unsigned int>& counts = m_RegionCounts[p];
+            unsigned int maxHops = 0;
+            for (unsigned long i = 0; i < n; i++)
+                if (m_Distances[i * k + p] < m_Unreachable)
+                    maxHops = std::max(maxHops, (unsigned int) m_Distances[i * k + p]);
+
+            weights[p].assign(maxHops + 1, 0.0f);
+            for (unsigned int h = 2; h <= maxHops; h++)
+            {
+                float d = h * length;
+                weights[p][h] = counts[std::min<unsigned long>(h / 2, counts.size() - 1)] / (d * d);
+            }
+        }
+
+        const float linkWeight = 1.0f / (length * length);
+
+        Vec3Array current;
+        current.resize(n);
+        for (unsigned long i = 0; i < n; i++)
+            current.set(i, layout[i]);
+        Vec3Array next = current;
+
+        std::vector<double> stresses(workers);
+        double previous = 0;
+
+        unsigned int it = 0;
+        while (it < m_MaxIterations)
+        {
+            it++;
+
+            for (auto& stress : stresses)
+                stress = 0;
+
+            m_ThreadPool->parallelFor(n, 1024, [&](unsigned int worker, unsigned long begin, unsigned long end)
+            {
+                const float* X = current.X.data();
+                const float* Y = current.Y.data();
+                const float* Z = current.Z.data();
+
+                for (unsigned long i = begin; i < end; i++)
+                {
+                    if (Placement::isLocked(locked, i))
+                        continue;
+
+                    const float x = X[i], y = Y[i], z = Z[i];
+                    float sx = 0, sy = 0, sz = 0, sw = 0;
+                    float stress = 0;
+
+                    // Moves toward the point at distance d from j, on the line from j to i
+                    auto term = [&](unsigned long j, float d, float w)
+                    {
+                        float dx = x - X[j], dy = y - Y[j], dz = z - Z[j];
+                        float distance2 = dx * dx + dy * dy + dz * dz;
+                        float distance = std::sqrt(distance2);
+                        float f = distance > 1e-6f ? w * d / distance : 0.0f;
+                        stress += w * (distance - d) * (distance - d);
+                        sx += w * X[j] + f * dx;
+                        sy += w * Y[j] + f * dy;
+                        sz += w * Z[j] + f * dz;
+                        sw += w;
+                    };
+
+                    for (unsigned int l = m_Adjacency.begin(i); l < m_Adjacency.end(i); l++)
+                        if (neighbors[l] != i)
+                            term(neighbors[l], length, linkWeight);
+
+                    const float* distances = &m_Distances[i * k];
+                    for (unsigned int p = 0; p < k; p++)
+                    {
+                        unsigned int hops = distances[p];
+                        if (hops < weights[p].size() && weights[p][hops] > 0)
+                            term(m_Pivots[p], hops * length, weights[p][hops]);
+                    }
+
+                    if (sw > 0)
+                        next.set(i, glm::vec3(sx / sw, sy / sw, sz / sw));
+                    stresses[worker] += stress;
+                }
+            });
+
+            std::swap(current, next);
+
+            // NOTE : The stress is the one of the layout before the moves, it comes for free with the terms
+            double stress = 0;
+            for (auto s : stresses)
+                stress += s;
+            if (stress <= m_Tolerance * n || (it > 1 && previous - stress <= m_Tolerance * previous))
+                break;
+            previous = stress;
+        }
+
+        for (unsigned long i = 0; i < n; i++)
+            layout[i] = current.get(i);
+
+        return it;
+    }
+
+    static inline double square(double x) { return x * x; }
+
+    ThreadPool* m_ThreadPool;
+
+    unsigned int m_PivotCount;
+    unsigned int m_MaxIterations;
+    float m_Tolerance;
+    float m_Unreachable;                                    // Distance given to the pairs in different components
+    unsigned long long m_Seed;
+
+    LinkAdjacency m_Adjacency;
+    std::vector<unsigned int> m_Pivots;
+    std::vector<float> m_Distances;                         // Hops from each node to each pivot, n * k
+    std::vector<unsigned int> m_Regions;                    // Closest pivot of each node
+    std::vector<std::vector<unsigned int>> m_RegionCounts;  // Nodes of each region within a number of hops
+    std::vector<glm::vec3> m_Embedding;
+};
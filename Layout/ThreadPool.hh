@@ -0,0 +1,197 @@
+#pragma once
+
+#include <graphiti/Layout/Headers.hh>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed size pool running parallel loops for the layout forces.
+// A loop is cut into chunks spread over per worker queues, workers pop from the front
+// of their own queue and steal from the back of the others when they run dry.
+// The calling thread takes part as worker 0, so a pool of size 1 runs everything inline.
+class ThreadPool
+{
+public:
+    typedef std::function<void (unsigned int worker, unsigned long begin, unsigned long end)> Task;
+
+    ThreadPool(unsigned int threads = 0)
+    {
+        m_Task = NULL;
+        m_Pending = 0;
+        m_Generation = 0;
+        m_Stop = false;
+
+        resize(threads);
+    }
+
+    ~ThreadPool()
+    {
+        stop();
+    }
+
+    // 0 uses the hardware concurrency
+    void resize(unsigned int threads)
+    {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+
+        if (threads == size())
+            return;
+
+        stop();
+
+        m_Stop = false;
+        for (unsigned int i = 0; i < threads; i++)
+            m_Queues.push_back(new Queue());
+        for (unsigned int i = 1; i < threads; i++)
+            m_Threads.push_back(std::thread(&ThreadPool::run, this, i));
+
+        LOG("[THREADPOOL] %u workers.\n", threads);
+    }
+
+    inline unsigned int size() const { return m_Queues.size(); }
+
+    // Calls task(worker, begin, end) over [0, count) in chunks of at least grain items and waits for completion.
+    // NOTE : Tasks must not call parallelFor themselves.
+    void parallelFor(unsigned long count, unsigned long grain, const Task& task)
+    {
+        if (count == 0)
+            return;
+
+        unsigned int workers = size();
+        if (workers <= 1 || count <= grain)
+        {
+            task(0, 0, count);
+            return;
+        }
+
+        // NOTE : Several chunks per worker so the stealing can even out uneven loads
+        unsigned long chunk = std::max(grain, (count + 8 * workers - 1) / (8 * workers));
+        unsigned long chunks = (count + chunk - 1) / chunk;
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+
+            m_Task = &task;
+            m_Pending = chunks;
+
+            for (unsigned long c = 0; c < chunks; c++)
+            {
+                Queue* queue = m_Queues[c * workers / chunks];
+                std::lock_guard<std::mutex> qlock(queue->Mutex);
+                queue->Ranges.push_back(Range(c * chunk, std::min(count, (c + 1) * chunk)));
+            }
+
+            m_Generation++;
+        }
+        m_Wake.notify_all();
+
+        work(0);
+
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_Done.wait(lock, [this]() { return m_Pending == 0; });
+        m_Task = NULL;
+    }
+
+private:
+    typedef std::pair<unsigned long, unsigned long> Range;
+
+    struct Queue
+    {
+        std::mutex Mutex;
+        std::deque<Range> Ranges;
+    };
+
+    bool pop(unsigned int worker, Range& range)
+    {
+        for (unsigned int i = 0; i < m_Queues.size(); i++)
+        {
+            Queue* queue = m_Queues[(worker + i) % m_Queues.size()];
+            std::lock_guard<std::mutex> lock(queue->Mutex);
+
+            if (queue->Ranges.empty())
+                continue;
+
+            if (i == 0)
+            {
+                range = queue->Ranges.front();
+                queue->Ranges.pop_front();
+            }
+            else
+            {
+                range = queue->Ranges.back();
+                queue->Ranges.pop_back();
+            }
+            return true;
+        }
+
+        return false;
+    }
+
+    void work(unsigned int worker)
+    {
+        Range range;
+        while (pop(worker, range))
+        {
+            (*m_Task)(worker, range.first, range.second);
+
+            if (--m_Pending == 0)
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Done.notify_all();
+            }
+        }
+    }
+
+    void run(unsigned int worker)
+    {
+        unsigned long generation = 0;
+
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Wake.wait(lock, [&]() { return m_Stop || m_Generation != generation; });
+                if (m_Stop)
+                    return;
+                generation = m_Generation;
+            }
+
+            work(worker);
+        }
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stop = true;
+        }
+        m_Wake.notify_all();
+
+        for (auto& thread : m_Threads)
+            thread.join();
+        m_Threads.clear();
+
+        for (auto queue : m_Queues)
+            delete queue;
+        m_Queues.clear();
+    }
+
+    std::vector<std::thread> m_Threads;
+    std::vector<Queue*> m_Queues;
+
+    const Task* m_Task;
+    std::atomic<unsigned long> m_Pending;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::condition_variable m_Done;
+    unsigned long m_Generation;
+    bool m_Stop;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+
+// Lock-free single producer / single consumer triple buffer.
+// The writer fills back() and publishes it, the reader picks up the latest published buffer with update().
+// Neither side ever waits, intermediate buffers are dropped when the writer is faster than the reader.
+template <class T>
+class TripleBuffer
+{
+public:
+    TripleBuffer()
+    {
+        m_Back = 0;
+        m_Shared = 1;
+        m_Front = 2;
+    }
+
+    // ----- Writer -----
+
+    inline T& back() { return m_Buffers[m_Back]; }
+
+    void publish()
+    {
+        m_Back = m_Shared.exchange(m_Back | Dirty) & Index;
+    }
+
+    // ----- Reader -----
+
+    // Returns true when a new buffer was published since the last call
+    bool update()
+    {
+        if ((m_Shared.load() & Dirty) == 0)
+            return false;
+
+        m_Front = m_Shared.exchange(m_Front) & Index;
+        return true;
+    }
+
+    inline const T& front() const { return m_Buffers[m_Front]; }
+
+private:
+    enum { Index = 3, Dirty = 4 };
+
+    T m_Buffers[3];
+
+    unsigned int m_Back;
+    std::atomic<unsigned int> m_Shared;
+    unsigned int m_Front;
+};
@@ -12,7 +12,11 @@ class Load(script.Script):
 			self.console.log("Usage: {0} <filename>".format(args[0]))
 			return
 
-		std.load_json(" ".join(args[1:]))
+		filename = " ".join(args[1:])
+		if filename.endswith(".ogs"):
+			og.load_snapshot(filename)
+		else:
+			std.load_json(filename)
 
 class Save(script.Script):
 	def run(self, args):
@@ -23,7 +27,10 @@ class Save(script.Script):
 			self.console.log("Error: File already exists!")
 			return
 		
-		std.save_json(args[1])
+		if args[1].endswith(".ogs"):
+			og.save_snapshot(args[1])
+		else:
+			std.save_json(args[1])
 		self.console.log("File saved in '{0}'.".format(args[1]))
 
 class Clear(script.Script):
@@ -148,6 +148,9 @@ def on_started():
         else:
             print("Unrecognized format <'" + sys.argv[2] + "'> !")
 
+    # NOTE : Streamed nodes only relax their neighbourhood instead of the whole graph
+    og.set_attribute("og:space:layout:incremental", "bool", "True")
+
     global nodes
     for nid in og.get_node_ids():
         label = og.get_node_label(nid)
@@ -139,12 +139,18 @@ def load_json(json_filename):
             graphiti.set_attribute(key, att_info[0], att_info[1])
 
     print(". Loading nodes ...")
+    labels = []
     for n in data["nodes"]:
         label = ""
         if "label" in n:
             label = n["label"].encode("utf-8")
-        
-        nid = graphiti.add_node(label)
+        labels.append(label)
+
+    nids = graphiti.add_nodes(labels)
+
+    # NOTE : Attributes are grouped by name and type so each group is set in one call
+    batches = {}
+    for n, nid in zip(data["nodes"], nids):
         nodes[n["id"]] = nid
 
         for key in n.keys():
@@ -154,14 +160,27 @@ def load_json(json_filename):
             if att_info is None:
                 print("Error: Couldn't parse key '" + key + "' with value '" + str(n[key]) + "'!")
                 continue
-            graphiti.set_node_attribute(nid, key, att_info[0], att_info[1])
+            batch = batches.setdefault((key, att_info[0]), ([], []))
+            batch[0].append(nid)
+            batch[1].append(att_info[1] if att_info[0] == "string" else n[key])
+
+    for (key, att_type), (ids, values) in batches.items():
+        graphiti.set_node_attributes(ids, key, att_type, values)
 
     print(". Loading edges ...")
+    sources = []
+    targets = []
     for e in data["edges"]:
         if "src" in e:
-            eid = graphiti.add_edge(nodes[e["src"]], nodes[e["dst"]])
+            sources.append(nodes[e["src"]])
+            targets.append(nodes[e["dst"]])
         else:
-            eid = graphiti.add_edge(nodes[e['source']], nodes[e['target']])
+            sources.append(nodes[e['source']])
+            targets.append(nodes[e['target']])
+
+    eids = graphiti.add_edges(sources, targets)
+
+    for e, eid in zip(data["edges"], eids):
         edges[e["id"]] = eid
 
         for key in e.keys():
@@ -169,12 +188,13 @@ def load_json(json_filename):
                 continue
             att_info = get_attribute_info(e[key])
             if att_info is None:
-                print("Error: Couldn't parse key '" + key + "' with value '" + str(n[key]) + "'!")
+                print("Error: Couldn't parse key '" + key + "' with value '" + str(e[key]) + "'!")
                 continue
             graphiti.set_edge_attribute(eid, key, att_info[0], att_info[1])
 
     if "timeline" in data:
         print(". Loading timeline ...")
+        commands = list()
         for c in data["timeline"]:
             # TODO : Get rid of this translation phase when possible.
             if c[1].startswith("graph:"):
@@ -185,12 +205,23 @@ def load_json(json_filename):
                 elif c[1] in ["graph:add_edge"]:
                     c[2]["src"] = nodes[c[2]["src"]]
                     c[2]["dst"] = nodes[c[2]["dst"]]
-            graphiti.send_command(c[0], c[1], c[2])
+            commands.append(c)
+        graphiti.send_commands(commands)
 
     print("Done.")
 
-def save_json(filename):
-    
+def save_json(filename, compact = False):
+
+    global node_attributes
+    global edge_attributes
+
+    # NOTE : Model attributes are written from their columns, view attributes have to be listed
+    if hasattr(graphiti, "save_json_native"):
+        node_views = [a['name'] for a in node_attributes if a['name'].startswith("og:")]
+        edge_views = [a['name'] for a in edge_attributes if a['name'].startswith("og:")]
+        graphiti.save_json_native(filename, compact, node_views, edge_views)
+        return
+
     graph = {}
     graph["meta"] = dict()
     graph["nodes"] = list()
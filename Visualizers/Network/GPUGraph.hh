@@ -2,9 +2,13 @@
 #include <raindance/Core/OpenCL.hh>
 #include <raindance/Core/Intersection.hh>
 
+#include <graphiti/Visualizers/Network/NetworkPhysics.hh>
+
 class GPUGraph 
 {
 public:
+    // NOTE : AUTO runs the OpenCL kernels when a device is available and falls back to the CPU otherwise
+    enum Backend { AUTO, OPENCL, CPU };
 
     struct ParticleForce 
     {
@@ -52,6 +56,30 @@ public:
         cl_float __Unused; // NOTE : Memory alignment with OpenCL, reserved for later.
 	};
 
+    // Instances changed since the last upload to OpenGL
+    struct DirtyInstances
+    {
+        DirtyInstances() : All(false) {}
+
+        void clear()
+        {
+            All = false;
+            IDs.clear();
+        }
+
+        bool All;
+        std::vector<unsigned int> IDs;
+    };
+
+    // Instance moved by a removal, from the last slot to the freed one
+    struct Move
+    {
+        Move(unsigned int from, unsigned int to) : From(from), To(to) {}
+
+        unsigned int From;
+        unsigned int To;
+    };
+
 	GPUGraph()
 	{
 		m_NodeIcon = new Icon();
@@ -79,7 +107,21 @@ public:
         // m_EdgeShader->dump();
 
         m_NeedsUpdate = true;
+        m_NodeCount = 0;
+        m_EdgeCount = 0;
+        m_NodeCapacity = 0;
+        m_EdgeCapacity = 0;
+        m_Backend = AUTO;
+        m_Iteration = 0;
         m_CL.RunPhysics = false;
+        m_CL.Available = false;
+        m_CL.Shared = false;
+        m_CL.LinksChanged = true;
+        m_CL.LinkOffsets = NULL;
+        m_CL.LinkNeighbors = NULL;
+        m_CL.GroupSize = 64;
+        m_CL.NodeCount = 0;
+        m_CL.EdgeCount = 0;
 	}
 
 	virtual ~GPUGraph()
@@ -89,6 +131,11 @@ public:
 
         SAFE_DELETE(m_EdgeIcon);
         ResourceManager::getInstance().unload(m_EdgeShader);
+
+        if (m_CL.LinkOffsets != NULL)
+            clReleaseMemObject(m_CL.LinkOffsets);
+        if (m_CL.LinkNeighbors != NULL)
+            clReleaseMemObject(m_CL.LinkNeighbors);
 	}
 
     void initialize(Context* context)
@@ -113,6 +160,12 @@ public:
             m_OpenCL.detect();
             //m_OpenCL.dump();
 
+            if (m_OpenCL.devices().empty())
+            {
+                LOG("[NETWORK] No OpenCL device, the physics run on the CPU.\n");
+                return;
+            }
+
             // NOTE : We are assuming the last device is the best one.
             m_CL.Device = m_OpenCL.devices().back();
 
@@ -131,6 +184,8 @@ public:
             m_CL.EdgeAnimationK = m_OpenCL.createKernel(*m_CL.Program, "edge_animation");
 
             clFinish(m_CL.Queue->Object);
+
+            m_CL.Available = true;
         }
     }
 
@@ -140,61 +195,110 @@ public:
 
         // LOG("updateOpenGL: %u nodes, %u edges.\n", m_NodeBuffer.size() / sizeof(Node), m_EdgeBuffer.size() / sizeof(Edge));
 
-        if (m_NodeInstanceBuffer.size() == 0) // TODO: HACK: OpenGL doesn't like VBO resizing, Find a way to handle it properly.
-            return;
-
         // --- Define Node Instances
 
-        static bool m_NodeInstanceBufferFirstUpdate = true;
-
-        if (!m_NodeInstanceBufferFirstUpdate)
-            m_NodeInstanceBuffer.update();
-
-        m_NodeInstanceBuffer.describe("a_Position", 4, GL_FLOAT, sizeof(NodeInstance), 0);
-        m_NodeInstanceBuffer.describe("a_Color",    4, GL_FLOAT, sizeof(NodeInstance), 1 * sizeof(glm::vec4));
-        m_NodeInstanceBuffer.describe("a_Size",     1, GL_FLOAT, sizeof(NodeInstance), 2 * sizeof(glm::vec4));
- 
-        if (m_NodeInstanceBufferFirstUpdate)
+        if (m_NodeInstanceBuffer.size() > 0 && m_NodeCapacity == 0)
+        {
+            m_NodeInstanceBuffer.describe("a_Position", 4, GL_FLOAT, sizeof(NodeInstance), 0);
+            m_NodeInstanceBuffer.describe("a_Color",    4, GL_FLOAT, sizeof(NodeInstance), 1 * sizeof(glm::vec4));
+            m_NodeInstanceBuffer.describe("a_Size",     1, GL_FLOAT, sizeof(NodeInstance), 2 * sizeof(glm::vec4));
             m_NodeInstanceBuffer.generate(Buffer::DYNAMIC);
 
-        m_NodeInstanceBufferFirstUpdate = false;
+            m_NodeCapacity = m_NodeInstanceBuffer.size() / sizeof(NodeInstance);
+            m_DirtyNodes.clear();
+        }
 
         // --- Define Edge Instances
 
-        static bool m_EdgeInstanceBufferFirstUpdate = true;
-       
-        if (!m_EdgeInstanceBufferFirstUpdate)
-            m_EdgeInstanceBuffer.update();
-
-        m_EdgeInstanceBuffer.describe("a_SourcePosition", 4, GL_FLOAT, sizeof(EdgeInstance), 0);
-        m_EdgeInstanceBuffer.describe("a_SourceColor",    4, GL_FLOAT, sizeof(EdgeInstance), 1 * sizeof(glm::vec4));
-        m_EdgeInstanceBuffer.describe("a_TargetPosition", 4, GL_FLOAT, sizeof(EdgeInstance), 2 * sizeof(glm::vec4));
-        m_EdgeInstanceBuffer.describe("a_TargetColor",    4, GL_FLOAT, sizeof(EdgeInstance), 3 * sizeof(glm::vec4));
-        m_EdgeInstanceBuffer.describe("a_Width",          1, GL_FLOAT, sizeof(EdgeInstance), 4 * sizeof(glm::vec4));
-        
-        if (m_EdgeInstanceBufferFirstUpdate)
+        if (m_EdgeInstanceBuffer.size() > 0 && m_EdgeCapacity == 0)
+        {
+            m_EdgeInstanceBuffer.describe("a_SourcePosition", 4, GL_FLOAT, sizeof(EdgeInstance), 0);
+            m_EdgeInstanceBuffer.describe("a_SourceColor",    4, GL_FLOAT, sizeof(EdgeInstance), 1 * sizeof(glm::vec4));
+            m_EdgeInstanceBuffer.describe("a_TargetPosition", 4, GL_FLOAT, sizeof(EdgeInstance), 2 * sizeof(glm::vec4));
+            m_EdgeInstanceBuffer.describe("a_TargetColor",    4, GL_FLOAT, sizeof(EdgeInstance), 3 * sizeof(glm::vec4));
+            m_EdgeInstanceBuffer.describe("a_Width",          1, GL_FLOAT, sizeof(EdgeInstance), 4 * sizeof(glm::vec4));
             m_EdgeInstanceBuffer.generate(Buffer::DYNAMIC);
-        
-        m_EdgeInstanceBufferFirstUpdate = false;   
+
+            m_EdgeCapacity = m_EdgeInstanceBuffer.size() / sizeof(EdgeInstance);
+            m_DirtyEdges.clear();
+        }
+
+        // NOTE : The OpenCL memory objects wrap the OpenGL buffers, they are created again after a reallocation.
+        // The kernels' results are read back first since the reallocation uploads the CPU copy.
+        bool grow = m_NodeCount > m_NodeCapacity || m_EdgeCount > m_EdgeCapacity;
+        if (grow && m_CL.Shared)
+        {
+            readOpenCL();
+            releaseOpenCL();
+        }
+
+        if (m_NodeCapacity > 0)
+            upload(m_NodeInstanceBuffer, sizeof(NodeInstance), m_NodeCount, m_NodeCapacity, m_DirtyNodes);
+        if (m_EdgeCapacity > 0)
+            upload(m_EdgeInstanceBuffer, sizeof(EdgeInstance), m_EdgeCount, m_EdgeCapacity, m_DirtyEdges);
     }
 
-    void updateOpenCL(Context* context)
+    // Uploads the dirty instances of a buffer, in runs of consecutive instances. When the instances outgrow the
+    // buffer, it is reallocated with a geometric growth and uploaded whole.
+    // NOTE : Only the first count instances are live, removed ones stay past the end of the CPU buffer
+    void upload(Buffer& buffer, size_t stride, size_t count, size_t& capacity, DirtyInstances& dirty)
     {
-        size_t node_count = m_NodeInstanceBuffer.size() / sizeof(NodeInstance);
-        size_t edge_count = m_EdgeInstanceBuffer.size() / sizeof(EdgeInstance);
+        const char* data = reinterpret_cast<const char*>(buffer.ptr());
 
-        if (node_count == 0 || !m_CL.RunPhysics) // TODO: HACK: OpenGL doesn't like VBO resizing, Find a way to handle it properly.
-            return;
+        glBindBuffer(GL_ARRAY_BUFFER, buffer.vbo());
 
-        static bool m_OCLNeedsUpdate = true;
-        if (m_OCLNeedsUpdate)
+        if (count > capacity)
         {
-            m_CL.NodeInstanceBuffer = m_OpenCL.createFromGLBuffer(*m_CL.Context, CL_MEM_READ_WRITE, m_NodeInstanceBuffer.vbo());
-            m_CL.EdgeInstanceBuffer = m_OpenCL.createFromGLBuffer(*m_CL.Context, CL_MEM_READ_WRITE, m_EdgeInstanceBuffer.vbo());
-            clFinish(m_CL.Queue->Object);
-            m_OCLNeedsUpdate = false;
+            capacity = std::max(count, 2 * capacity);
+            glBufferData(GL_ARRAY_BUFFER, capacity * stride, NULL, GL_DYNAMIC_DRAW);
+            dirty.All = true;
         }
 
+        if (dirty.All)
+            glBufferSubData(GL_ARRAY_BUFFER, 0, count * stride, data);
+        else if (!dirty.IDs.empty())
+        {
+            std::sort(dirty.IDs.begin(), dirty.IDs.end());
+
+            size_t begin = dirty.IDs[0];
+            size_t end = begin + 1;
+            for (size_t i = 1; i <= dirty.IDs.size(); i++)
+            {
+                if (i < dirty.IDs.size() && dirty.IDs[i] <= end)
+                {
+                    end = std::max<size_t>(end, dirty.IDs[i] + 1);
+                    continue;
+                }
+
+                end = std::min(end, count);
+                if (begin < end)
+                    glBufferSubData(GL_ARRAY_BUFFER, begin * stride, (end - begin) * stride, data + begin * stride);
+
+                if (i < dirty.IDs.size())
+                {
+                    begin = dirty.IDs[i];
+                    end = begin + 1;
+                }
+            }
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        dirty.clear();
+    }
+
+    void updatePhysics(Context* context)
+    {
+        size_t node_count = m_NodeCount;
+        size_t edge_count = m_EdgeCount;
+
+        if (node_count == 0 || !m_CL.RunPhysics)
+            return;
+
+        // NOTE : The kernels need both buffers, edges aren't generated until the first one comes
+        if (getBackend() == OPENCL && m_EdgeCapacity == 0)
+            return;
+
         // ----- Parameters -----
 
         const float Cooling = 0.5; // NOTE : 0+ (slow) to infinity (fast)
@@ -205,8 +309,7 @@ public:
 
         const int Iterations = static_cast<int>(final) + 1;
 
-        static int iteration = 0;
-        if (iteration >= Iterations)
+        if (m_Iteration >= Iterations)
             return;
 
         const float volume = CubeSide * CubeSide * CubeSide; 
@@ -215,25 +318,69 @@ public:
 
         m_CL.Time = context->clock().seconds();
 
-        m_CL.Temperature = CubeSide / (Cooling * (iteration + 1) - (Cooling - 1));
+        m_CL.Temperature = CubeSide / (Cooling * (m_Iteration + 1) - (Cooling - 1));
+
+        LOG("Iteration: %i, K: %f, Time: %f, Temperature: %f\n", m_Iteration, m_CL.K, m_CL.Time, m_CL.Temperature);
+
+        if (getBackend() == OPENCL)
+            updateOpenCL(node_count, edge_count);
+        else
+            updateCPU(node_count, edge_count);
+
+        m_Iteration++;
+
+        // ----- Copy back to CPU Data -----
+
+        if (m_Iteration == Iterations)
+        {
+            if (getBackend() == OPENCL)
+                syncOpenCL();
+
+            m_CL.RunPhysics = false;
+        }
+    }
 
-        LOG("Iteration: %i, K: %f, Time: %f, Temperature: %f\n", iteration, m_CL.K, m_CL.Time, m_CL.Temperature);
+    void updateOpenCL(size_t node_count, size_t edge_count)
+    {
+        if (!m_CL.Shared)
+        {
+            m_CL.NodeInstanceBuffer = m_OpenCL.createFromGLBuffer(*m_CL.Context, CL_MEM_READ_WRITE, m_NodeInstanceBuffer.vbo());
+            m_CL.EdgeInstanceBuffer = m_OpenCL.createFromGLBuffer(*m_CL.Context, CL_MEM_READ_WRITE, m_EdgeInstanceBuffer.vbo());
+            clFinish(m_CL.Queue->Object);
+            m_CL.Shared = true;
+        }
+
+        m_CL.NodeCount = node_count;
+        m_CL.EdgeCount = edge_count;
+
+        if (m_CL.LinksChanged)
+            updateLinks(node_count, edge_count);
+
+        cl_uint count = node_count;
 
         m_OpenCL.enqueueAcquireGLObjects(*m_CL.Queue, 1, &m_CL.NodeInstanceBuffer->Object, 0, 0, NULL);
         m_OpenCL.enqueueAcquireGLObjects(*m_CL.Queue, 1, &m_CL.EdgeInstanceBuffer->Object, 0, 0, NULL);
         {
             // ----- Node Repulsion -----
-            
+
+            // NOTE : One work-item per node, rounded up to whole work groups, each group shares a tile of positions
+            size_t group_size = m_CL.GroupSize;
+            size_t global_size = (node_count + group_size - 1) / group_size * group_size;
+
             m_CL.RepulsionK->setArgument(0, *m_CL.NodeInstanceBuffer);
-            m_CL.RepulsionK->setArgument(1, &m_CL.K, sizeof(float));
-            m_OpenCL.enqueueNDRangeKernel(*m_CL.Queue, *m_CL.RepulsionK, 1, NULL, &node_count, NULL, 0, NULL, NULL);
+            m_CL.RepulsionK->setArgument(1, &count, sizeof(cl_uint));
+            m_CL.RepulsionK->setArgument(2, &m_CL.K, sizeof(float));
+            m_CL.RepulsionK->setArgument(3, NULL, group_size * sizeof(cl_float4));
+            m_OpenCL.enqueueNDRangeKernel(*m_CL.Queue, *m_CL.RepulsionK, 1, NULL, &global_size, &group_size, 0, NULL, NULL);
 
             // ----- Edge Attraction -----
 
             m_CL.AttractionK->setArgument(0, *m_CL.NodeInstanceBuffer);
-            m_CL.AttractionK->setArgument(1, *m_CL.EdgeInstanceBuffer);
-            m_CL.AttractionK->setArgument(2, &m_CL.K, sizeof(float));
-            m_OpenCL.enqueueNDRangeKernel(*m_CL.Queue, *m_CL.AttractionK, 1, NULL, &edge_count, NULL, 0, NULL, NULL);
+            m_CL.AttractionK->setArgument(1, &m_CL.LinkOffsets, sizeof(cl_mem));
+            m_CL.AttractionK->setArgument(2, &m_CL.LinkNeighbors, sizeof(cl_mem));
+            m_CL.AttractionK->setArgument(3, &count, sizeof(cl_uint));
+            m_CL.AttractionK->setArgument(4, &m_CL.K, sizeof(float));
+            m_OpenCL.enqueueNDRangeKernel(*m_CL.Queue, *m_CL.AttractionK, 1, NULL, &node_count, NULL, 0, NULL, NULL);
 
             // ----- Node Animation -----
 
@@ -243,34 +390,129 @@ public:
 
             // ----- Edge Animation -----
 
-            m_CL.EdgeAnimationK->setArgument(0, *m_CL.NodeInstanceBuffer);
-            m_CL.EdgeAnimationK->setArgument(1, *m_CL.EdgeInstanceBuffer);  
-            m_OpenCL.enqueueNDRangeKernel(*m_CL.Queue, *m_CL.EdgeAnimationK, 1, NULL, &edge_count, NULL, 0, NULL, NULL);
+            if (edge_count > 0)
+            {
+                m_CL.EdgeAnimationK->setArgument(0, *m_CL.NodeInstanceBuffer);
+                m_CL.EdgeAnimationK->setArgument(1, *m_CL.EdgeInstanceBuffer);  
+                m_OpenCL.enqueueNDRangeKernel(*m_CL.Queue, *m_CL.EdgeAnimationK, 1, NULL, &edge_count, NULL, 0, NULL, NULL);
+            }
         }
         m_OpenCL.enqueueReleaseGLObjects(*m_CL.Queue, 1, &m_CL.EdgeInstanceBuffer->Object, 0, 0, NULL);
         m_OpenCL.enqueueReleaseGLObjects(*m_CL.Queue, 1, &m_CL.NodeInstanceBuffer->Object, 0, 0, NULL);
 
         clFinish(m_CL.Queue->Object);
+    }
 
-        iteration++;
+    // Adjacency lists of the nodes (CSR) for the attraction kernel, both directions of every edge
+    void updateLinks(size_t node_count, size_t edge_count)
+    {
+        std::vector<cl_uint> offsets(node_count + 1, 0);
+        std::vector<cl_uint> neighbors(std::max<size_t>(1, 2 * edge_count), 0); // NOTE : OpenCL buffers can't be empty
 
-        // ----- Copy back to CPU Data -----
+        EdgeInstance edge;
+        for (size_t e = 0; e < edge_count; e++)
+        {
+            m_EdgeInstanceBuffer.get(e, &edge, sizeof(EdgeInstance));
+            offsets[edge.SourceID + 1]++;
+            offsets[edge.TargetID + 1]++;
+        }
+        for (size_t n = 0; n < node_count; n++)
+            offsets[n + 1] += offsets[n];
 
-        if (iteration == Iterations)
+        std::vector<cl_uint> cursor(offsets.begin(), offsets.end() - 1);
+        for (size_t e = 0; e < edge_count; e++)
         {
-            m_OpenCL.enqueueAcquireGLObjects(*m_CL.Queue, 1, &m_CL.NodeInstanceBuffer->Object, 0, 0, NULL);
-            m_OpenCL.enqueueAcquireGLObjects(*m_CL.Queue, 1, &m_CL.EdgeInstanceBuffer->Object, 0, 0, NULL);
-            {
-                m_OpenCL.enqueueReadBuffer(*m_CL.Queue, *m_CL.NodeInstanceBuffer, CL_TRUE, 0, m_NodeInstanceBuffer.size(), m_NodeInstanceBuffer.ptr(), 0, NULL, NULL);
-                m_OpenCL.enqueueReadBuffer(*m_CL.Queue, *m_CL.EdgeInstanceBuffer, CL_TRUE, 0, m_EdgeInstanceBuffer.size(), m_EdgeInstanceBuffer.ptr(), 0, NULL, NULL);
-            }
-            m_OpenCL.enqueueReleaseGLObjects(*m_CL.Queue, 1, &m_CL.EdgeInstanceBuffer->Object, 0, 0, NULL);
-            m_OpenCL.enqueueReleaseGLObjects(*m_CL.Queue, 1, &m_CL.NodeInstanceBuffer->Object, 0, 0, NULL);
-            
-            clFinish(m_CL.Queue->Object);
+            m_EdgeInstanceBuffer.get(e, &edge, sizeof(EdgeInstance));
+            neighbors[cursor[edge.SourceID]++] = edge.TargetID;
+            neighbors[cursor[edge.TargetID]++] = edge.SourceID;
+        }
 
-            m_CL.RunPhysics = false;
+        if (m_CL.LinkOffsets != NULL)
+            clReleaseMemObject(m_CL.LinkOffsets);
+        if (m_CL.LinkNeighbors != NULL)
+            clReleaseMemObject(m_CL.LinkNeighbors);
+
+        cl_int error;
+        m_CL.LinkOffsets = clCreateBuffer(m_CL.Context->Object, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, offsets.size() * sizeof(cl_uint), offsets.data(), &error);
+        m_CL.LinkNeighbors = clCreateBuffer(m_CL.Context->Object, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, neighbors.size() * sizeof(cl_uint), neighbors.data(), &error);
+        if (error != CL_SUCCESS)
+            LOG("[NETWORK] Couldn't upload the adjacency lists (%i)!\n", error);
+
+        m_CL.LinksChanged = false;
+    }
+
+    // Releases the OpenCL memory objects wrapping the OpenGL buffers
+    void releaseOpenCL()
+    {
+        if (!m_CL.Shared)
+            return;
+
+        clReleaseMemObject(m_CL.NodeInstanceBuffer->Object);
+        clReleaseMemObject(m_CL.EdgeInstanceBuffer->Object);
+        SAFE_DELETE(m_CL.NodeInstanceBuffer);
+        SAFE_DELETE(m_CL.EdgeInstanceBuffer);
+
+        m_CL.Shared = false;
+    }
+
+    // Copies the instances computed by the kernels back to the CPU buffers
+    void readOpenCL()
+    {
+        if (!m_CL.Shared)
+            return;
+
+        m_OpenCL.enqueueAcquireGLObjects(*m_CL.Queue, 1, &m_CL.NodeInstanceBuffer->Object, 0, 0, NULL);
+        m_OpenCL.enqueueAcquireGLObjects(*m_CL.Queue, 1, &m_CL.EdgeInstanceBuffer->Object, 0, 0, NULL);
+        {
+            read(*m_CL.NodeInstanceBuffer, m_NodeInstanceBuffer, sizeof(NodeInstance), m_CL.NodeCount, m_DirtyNodes);
+            read(*m_CL.EdgeInstanceBuffer, m_EdgeInstanceBuffer, sizeof(EdgeInstance), m_CL.EdgeCount, m_DirtyEdges);
         }
+        m_OpenCL.enqueueReleaseGLObjects(*m_CL.Queue, 1, &m_CL.EdgeInstanceBuffer->Object, 0, 0, NULL);
+        m_OpenCL.enqueueReleaseGLObjects(*m_CL.Queue, 1, &m_CL.NodeInstanceBuffer->Object, 0, 0, NULL);
+        
+        clFinish(m_CL.Queue->Object);
+    }
+
+    // NOTE : Instances changed on the CPU since the last upload are newer than the kernels' copy, they are kept
+    void read(OpenCL::Memory& memory, Buffer& buffer, size_t stride, size_t count, const DirtyInstances& dirty)
+    {
+        if (count == 0 || dirty.All)
+            return;
+
+        std::vector<char> kept(dirty.IDs.size() * stride);
+        for (size_t i = 0; i < dirty.IDs.size(); i++)
+            if (dirty.IDs[i] < count)
+                buffer.get(dirty.IDs[i], &kept[i * stride], stride);
+
+        m_OpenCL.enqueueReadBuffer(*m_CL.Queue, memory, CL_TRUE, 0, count * stride, buffer.ptr(), 0, NULL, NULL);
+
+        for (size_t i = 0; i < dirty.IDs.size(); i++)
+            if (dirty.IDs[i] < count)
+                buffer.set(dirty.IDs[i], &kept[i * stride], stride);
+    }
+
+    // Reads back the kernels' results before the CPU instances are used or moved (picking, bounds, removals, pause).
+    // The OpenCL copy is stale from then on and isn't read again until the kernels ran on the uploaded instances.
+    void syncOpenCL()
+    {
+        if (m_CL.Shared && m_CL.NodeCount > 0)
+            readOpenCL();
+
+        m_CL.NodeCount = 0;
+        m_CL.EdgeCount = 0;
+    }
+
+    // NOTE : The instances are updated in place, the OpenGL buffers are refreshed on the next idle
+    void updateCPU(size_t node_count, size_t edge_count)
+    {
+        m_CPU.run(reinterpret_cast<NodeInstance*>(m_NodeInstanceBuffer.ptr()), node_count,
+                  reinterpret_cast<EdgeInstance*>(m_EdgeInstanceBuffer.ptr()), edge_count,
+                  m_CL.K, m_CL.Temperature);
+
+        m_DirtyNodes.All = true;
+        m_DirtyEdges.All = true;
+
+        m_NeedsUpdate = true;
     }
 
 	void idle(Context* context)
@@ -281,12 +523,12 @@ public:
             m_NeedsUpdate = false; 
         }
 
-        updateOpenCL(context);        
+        updatePhysics(context);
 	}
 
 	virtual void drawEdges(Context* context, Camera& camera, Transformation& transformation)
 	{
-        if (!m_EdgeInstanceBuffer.isGenerated() || m_EdgeInstanceBuffer.size() == 0)
+        if (!m_EdgeInstanceBuffer.isGenerated() || m_EdgeCount == 0)
             return;
 
         m_EdgeShader->use();
@@ -305,7 +547,7 @@ public:
         glVertexAttribDivisorARB(m_EdgeShader->attribute("a_TargetColor").location(), 1);
         glVertexAttribDivisorARB(m_EdgeShader->attribute("a_Width").location(), 1);
 
-        context->geometry().drawArraysInstanced(GL_POINTS, 0, m_EdgeParticleBuffer.size() / sizeof(EdgeParticle), m_EdgeInstanceBuffer.size() / sizeof(EdgeInstance));
+        context->geometry().drawArraysInstanced(GL_POINTS, 0, m_EdgeParticleBuffer.size() / sizeof(EdgeParticle), m_EdgeCount);
         
         glVertexAttribDivisorARB(m_EdgeShader->attribute("a_Origin").location(), 0);
         glVertexAttribDivisorARB(m_EdgeShader->attribute("a_SourcePosition").location(), 0);
@@ -320,7 +562,7 @@ public:
 
     virtual void drawNodes(Context* context, Camera& camera, Transformation& transformation)
     {       
-        if (!m_NodeInstanceBuffer.isGenerated() || m_NodeInstanceBuffer.size() == 0)
+        if (!m_NodeInstanceBuffer.isGenerated() || m_NodeCount == 0)
             return;
 
         m_NodeShader->use();
@@ -337,7 +579,7 @@ public:
         glVertexAttribDivisorARB(m_NodeShader->attribute("a_Color").location(), 1);
         glVertexAttribDivisorARB(m_NodeShader->attribute("a_Size").location(), 1);
 
-        context->geometry().drawArraysInstanced(GL_POINTS, 0, m_NodeParticleBuffer.size() / sizeof(NodeParticle), m_NodeInstanceBuffer.size() / sizeof(NodeInstance));
+        context->geometry().drawArraysInstanced(GL_POINTS, 0, m_NodeParticleBuffer.size() / sizeof(NodeParticle), m_NodeCount);
         
         glVertexAttribDivisorARB(m_NodeShader->attribute("a_Origin").location(), 0);
         glVertexAttribDivisorARB(m_NodeShader->attribute("a_Position").location(), 0);
@@ -354,77 +596,146 @@ public:
         drawNodes(context, camera, transformation);
     }
 
+    // Nearest node hit by the ray, the nodes are tested in parallel and every worker keeps its nearest hit.
+    // NOTE : Ties go to the lowest ID so the result doesn't depend on the scheduling
     bool intersectNodes(const Ray& ray, NodeInstance::ID* id)
     {
-        // TODO : Parallel Reduction with OpenCL
+        syncOpenCL();
 
-        Intersection::Hit hit;
-        bool found = false;
-        float min_distance = std::numeric_limits<float>::max();
-
-        NodeInstance node;
+        const NodeInstance* nodes = reinterpret_cast<const NodeInstance*>(m_NodeInstanceBuffer.ptr());
 
-        for (unsigned int i = 0; i < m_NodeInstanceBuffer.size() / sizeof(NodeInstance); i++)
+        std::vector<Pick> picks(m_CPU.threads().size());
+        m_CPU.threads().parallelFor(m_NodeCount, 4096, [&](unsigned int worker, unsigned long begin, unsigned long end)
         {
-            m_NodeInstanceBuffer.get(i, &node, sizeof(NodeInstance));
+            Intersection::Hit hit;
+            Pick& pick = picks[worker];
 
-            if (Intersection::RaySphere(ray, node.Position.xyz(), node.Size, hit))
-            {
-                if (id == NULL)
-                    return true;
+            for (unsigned long i = begin; i < end; i++)
+                if (Intersection::RaySphere(ray, nodes[i].Position.xyz(), nodes[i].Size, hit))
+                    pick.add(i, hit.distance);
+        });
 
-                if (hit.distance < min_distance)
-                {
-                    *id = i;
-                    min_distance = hit.distance;
-                }
-
-                found = true;
-            }
-        }
-        
-        return found;
+        return reduce(picks, id);
     }
 
-    /* TODO: GPUGraph::intersectEdges
+    // Nearest edge hit by the ray, edges are picked as capsules as wide as they are drawn
     bool intersectEdges(const Ray& ray, EdgeInstance::ID* id)
     {
-        return false;
+        syncOpenCL();
+
+        const EdgeInstance* edges = reinterpret_cast<const EdgeInstance*>(m_EdgeInstanceBuffer.ptr());
+        const glm::vec3 origin = ray.position();
+        const glm::vec3 direction = ray.direction();
+
+        std::vector<Pick> picks(m_CPU.threads().size());
+        m_CPU.threads().parallelFor(m_EdgeCount, 4096, [&](unsigned int worker, unsigned long begin, unsigned long end)
+        {
+            float distance;
+            Pick& pick = picks[worker];
+
+            for (unsigned long e = begin; e < end; e++)
+                if (raySegment(origin, direction, edges[e].SourcePosition.xyz(), edges[e].TargetPosition.xyz(), 0.5f * edges[e].Width, distance))
+                    pick.add(e, distance);
+        });
+
+        return reduce(picks, id);
     }
-    */
 
     void computeBoundingBox(glm::vec3& min, glm::vec3& max)
     {
-        NodeInstance node;
-        for (unsigned int i = 0; i < m_NodeInstanceBuffer.size() / sizeof(NodeInstance); i++)
+        if (m_NodeCount == 0)
+            return;
+
+        syncOpenCL();
+
+        const NodeInstance* nodes = reinterpret_cast<const NodeInstance*>(m_NodeInstanceBuffer.ptr());
+
+        // NOTE : Workers without a range keep the first position, which doesn't change the bounds
+        std::vector<glm::vec3> mins(m_CPU.threads().size(), nodes[0].Position.xyz());
+        std::vector<glm::vec3> maxs(m_CPU.threads().size(), nodes[0].Position.xyz());
+
+        m_CPU.threads().parallelFor(m_NodeCount, 4096, [&](unsigned int worker, unsigned long begin, unsigned long end)
         {
-            m_NodeInstanceBuffer.get(i, &node, sizeof(NodeInstance));
-            if (i == 0)
-            {
-                min = node.Position.xyz();
-                max = node.Position.xyz();
-            }
-            else
+            glm::vec3& lo = mins[worker];
+            glm::vec3& hi = maxs[worker];
+
+            for (unsigned long i = begin; i < end; i++)
             {
-                if (node.Position.x < min.x) min.x = node.Position.x;
-                if (node.Position.y < min.y) min.y = node.Position.y;
-                if (node.Position.z < min.z) min.z = node.Position.z;
+                const glm::vec4& position = nodes[i].Position;
 
-                if (node.Position.x > max.x) max.x = node.Position.x;
-                if (node.Position.y > max.y) max.y = node.Position.y;
-                if (node.Position.z > max.z) max.z = node.Position.z;
+                if (position.x < lo.x) lo.x = position.x;
+                if (position.y < lo.y) lo.y = position.y;
+                if (position.z < lo.z) lo.z = position.z;
+
+                if (position.x > hi.x) hi.x = position.x;
+                if (position.y > hi.y) hi.y = position.y;
+                if (position.z > hi.z) hi.z = position.z;
             }
+        });
+
+        min = mins[0];
+        max = maxs[0];
+        for (unsigned int w = 1; w < mins.size(); w++)
+        {
+            if (mins[w].x < min.x) min.x = mins[w].x;
+            if (mins[w].y < min.y) min.y = mins[w].y;
+            if (mins[w].z < min.z) min.z = mins[w].z;
+
+            if (maxs[w].x > max.x) max.x = maxs[w].x;
+            if (maxs[w].y > max.y) max.y = maxs[w].y;
+            if (maxs[w].z > max.z) max.z = maxs[w].z;
         }
     }
 
     // ----- Nodes Accessors -----
 
     inline Buffer& getNodes() { return m_NodeInstanceBuffer; }
+    inline size_t countNodes() const { return m_NodeCount; }
     
-    void addNode(const NodeInstance& node)
+    NodeInstance::ID addNode(const NodeInstance& node)
     {
-        m_NodeInstanceBuffer.push(&node, sizeof(NodeInstance));
+        NodeInstance::ID id = m_NodeCount;
+
+        // NOTE : Slots freed by removals are reused before the buffer grows
+        if (id < m_NodeInstanceBuffer.size() / sizeof(NodeInstance))
+            m_NodeInstanceBuffer.set(id, &node, sizeof(NodeInstance));
+        else
+            m_NodeInstanceBuffer.push(&node, sizeof(NodeInstance));
+
+        m_NodeCount++;
+        m_Incidence.push_back(std::vector<EdgeInstance::ID>());
+
+        m_DirtyNodes.IDs.push_back(id);
         m_NeedsUpdate = true;
+        m_CL.LinksChanged = true;
+        return id;
+    }
+
+    // Swaps the last node into the slot of the removed one and patches the edges of the moved node.
+    // Returns the former ID of the moved node, which is the removed ID when it was the last one.
+    // NOTE : Incident edges are expected to be removed first, the ones left are removed here
+    NodeInstance::ID removeNode(NodeInstance::ID id)
+    {
+        syncOpenCL();
+        return eraseNode(id, NULL);
+    }
+
+    // Removes several nodes with a single read back of the OpenCL instances, moves are appended in the order they
+    // happened, an ID can move several times.
+    void removeNodes(std::vector<NodeInstance::ID> ids, std::vector<Move>* moves = NULL, std::vector<Move>* edge_moves = NULL)
+    {
+        syncOpenCL();
+
+        // NOTE : In decreasing order, the last node is never one still to be removed
+        std::sort(ids.begin(), ids.end(), std::greater<NodeInstance::ID>());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+        for (auto id : ids)
+        {
+            NodeInstance::ID last = eraseNode(id, edge_moves);
+            if (moves != NULL && last != id)
+                moves->push_back(Move(last, id));
+        }
     }
 
     inline NodeInstance getNode(NodeInstance::ID id)
@@ -437,17 +748,56 @@ public:
     inline void setNode(NodeInstance::ID id, const NodeInstance& node)
     {
         m_NodeInstanceBuffer.set(id, &node, sizeof(NodeInstance));
+        m_DirtyNodes.IDs.push_back(id);
         m_NeedsUpdate = true;
     }
 
     // ----- Edges Accessors -----
 
     inline Buffer& getEdges() { return m_EdgeInstanceBuffer; }
+    inline size_t countEdges() const { return m_EdgeCount; }
 
-    void addEdge(const EdgeInstance& edge)
+    EdgeInstance::ID addEdge(const EdgeInstance& edge)
     {
-        m_EdgeInstanceBuffer.push(&edge, sizeof(EdgeInstance));
+        EdgeInstance::ID id = m_EdgeCount;
+
+        if (id < m_EdgeInstanceBuffer.size() / sizeof(EdgeInstance))
+            m_EdgeInstanceBuffer.set(id, &edge, sizeof(EdgeInstance));
+        else
+            m_EdgeInstanceBuffer.push(&edge, sizeof(EdgeInstance));
+
+        m_EdgeCount++;
+        m_Incidence[edge.SourceID].push_back(id);
+        m_Incidence[edge.TargetID].push_back(id);
+
+        m_DirtyEdges.IDs.push_back(id);
         m_NeedsUpdate = true;
+        m_CL.LinksChanged = true;
+        return id;
+    }
+
+    // Swaps the last edge into the slot of the removed one.
+    // Returns the former ID of the moved edge, which is the removed ID when it was the last one.
+    EdgeInstance::ID removeEdge(EdgeInstance::ID id)
+    {
+        syncOpenCL();
+        return eraseEdge(id);
+    }
+
+    // Removes several edges with a single read back of the OpenCL instances, see removeNodes
+    void removeEdges(std::vector<EdgeInstance::ID> ids, std::vector<Move>* moves = NULL)
+    {
+        syncOpenCL();
+
+        std::sort(ids.begin(), ids.end(), std::greater<EdgeInstance::ID>());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+        for (auto id : ids)
+        {
+            EdgeInstance::ID last = eraseEdge(id);
+            if (moves != NULL && last != id)
+                moves->push_back(Move(last, id));
+        }
     }
 
     inline EdgeInstance getEdge(EdgeInstance::ID id)
@@ -459,20 +809,257 @@ public:
 
     inline void setEdge(EdgeInstance::ID id, const EdgeInstance& edge)
     {
+        EdgeInstance previous = getEdge(id);
+        if (previous.SourceID != edge.SourceID || previous.TargetID != edge.TargetID)
+        {
+            unlink(previous.SourceID, id);
+            unlink(previous.TargetID, id);
+            m_Incidence[edge.SourceID].push_back(id);
+            m_Incidence[edge.TargetID].push_back(id);
+        }
+
         m_EdgeInstanceBuffer.set(id, &edge, sizeof(EdgeInstance));
+        m_DirtyEdges.IDs.push_back(id);
         m_NeedsUpdate = true;
+        m_CL.LinksChanged = true;
     }
 
     // ----- Parameters ------
 
-    inline void setPhysics(bool flag) { m_CL.RunPhysics = flag; }
+    void setPhysics(bool flag)
+    {
+        // NOTE : Once the kernels stop, the CPU instances hold their last results
+        if (!flag)
+            syncOpenCL();
+        m_CL.RunPhysics = flag;
+    }
+
     inline bool getPhysics() { return m_CL.RunPhysics; }
 
+    void setBackend(Backend backend)
+    {
+        if (backend == OPENCL && !m_CL.Available)
+            LOG("[NETWORK] No OpenCL device, the physics stay on the CPU.\n");
+
+        // NOTE : The CPU picks up where the kernels left off
+        Backend previous = getBackend();
+        m_Backend = backend;
+        if (previous == OPENCL && getBackend() == CPU)
+            syncOpenCL();
+    }
+
+    // Backend the physics actually run on
+    inline Backend getBackend() const { return m_Backend == CPU || !m_CL.Available ? CPU : OPENCL; }
+
 private:
+    // ----- Picking -----
+
+    // Nearest hit found by a worker
+    struct Pick
+    {
+        Pick() : Found(false), ID(0), Distance(std::numeric_limits<float>::max()) {}
+
+        inline void add(unsigned int id, float distance)
+        {
+            if (!Found || distance < Distance || (distance == Distance && id < ID))
+            {
+                Found = true;
+                ID = id;
+                Distance = distance;
+            }
+        }
+
+        bool Found;
+        unsigned int ID;
+        float Distance;
+    };
+
+    static bool reduce(const std::vector<Pick>& picks, unsigned int* id)
+    {
+        Pick nearest;
+        for (auto& pick : picks)
+            if (pick.Found)
+                nearest.add(pick.ID, pick.Distance);
+
+        if (nearest.Found && id != NULL)
+            *id = nearest.ID;
+
+        return nearest.Found;
+    }
+
+    // Ray against the capsule of the given radius around segment [a, b], distance is along the ray.
+    // NOTE : Closest points between the ray and the segment, see Ericson, Real-Time Collision Detection 5.1.9
+    static bool raySegment(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& a, const glm::vec3& b, float radius, float& distance)
+    {
+        const float Epsilon = 1e-12f;
+
+        glm::vec3 d2 = b - a;
+        glm::vec3 r = origin - a;
+
+        float dd1 = glm::dot(direction, direction);
+        float dd2 = glm::dot(d2, d2);
+        float d12 = glm::dot(direction, d2);
+        float c = glm::dot(direction, r);
+        float f = glm::dot(d2, r);
+
+        if (dd1 <= Epsilon)
+            return false;
+
+        // NOTE : Quick reject, the capsule lies in the sphere of radius |b - a| / 2 + radius around its middle,
+        // whose square is bounded by |b - a|^2 / 2 + 2 radius^2.
+        glm::vec3 w = 0.5f * (a + b) - origin;
+        float along = glm::dot(w, direction);
+        if (glm::dot(w, w) * dd1 - along * along > (0.5f * dd2 + 2 * radius * radius) * dd1)
+            return false;
+
+        // s along the ray (0 to infinity), t along the segment (0 to 1)
+        float s = 0;
+        float t = 0;
+
+        if (dd2 <= Epsilon)
+            s = std::max(0.0f, -c / dd1);
+        else
+        {
+            float denom = dd1 * dd2 - d12 * d12;
+            if (denom > Epsilon)
+                s = std::max(0.0f, (d12 * f - c * dd2) / denom);
+
+            t = (d12 * s + f) / dd2;
+            if (t < 0)
+            {
+                t = 0;
+                s = std::max(0.0f, -c / dd1);
+            }
+            else if (t > 1)
+            {
+                t = 1;
+                s = std::max(0.0f, (d12 - c) / dd1);
+            }
+        }
+
+        glm::vec3 gap = (origin + s * direction) - (a + t * d2);
+        if (glm::dot(gap, gap) > radius * radius)
+            return false;
+
+        distance = s * std::sqrt(dd1);
+        return true;
+    }
+
+    // ----- Removal -----
+
+    NodeInstance::ID eraseNode(NodeInstance::ID id, std::vector<Move>* edge_moves)
+    {
+        if (!m_Incidence[id].empty())
+        {
+            std::vector<EdgeInstance::ID> edges = m_Incidence[id];
+            std::sort(edges.begin(), edges.end(), std::greater<EdgeInstance::ID>());
+            edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+            for (auto e : edges)
+            {
+                EdgeInstance::ID moved = eraseEdge(e);
+                if (edge_moves != NULL && moved != e)
+                    edge_moves->push_back(Move(moved, e));
+            }
+        }
+
+        NodeInstance::ID last = m_NodeCount - 1;
+        if (id != last)
+        {
+            NodeInstance node = getNode(last);
+            m_NodeInstanceBuffer.set(id, &node, sizeof(NodeInstance));
+            m_DirtyNodes.IDs.push_back(id);
+
+            // NOTE : A self loop is listed twice, both ends are patched on the first visit
+            EdgeInstance edge;
+            for (auto e : m_Incidence[last])
+            {
+                m_EdgeInstanceBuffer.get(e, &edge, sizeof(EdgeInstance));
+                if (edge.SourceID != last && edge.TargetID != last)
+                    continue;
+                if (edge.SourceID == last)
+                    edge.SourceID = id;
+                if (edge.TargetID == last)
+                    edge.TargetID = id;
+                m_EdgeInstanceBuffer.set(e, &edge, sizeof(EdgeInstance));
+                m_DirtyEdges.IDs.push_back(e);
+            }
+
+            m_Incidence[id].swap(m_Incidence[last]);
+        }
+
+        m_Incidence.pop_back();
+        m_NodeCount--;
+
+        m_NeedsUpdate = true;
+        m_CL.LinksChanged = true;
+        return last;
+    }
+
+    EdgeInstance::ID eraseEdge(EdgeInstance::ID id)
+    {
+        EdgeInstance edge = getEdge(id);
+        unlink(edge.SourceID, id);
+        unlink(edge.TargetID, id);
+
+        EdgeInstance::ID last = m_EdgeCount - 1;
+        if (id != last)
+        {
+            edge = getEdge(last);
+            m_EdgeInstanceBuffer.set(id, &edge, sizeof(EdgeInstance));
+            m_DirtyEdges.IDs.push_back(id);
+
+            relink(edge.SourceID, last, id);
+            relink(edge.TargetID, last, id);
+        }
+
+        m_EdgeCount--;
+
+        m_NeedsUpdate = true;
+        m_CL.LinksChanged = true;
+        return last;
+    }
+
+    // Drops one occurrence of an edge from the incidence list of a node
+    void unlink(NodeInstance::ID node, EdgeInstance::ID edge)
+    {
+        std::vector<EdgeInstance::ID>& edges = m_Incidence[node];
+        for (size_t i = 0; i < edges.size(); i++)
+            if (edges[i] == edge)
+            {
+                edges[i] = edges.back();
+                edges.pop_back();
+                return;
+            }
+    }
+
+    // Renames one occurrence of an edge in the incidence list of a node
+    void relink(NodeInstance::ID node, EdgeInstance::ID from, EdgeInstance::ID to)
+    {
+        std::vector<EdgeInstance::ID>& edges = m_Incidence[node];
+        for (size_t i = 0; i < edges.size(); i++)
+            if (edges[i] == from)
+            {
+                edges[i] = to;
+                return;
+            }
+    }
+
 	Icon* m_NodeIcon;
     Icon* m_EdgeIcon;
     bool m_NeedsUpdate;
 
+    size_t m_NodeCount;    // NOTE : Live instances, the CPU buffers keep the slots of removed ones for reuse
+    size_t m_EdgeCount;
+    std::vector<std::vector<EdgeInstance::ID>> m_Incidence; // NOTE : Edges of every node, to patch them when the node moves
+
+    size_t m_NodeCapacity; // NOTE : Instances the OpenGL buffers can hold, 0 until generated
+    size_t m_EdgeCapacity;
+    DirtyInstances m_DirtyNodes;
+    DirtyInstances m_DirtyEdges;
+
+    Backend m_Backend;
+    int m_Iteration;
+
 	Shader::Program* m_NodeShader;
     Buffer m_NodeParticleBuffer;
 	Buffer m_NodeInstanceBuffer;
@@ -486,6 +1073,8 @@ private:
         OCLData() {}
 
         bool RunPhysics;
+        bool Available; // NOTE : A device was found and the kernels are loaded
+        bool Shared;    // NOTE : The OpenGL buffers are shared with OpenCL
 
         OpenCL::Device* Device;
         OpenCL::Context* Context;
@@ -500,6 +1089,14 @@ private:
         OpenCL::Memory* NodeInstanceBuffer;
         OpenCL::Memory* EdgeInstanceBuffer;
 
+        bool LinksChanged;      // NOTE : Edges were added or changed since the adjacency lists were uploaded
+        cl_mem LinkOffsets;
+        cl_mem LinkNeighbors;
+        unsigned int GroupSize; // NOTE : Work-items per group of the repulsion kernel, each stages one position
+
+        size_t NodeCount;       // NOTE : Instances the kernels last ran on
+        size_t EdgeCount;
+
         float Time;
         float K;
         float Temperature;
@@ -507,4 +1104,6 @@ private:
 
     OpenCL m_OpenCL;
     OCLData m_CL;
+
+    NetworkPhysics m_CPU;
 };
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <graphiti/Layout/ForceKernels.hh>
+#include <graphiti/Layout/ThreadPool.hh>
+
+// Native backend of the network view physics, for machines without a usable OpenCL device.
+// Runs the pipeline of Assets/NetworkView/physics.cl (repulsion, attraction, node_animation, edge_animation)
+// over the node and edge instances with the thread pool and the SIMD force kernels of the space view.
+// NOTE : Forces are summed in per worker buffers instead of NodeInstance::Force, which stays untouched.
+class NetworkPhysics
+{
+public:
+    NetworkPhysics()
+    {
+        m_ISA = ForceKernels::detect();
+        m_Iteration = 0;
+        LOG("[NETWORK] CPU physics kernels : %s\n", ForceKernels::name(m_ISA));
+    }
+
+    // 0 uses all the cores
+    inline void setThreads(unsigned int threads) { m_ThreadPool.resize(threads); }
+
+    // NOTE : Shared with the picking and bounding box reductions of GPUGraph
+    inline ThreadPool& threads() { return m_ThreadPool; }
+
+    // One iteration at the given natural edge length and temperature, see GPUGraph::updatePhysics
+    template <typename NodeInstance, typename EdgeInstance>
+    void run(NodeInstance* nodes, unsigned long node_count, EdgeInstance* edges, unsigned long edge_count, float k, float temperature)
+    {
+        const unsigned int workers = m_ThreadPool.size();
+
+        m_Positions.resize(node_count);
+        m_ThreadPool.parallelFor(node_count, 4096, [&](unsigned int worker, unsigned long begin, unsigned long end)
+        {
+            (void) worker;
+            for (unsigned long i = begin; i < end; i++)
+                m_Positions.set(i, nodes[i].Position.xyz());
+        });
+
+        // NOTE : Self loops don't pull, they are left out like the OpenCL kernel adds nothing for them
+        m_Links.clear();
+        for (unsigned long e = 0; e < edge_count; e++)
+            if (edges[e].SourceID != edges[e].TargetID)
+            {
+                m_Links.push_back(edges[e].SourceID);
+                m_Links.push_back(edges[e].TargetID);
+            }
+
+        m_Buffers.resize(workers);
+        for (auto& buffer : m_Buffers)
+            buffer.zero(node_count);
+
+        // ----- Node Repulsion -----
+
+        // NOTE : Each pair is computed once, rows have uneven costs which the pool balances
+        m_ThreadPool.parallelFor(node_count, 64, [&](unsigned int worker, unsigned long begin, unsigned long end)
+        {
+            ForceKernels::repulsion(m_ISA, m_Positions, begin, end, k * k, m_Iteration, m_Buffers[worker]);
+        });
+
+        // ----- Edge Attraction -----
+
+        m_ThreadPool.parallelFor(m_Links.size() / 2, 1024, [&](unsigned int worker, unsigned long begin, unsigned long end)
+        {
+            ForceKernels::attraction(m_ISA, m_Positions, m_Links.data(), begin, end, k, 0.0f, m_Buffers[worker]);
+        });
+
+        // ----- Node Animation -----
+
+        // NOTE : Nodes move by the temperature along their force, like the node_animation kernel
+        m_ThreadPool.parallelFor(node_count, 4096, [&](unsigned int worker, unsigned long begin, unsigned long end)
+        {
+            (void) worker;
+            for (unsigned long i = begin; i < end; i++)
+            {
+                glm::vec3 force(0, 0, 0);
+                for (auto& buffer : m_Buffers)
+                    force += buffer.get(i);
+
+                float magnitude = glm::length(force);
+                if (magnitude > 0.0 && temperature < 100000) // NOTE: Sphere Radius
+                {
+                    glm::vec3 position = m_Positions.get(i) + temperature * force / magnitude;
+                    nodes[i].Position = glm::vec4(position, nodes[i].Position.w);
+                }
+            }
+        });
+
+        // ----- Edge Animation -----
+
+        m_ThreadPool.parallelFor(edge_count, 4096, [&](unsigned int worker, unsigned long begin, unsigned long end)
+        {
+            (void) worker;
+            for (unsigned long e = begin; e < end; e++)
+            {
+                edges[e].SourcePosition = nodes[edges[e].SourceID].Position;
+                edges[e].TargetPosition = nodes[edges[e].TargetID].Position;
+            }
+        });
+
+        m_Iteration++;
+    }
+
+private:
+    ThreadPool m_ThreadPool;
+    ForceKernels::ISA m_ISA;
+    unsigned long m_Iteration;
+
+    Vec3Array m_Positions;
+    std::vector<unsigned int> m_Links;
+    std::vector<Vec3Array> m_Buffers;
+};
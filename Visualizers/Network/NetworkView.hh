@@ -115,12 +115,20 @@ public:
         LOG("NetworkView::pick(%f, %f)\n", pos.x, pos.y);
         
         GPUGraph::NodeInstance::ID id;
+        GPUGraph::EdgeInstance::ID eid;
         if (m_Graph->intersectNodes(ray, &id))
         { 
             auto n =  m_Graph->getNode(id);
             n.Color = glm::vec4(LOVE_RED, 1.0);
             m_Graph->setNode(id, n);
         }
+        else if (m_Graph->intersectEdges(ray, &eid))
+        {
+            auto e = m_Graph->getEdge(eid);
+            e.SourceColor = glm::vec4(LOVE_RED, 1.0);
+            e.TargetColor = glm::vec4(LOVE_RED, 1.0);
+            m_Graph->setEdge(eid, e);
+        }
     }
 
 	void notify(IMessage* message)
@@ -130,20 +138,20 @@ public:
 
     // ----- Helpers -----
 
-    void checkNodeUID(GPUGraph::NodeInstance::ID uid)
+    void checkNodeUID(Node::ID uid)
     {
         if (!m_NodeMap.containsRemoteID(uid))
         {
-            LOG("Node UID %u not found !\n", uid);
+            LOG("Node UID %lu not found !\n", uid);
             throw;
         }
     }
 
-    void checkEdgeUID(GPUGraph::EdgeInstance::ID uid)
+    void checkEdgeUID(Edge::ID uid)
     {
         if (!m_EdgeMap.containsRemoteID(uid))
         {
-            LOG("Edge UID %u not found !\n", uid);
+            LOG("Edge UID %lu not found !\n", uid);
             throw;
         }
     }
@@ -159,6 +167,17 @@ public:
             vbool.set(value);
             m_Graph->setPhysics(vbool.value());
         }
+        else if (name == "network:physics:backend" && type == RD_STRING)
+        {
+            if (value == "auto")
+                m_Graph->setBackend(GPUGraph::AUTO);
+            else if (value == "opencl")
+                m_Graph->setBackend(GPUGraph::OPENCL);
+            else if (value == "cpu")
+                m_Graph->setBackend(GPUGraph::CPU);
+            else
+                LOG("[NETWORK] Unknown physics backend '%s' (auto, opencl, cpu)!\n", value.c_str());
+        }
     }
 
     virtual IVariable* getAttribute(const std::string& name)
@@ -188,19 +207,24 @@ public:
 
         node.Size = 1.0;
         
-        m_Graph->addNode(node);
-
-        static unsigned int node_count = 0;
-
-        GPUGraph::NodeInstance::ID nid = node_count;
+        GPUGraph::NodeInstance::ID nid = m_Graph->addNode(node);
         m_NodeMap.addRemoteID(uid, nid);
-
-        node_count++;
     }
 
     void onRemoveNode(Node::ID uid) override
     {
-        LOG("onRemoveNode(%lu)\n", uid);
+        checkNodeUID(uid);
+
+        GPUGraph::NodeInstance::ID nid = m_NodeMap.getLocalID(uid);
+
+        // NOTE : Incident edges have already been removed through onRemoveEdge
+
+        m_NodeMap.eraseRemoteID(uid, nid);
+
+        // NOTE : The last node takes the place of the removed one
+        GPUGraph::NodeInstance::ID moved = m_Graph->removeNode(nid);
+        if (moved != nid)
+            m_NodeMap.moveLocalID(moved, nid);
     }
 
     void onSetNodeAttribute(Node::ID uid, const std::string& name, VariableType type, const std::string& value) override
@@ -320,19 +344,41 @@ public:
 
         edge.Width = 0.5; // NOTE : Half of the node size
 
-        m_Graph->addEdge(edge);
+        GPUGraph::EdgeInstance::ID eid = m_Graph->addEdge(edge);
+        m_EdgeMap.addRemoteID(uid, eid);
+    }
 
-        static unsigned int edge_count = 0;
+    void onRemoveEdge(Edge::ID uid) override
+    {
+        checkEdgeUID(uid);
 
-        GPUGraph::EdgeInstance::ID eid = edge_count;
-        m_EdgeMap.addRemoteID(uid, eid);
+        GPUGraph::EdgeInstance::ID eid = m_EdgeMap.getLocalID(uid);
 
-        edge_count++;
+        m_EdgeMap.eraseRemoteID(uid, eid);
+
+        GPUGraph::EdgeInstance::ID moved = m_Graph->removeEdge(eid);
+        if (moved != eid)
+            m_EdgeMap.moveLocalID(moved, eid);
     }
 
-    void onRemoveEdge(Edge::ID uid) override
+    void onRemoveEdges(const std::vector<Edge::ID>& uids) override
     {
-        LOG("onRemoveEdge(%lu)\n", uid);
+        std::vector<GPUGraph::EdgeInstance::ID> eids;
+        eids.reserve(uids.size());
+        for (auto uid : uids)
+        {
+            checkEdgeUID(uid);
+
+            GPUGraph::EdgeInstance::ID eid = m_EdgeMap.getLocalID(uid);
+            m_EdgeMap.eraseRemoteID(uid, eid);
+            eids.push_back(eid);
+        }
+
+        // NOTE : Moves come in the order they happened, an edge can move several times
+        std::vector<GPUGraph::Move> moves;
+        m_Graph->removeEdges(eids, &moves);
+        for (auto& move : moves)
+            m_EdgeMap.moveLocalID(move.From, move.To);
     }
 
     void onSetEdgeAttribute(Edge::ID uid, const std::string& name, VariableType type, const std::string& value) override
@@ -431,7 +477,7 @@ private:
     Axis* m_Axis;
 
 	GPUGraph* m_Graph;
-    TranslationMap<GPUGraph::NodeInstance::ID, unsigned int> m_NodeMap;
-    TranslationMap<GPUGraph::EdgeInstance::ID, unsigned int> m_EdgeMap;
+    TranslationMap<Node::ID, GPUGraph::NodeInstance::ID> m_NodeMap;
+    TranslationMap<Edge::ID, GPUGraph::EdgeInstance::ID> m_EdgeMap;
 };
 
@@ -267,7 +267,7 @@ public:
 		glm::vec3 direction = pos - camera->getPosition();
 		float length = glm::length(direction);
 
-		m_GraphView->getNodes()[m_SelectedNode]->setPosition(ray.position() + length * ray.direction());
+		m_GraphView->moveNode(m_SelectedNode, ray.position() + length * ray.direction());
 
 		// NOTE: I don't think we need to force octree update here since we can only drag nodes within the vision field.
 	}
@@ -1,168 +1,554 @@
 #pragma once
 
-#include <graphiti/Entities/Graph/GraphModel.hh>
+#include <graphiti/Layout/Headers.hh>
 
-class EdgeAttractionForce : public Physics::IForce
+#include <graphiti/Layout/BarnesHut.hh>
+#include <graphiti/Layout/ForceKernels.hh>
+#include <graphiti/Layout/ThreadPool.hh>
+
+#include <unordered_map>
+
+// Private copy of the node positions and links the layout runs on, owned by the layout thread (see SpaceLayout).
+// Bodies are kept densely packed (removal swaps with the last one), prepare() lays the visible ones
+// out first in contiguous step arrays for the force kernels and integrate() moves them.
+// relax() runs the incremental layout, moving only the neighbourhood of a few nodes.
+class SpaceBodies
 {
 public:
-	EdgeAttractionForce()
+	// NOTE : Same as SpaceNode::ID and SpaceEdge::ID, the layout doesn't depend on the view (see Headless.hh)
+	typedef unsigned long NodeID;
+	typedef unsigned long EdgeID;
+
+	SpaceBodies()
 	{
-	    m_GraphModel = NULL;
-	    m_NodeTranslationMap = NULL;
-		m_MinNodeDistance = 10.0f;
+		m_ISA = ForceKernels::detect();
+		m_Visible = 0;
+		m_Generation = 0;
+		m_Active = 0;
+
+		m_ShowNodeLOD = false;
+		m_ShowEdgeLOD = false;
+		m_LODSlice[0] = 0.0f;
+		m_LODSlice[1] = 1.0f;
+
+		LOG("[SPACE] Force kernels : %s\n", ForceKernels::name(m_ISA));
 	}
 
-	virtual ~EdgeAttractionForce()
+	// ----- Nodes -----
+
+	// NOTE : Nodes which are not placed yet move to the barycentre of their placed neighbours in relax()
+	void addNode(NodeID id, const glm::vec3& position, bool placed = true)
 	{
+		if (id >= m_Indices.size())
+		{
+			m_Indices.resize(id + 1, ~0u);
+			m_Adjacency.resize(id + 1);
+		}
+
+		m_Indices[id] = m_IDs.size();
+		m_IDs.push_back(id);
+		m_Positions.push_back(position);
+		m_Locked.push_back(0);
+		m_LODs.push_back(1.0f);
+		m_Placed.push_back(placed ? 1 : 0);
+		m_Marks.push_back(0);
+	}
+
+	// NOTE : Incident edges must have been removed first
+	void removeNode(NodeID id)
+	{
+		unsigned int b = body(id);
+		if (b == ~0u)
+			return;
+
+		unsigned int last = m_IDs.size() - 1;
+		m_IDs[b] = m_IDs[last];
+		m_Positions[b] = m_Positions[last];
+		m_Locked[b] = m_Locked[last];
+		m_LODs[b] = m_LODs[last];
+		m_Placed[b] = m_Placed[last];
+		m_Marks[b] = m_Marks[last];
+		m_Indices[m_IDs[b]] = b;
+
+		m_IDs.pop_back();
+		m_Positions.pop_back();
+		m_Locked.pop_back();
+		m_LODs.pop_back();
+		m_Placed.pop_back();
+		m_Marks.pop_back();
+		m_Indices[id] = ~0u;
+		m_Adjacency[id].clear();
 	}
 
-	void bind(GraphModel* model, NodeTranslationMap* nodeTranslationMap, EdgeTranslationMap* edgeTranslationMap)
+	inline void setPosition(NodeID id, const glm::vec3& position) { if (body(id) != ~0u) m_Positions[body(id)] = position; }
+	inline void setLocked(NodeID id, bool locked) { if (body(id) != ~0u) m_Locked[body(id)] = locked ? 1 : 0; }
+	inline void setNodeLOD(NodeID id, float lod) { if (body(id) != ~0u) m_LODs[body(id)] = lod; }
+
+	// ----- Edges -----
+
+	void addEdge(EdgeID id, NodeID node1, NodeID node2)
 	{
-		m_GraphModel = model;
-		m_NodeTranslationMap = nodeTranslationMap;
-		m_EdgeTranslationMap = edgeTranslationMap;
+		if (id >= m_EdgeIndices.size())
+			m_EdgeIndices.resize(id + 1, ~0u);
+
+		Link link;
+		link.ID = id;
+		link.Node1 = node1;
+		link.Node2 = node2;
+		link.LOD = 1.0f;
+
+		m_EdgeIndices[id] = m_Links.size();
+		m_Links.push_back(link);
+
+		if (std::max(node1, node2) >= m_Adjacency.size())
+			m_Adjacency.resize(std::max(node1, node2) + 1);
+		m_Adjacency[node1].push_back(node2);
+		m_Adjacency[node2].push_back(node1);
 	}
 
-	void apply(Scene::NodeVector& nodes, Scene::NodeVector& edges)
+	void removeEdge(EdgeID id)
 	{
-		if (!m_GraphModel)
-		{
-			LOG("[SPACEVIEW] Need a bound graph model to apply force !\n");
+		if (id >= m_EdgeIndices.size() || m_EdgeIndices[id] == ~0u)
 			return;
+
+		unsigned int l = m_EdgeIndices[id];
+		unlink(m_Links[l].Node1, m_Links[l].Node2);
+		unlink(m_Links[l].Node2, m_Links[l].Node1);
+
+		m_Links[l] = m_Links.back();
+		m_EdgeIndices[m_Links[l].ID] = l;
+		m_Links.pop_back();
+		m_EdgeIndices[id] = ~0u;
+	}
+
+	inline void setEdgeLOD(EdgeID id, float lod)
+	{
+		if (id < m_EdgeIndices.size() && m_EdgeIndices[id] != ~0u)
+			m_Links[m_EdgeIndices[id]].LOD = lod;
+	}
+
+	// Same visibility rules as SpaceResources::isNodeVisible / isEdgeVisible
+	void setLODWindow(bool showNodeLOD, bool showEdgeLOD, float min, float max)
+	{
+		m_ShowNodeLOD = showNodeLOD;
+		m_ShowEdgeLOD = showEdgeLOD;
+		m_LODSlice[0] = min;
+		m_LODSlice[1] = max;
+	}
+
+	// ----- Step -----
+
+	// Copies the positions into the step arrays, visible bodies first, and resets the forces
+	void prepare()
+	{
+		m_Order.clear();
+		m_Hidden.clear();
+		for (unsigned int b = 0; b < m_IDs.size(); b++)
+		{
+			if (visible(m_ShowNodeLOD, m_LODs[b]))
+				m_Order.push_back(b);
+			else
+				m_Hidden.push_back(b);
 		}
+		m_Visible = m_Order.size();
+		m_Order.insert(m_Order.end(), m_Hidden.begin(), m_Hidden.end());
 
-		glm::vec3 pos1, dir1;
-		glm::vec3 pos2, dir2;
+		m_Step.resize(m_Order.size());
+		m_StepIndices.resize(m_IDs.size());
+		for (unsigned int s = 0; s < m_Order.size(); s++)
+		{
+			m_Step.set(s, m_Positions[m_Order[s]]);
+			m_StepIndices[m_Order[s]] = s;
+		}
 
-		const float volume = 20 * 20 * 20; // NOTE : Graph should fit in this cube
-		float k = pow(volume / m_GraphModel->countNodes(), 1.0 / 3.0);
+		m_StepLinks.clear();
+		for (auto& link : m_Links)
+		{
+			if (!visible(m_ShowEdgeLOD, link.LOD) || body(link.Node1) == ~0u || body(link.Node2) == ~0u)
+				continue;
+			m_StepLinks.push_back(m_StepIndices[body(link.Node1)]);
+			m_StepLinks.push_back(m_StepIndices[body(link.Node2)]);
+		}
 
-		// Calculate edge attractive forces
-		std::vector<Edge>::iterator itl;
-		for (itl = m_GraphModel->edges_begin(); itl != m_GraphModel->edges_end(); ++itl)
+		m_Forces.zero(m_Order.size());
+	}
+
+	// NOTE : Like Scene::NodeVector, forces are normalized, slightly randomized and scaled by the step.
+	// Also returns the energy (sum of the squared forces) and the largest displacement of the iteration.
+	void integrate(float step, float* energy, float* displacement)
+	{
+		*energy = 0;
+		*displacement = 0;
+
+		for (unsigned int s = 0; s < m_Order.size(); s++)
 		{
-			SpaceEdge::ID eid = m_EdgeTranslationMap->getLocalID(itl->id());
-			if (!g_SpaceResources->isEdgeVisible(edges[eid]->getLOD()))
+			unsigned int b = m_Order[s];
+			if (m_Locked[b])
 				continue;
 
-			SpaceNode::ID id1 = m_NodeTranslationMap->getLocalID(itl->data().Node1);
-			SpaceNode::ID id2 = m_NodeTranslationMap->getLocalID(itl->data().Node2);
+			glm::vec3 direction = m_Forces.get(s);
+			float length = glm::length(direction);
+			if (length > 0)
+				direction = direction / length;
 
-			pos1 = nodes[id1]->getPosition();
-			pos2 = nodes[id2]->getPosition();
-			dir1 = nodes[id1]->getDirection();
-			dir2 = nodes[id2]->getDirection();
+			direction += 0.01f * glm::vec3((float) rand() / RAND_MAX - 0.5f, (float) rand() / RAND_MAX - 0.5f, (float) rand() / RAND_MAX - 0.5f);
 
-			glm::vec3 dir = pos1 - pos2;
-			float d = glm::length(dir);
-			if (d < m_MinNodeDistance)
+			m_Positions[b] += step * direction;
+
+			*energy += length * length;
+			*displacement = std::max(*displacement, step * glm::length(direction));
+		}
+	}
+
+	// ----- Incremental -----
+
+	// Relaxes the seeds and their neighbourhood up to the given number of hops, the rest of the graph stays fixed.
+	// Nodes right outside of the neighbourhood still push and pull, so the cost only depends on the neighbourhood size.
+	void relax(const std::vector<NodeID>& seeds, unsigned int hops, unsigned int iterations)
+	{
+		// NOTE : Keeps hubs from pulling the whole graph into the neighbourhood
+		const unsigned int c_MaxActive = 1024;
+		const unsigned int c_MaxBoundary = 4096;
+
+		const float volume = 20 * 20 * 20; // NOTE : Graph should fit in this cube
+		const float k = pow(volume / size(), 1.0 / 3.0);
+
+		// Place new nodes at the barycentre of their placed neighbours
+		for (auto id : seeds)
+		{
+			unsigned int b = body(id);
+			if (b == ~0u || m_Placed[b])
 				continue;
 
-			// Attractive Force : fa(x) = x * x / k
-			dir1 = dir1 - (dir / d) * (d * d / k);
-			dir2 = dir2 + (dir / d) * (d * d / k);
+			glm::vec3 barycentre(0, 0, 0);
+			unsigned int count = 0;
+			for (auto neighbor : m_Adjacency[id])
+			{
+				unsigned int n = body(neighbor);
+				if (n != ~0u && m_Placed[n])
+				{
+					barycentre += m_Positions[n];
+					count++;
+				}
+			}
+
+			if (count > 0 && !m_Locked[b])
+			{
+				m_Positions[b] = barycentre / (float) count + 0.1f * k * glm::vec3((float) rand() / RAND_MAX - 0.5f, (float) rand() / RAND_MAX - 0.5f, (float) rand() / RAND_MAX - 0.5f);
+				m_Placed[b] = 1;
+			}
+		}
+
+		// Breadth first search for the neighbourhood, then its boundary
+		m_Generation++;
+		m_Local.clear();
+		for (auto id : seeds)
+			if (body(id) != ~0u && m_Marks[body(id)] != m_Generation && m_Local.size() < c_MaxActive)
+			{
+				m_Marks[body(id)] = m_Generation;
+				m_Local.push_back(body(id));
+			}
+
+		// NOTE : The last expansion only collects the boundary
+		unsigned long begin = 0;
+		for (unsigned int hop = 0; hop <= hops; hop++)
+		{
+			if (hop == hops)
+				m_Active = m_Local.size();
 
-			nodes[id1]->setDirection(dir1, false);
-			nodes[id2]->setDirection(dir2, false);
+			unsigned long end = m_Local.size();
+			unsigned long limit = hop < hops ? c_MaxActive : m_Active + c_MaxBoundary;
+			for (unsigned long i = begin; i < end; i++)
+				for (auto neighbor : m_Adjacency[m_IDs[m_Local[i]]])
+				{
+					unsigned int n = body(neighbor);
+					if (n == ~0u || m_Marks[n] == m_Generation || m_Local.size() >= limit)
+						continue;
+					m_Marks[n] = m_Generation;
+					m_Local.push_back(n);
+				}
+			begin = end;
 		}
+
+		// Forces over the neighbourhood, only the active part moves
+		m_LocalIndices.clear();
+		for (unsigned long i = 0; i < m_Local.size(); i++)
+			m_LocalIndices[m_Local[i]] = i;
+
+		m_LocalLinks.clear();
+		for (unsigned long i = 0; i < m_Active; i++)
+			for (auto neighbor : m_Adjacency[m_IDs[m_Local[i]]])
+			{
+				auto it = m_LocalIndices.find(body(neighbor));
+				// NOTE : Links between two active nodes are seen from both sides, keep one
+				if (it != m_LocalIndices.end() && (it->second >= m_Active || it->second > i))
+				{
+					m_LocalLinks.push_back(i);
+					m_LocalLinks.push_back(it->second);
+				}
+			}
+
+		std::vector<glm::vec3> forces(m_Active);
+
+		for (unsigned int it = 0; it < iterations; it++)
+		{
+			std::fill(forces.begin(), forces.end(), glm::vec3(0, 0, 0));
+
+			for (unsigned long i = 0; i < m_Active; i++)
+				for (unsigned long j = 0; j < m_Local.size(); j++)
+					if (i != j)
+						forces[i] += ForceKernels::repulse(m_Positions[m_Local[i]] - m_Positions[m_Local[j]], k * k, i, j, it);
+
+			for (unsigned long l = 0; l < m_LocalLinks.size(); l += 2)
+			{
+				unsigned int i1 = m_LocalLinks[l];
+				unsigned int i2 = m_LocalLinks[l + 1];
+
+				glm::vec3 dir = m_Positions[m_Local[i1]] - m_Positions[m_Local[i2]];
+				glm::vec3 fa = dir * (glm::length(dir) / k);
+				forces[i1] -= fa;
+				if (i2 < m_Active)
+					forces[i2] += fa;
+			}
+
+			// NOTE : Moves start at the natural spacing and cool down linearly
+			float step = k * (1.0f - (float) it / iterations);
+			for (unsigned long i = 0; i < m_Active; i++)
+			{
+				float length = glm::length(forces[i]);
+				if (length > 0 && !m_Locked[m_Local[i]])
+					m_Positions[m_Local[i]] += forces[i] * (std::min(length, step) / length);
+			}
+		}
+	}
+
+	// Adds the per worker force buffers to the step forces
+	void reduce(ThreadPool& pool, std::vector<Vec3Array>& buffers)
+	{
+		pool.parallelFor(m_Forces.size(), 4096, [&](unsigned int worker, unsigned long begin, unsigned long end)
+		{
+			(void) worker;
+			for (auto& buffer : buffers)
+			{
+				for (unsigned long i = begin; i < end; i++)
+				{
+					m_Forces.X[i] += buffer.X[i];
+					m_Forces.Y[i] += buffer.Y[i];
+					m_Forces.Z[i] += buffer.Z[i];
+				}
+			}
+		});
 	}
 
+	inline unsigned long size() const { return m_IDs.size(); }
+	inline unsigned long visible() const { return m_Visible; }
+
+	inline const std::vector<NodeID>& ids() const { return m_IDs; }
+	inline const std::vector<glm::vec3>& bodies() const { return m_Positions; }
+	inline bool isLocked(NodeID id) const { return body(id) != ~0u && m_Locked[body(id)]; }
+
+	// All the links as pairs of body indices, regardless of their lod
+	void bodyLinks(std::vector<unsigned int>& links) const
+	{
+		links.clear();
+		for (auto& link : m_Links)
+		{
+			if (body(link.Node1) == ~0u || body(link.Node2) == ~0u)
+				continue;
+			links.push_back(body(link.Node1));
+			links.push_back(body(link.Node2));
+		}
+	}
+
+	inline ForceKernels::ISA isa() const { return m_ISA; }
+	inline const Vec3Array& positions() const { return m_Step; }
+	inline Vec3Array& forces() { return m_Forces; }
+	inline const std::vector<unsigned int>& links() const { return m_StepLinks; }
+
 private:
-	GraphModel* m_GraphModel;
-	NodeTranslationMap* m_NodeTranslationMap;
-	EdgeTranslationMap* m_EdgeTranslationMap;
+	struct Link
+	{
+		EdgeID ID;
+		NodeID Node1;
+		NodeID Node2;
+		float LOD;
+	};
 
-	float m_MinNodeDistance;
+	inline unsigned int body(NodeID id) const { return id < m_Indices.size() ? m_Indices[id] : ~0u; }
+
+	inline bool visible(bool show, float lod) const { return !show || (lod >= m_LODSlice[0] && lod <= m_LODSlice[1]); }
+
+	void unlink(NodeID node, NodeID neighbor)
+	{
+		std::vector<NodeID>& neighbors = m_Adjacency[node];
+		auto it = std::find(neighbors.begin(), neighbors.end(), neighbor);
+		if (it != neighbors.end())
+		{
+			*it = neighbors.back();
+			neighbors.pop_back();
+		}
+	}
+
+	ForceKernels::ISA m_ISA;
+
+	// Bodies
+	std::vector<NodeID> m_IDs;
+	std::vector<unsigned int> m_Indices;
+	std::vector<glm::vec3> m_Positions;
+	std::vector<char> m_Locked;
+	std::vector<float> m_LODs;
+
+	std::vector<Link> m_Links;
+	std::vector<unsigned int> m_EdgeIndices;
+	std::vector<std::vector<NodeID>> m_Adjacency;
+
+	// Incremental
+	std::vector<char> m_Placed;
+	std::vector<unsigned int> m_Marks;
+	unsigned int m_Generation;
+	std::vector<unsigned int> m_Local;
+	unsigned long m_Active;
+	std::unordered_map<unsigned int, unsigned int> m_LocalIndices;
+	std::vector<unsigned int> m_LocalLinks;
+
+	bool m_ShowNodeLOD;
+	bool m_ShowEdgeLOD;
+	float m_LODSlice[2];
+
+	// Step
+	std::vector<unsigned int> m_Order;
+	std::vector<unsigned int> m_Hidden;
+	std::vector<unsigned int> m_StepIndices;
+	std::vector<unsigned int> m_StepLinks;
+	unsigned long m_Visible;
+
+	Vec3Array m_Step;
+	Vec3Array m_Forces;
 };
 
-class NodeRepulsionForce : public Physics::IForce
+// NOTE : Each worker accumulates in its own buffer, see SpaceBodies::reduce
+inline void resetForceBuffers(unsigned int workers, unsigned long count, std::vector<Vec3Array>& buffers)
+{
+	buffers.resize(workers);
+	for (auto& buffer : buffers)
+		buffer.zero(count);
+}
+
+class EdgeAttractionForce : public Physics::IForce
 {
 public:
-	NodeRepulsionForce()
+	EdgeAttractionForce()
 	{
-	    m_GraphModel = NULL;
-	    m_NodeTranslationMap = NULL;
+	    m_ThreadPool = NULL;
+		m_MinNodeDistance = 10.0f;
 	}
 
-	virtual ~NodeRepulsionForce()
+	virtual ~EdgeAttractionForce()
 	{
 	}
 
-	void bind(GraphModel* model, NodeTranslationMap* nodeTranslationMap)
+	void bind(ThreadPool* pool)
 	{
-		m_GraphModel = model;
-		m_NodeTranslationMap = nodeTranslationMap;
+		m_ThreadPool = pool;
 	}
 
-	void apply(Scene::NodeVector& nodes)
+	void apply(SpaceBodies& bodies)
 	{
-		if (!m_GraphModel)
+		const float volume = 20 * 20 * 20; // NOTE : Graph should fit in this cube
+		float k = pow(volume / bodies.size(), 1.0 / 3.0);
+
+		const std::vector<unsigned int>& links = bodies.links();
+
+		// Calculate edge attractive forces
+		resetForceBuffers(m_ThreadPool->size(), bodies.size(), m_Buffers);
+
+		m_ThreadPool->parallelFor(links.size() / 2, 1024, [&](unsigned int worker, unsigned long begin, unsigned long end)
 		{
-			LOG("[SPACEVIEW] Need a bound graph model to apply force !\n");
-			return;
-		}
+			ForceKernels::attraction(bodies.isa(), bodies.positions(), links.data(), begin, end, k, m_MinNodeDistance, m_Buffers[worker]);
+		});
 
-		const float volume = 20 * 20 * 20; // NOTE : Graph should fit in this cube
-		float k = pow(volume / m_GraphModel->countNodes(), 1.0 / 3.0);
+		bodies.reduce(*m_ThreadPool, m_Buffers);
+	}
 
-		// TODO : Need a better graph model to access the node neighbors quickly
+private:
+	ThreadPool* m_ThreadPool;
 
-		glm::vec3 pos1, dir1;
-		glm::vec3 pos2, dir2;
+	float m_MinNodeDistance;
 
-		std::vector<Node>::iterator itn1;
-		std::vector<Node>::iterator itn2;
+	std::vector<Vec3Array> m_Buffers;
+};
 
-		for (itn1 = m_GraphModel->nodes_begin(); itn1 != m_GraphModel->nodes_end(); ++itn1)
-		{
-			SpaceNode::ID id1 = m_NodeTranslationMap->getLocalID(itn1->id());
+class NodeRepulsionForce : public Physics::IForce
+{
+public:
+	enum Mode { EXACT, BARNES_HUT };
 
-			if (!g_SpaceResources->isNodeVisible(nodes[id1]->getLOD()))
-				continue;
+	NodeRepulsionForce()
+	{
+	    m_ThreadPool = NULL;
+		m_Mode = EXACT;
+		m_Iteration = 0;
+	}
 
-			pos1 = nodes[id1]->getPosition();
-			dir1 = nodes[id1]->getDirection();
+	virtual ~NodeRepulsionForce()
+	{
+	}
 
-			for (itn2 = m_GraphModel->nodes_begin(); itn2 != m_GraphModel->nodes_end(); ++itn2)
-			{
-				if (itn1 == itn2)
-					break;
+	void bind(ThreadPool* pool)
+	{
+		m_ThreadPool = pool;
+	}
 
-				SpaceNode::ID id2 = m_NodeTranslationMap->getLocalID(itn2->id());
-				if (!g_SpaceResources->isNodeVisible(nodes[id2]->getLOD()))
-					continue;
+	void apply(SpaceBodies& bodies)
+	{
+		const float volume = 20 * 20 * 20; // NOTE : Graph should fit in this cube
+		float k = pow(volume / bodies.size(), 1.0 / 3.0);
+		float k2 = k * k;
 
-				pos2 = nodes[id2]->getPosition();
-				dir2 = nodes[id2]->getDirection();
+		unsigned long count = bodies.visible();
 
-				glm::vec3 dir = pos1 - pos2;
-				float d = glm::length(dir);
-				if (d < 0.1f)
-				{
-					// NOTE : Nodes are too close, randomize direction
-					float rnd_theta = ((float) rand() / RAND_MAX) * 2.0 * M_PI;
-					float rnd_z = ((float) rand() / RAND_MAX) - 1.0;
-					dir.x = sqrt(1 - rnd_z * rnd_z) * cos(rnd_theta);
-					dir.y = sqrt(1 - rnd_z * rnd_z) * sin(rnd_theta);
-					dir.z = rnd_z;
-					d = 1.0;
-				}
+		if (m_Mode == BARNES_HUT)
+		{
+			// NOTE : Same forces as the exact mode, distant clusters are approximated by their center of mass
+			m_Tree.build(bodies.positions(), count);
 
-				// Repulsive Force : fr(x) = k * k / x
-				glm::vec3 fr = (dir / d) * (k * k / d);
-				dir1 = dir1 + fr;
-				dir2 = dir2 - fr;
+			Vec3Array& forces = bodies.forces();
+			m_ThreadPool->parallelFor(count, 256, [&](unsigned int worker, unsigned long begin, unsigned long end)
+			{
+				(void) worker;
+				for (unsigned long b = begin; b < end; b++)
+					forces.set(b, forces.get(b) + m_Tree.repulsion(b, k2, m_Iteration));
+			});
+		}
+		else
+		{
+			// NOTE : Each pair is computed once, rows have uneven costs which the pool balances
+			resetForceBuffers(m_ThreadPool->size(), bodies.size(), m_Buffers);
 
-				nodes[id2]->setDirection(dir2, false);
-			}
+			m_ThreadPool->parallelFor(count, 64, [&](unsigned int worker, unsigned long begin, unsigned long end)
+			{
+				ForceKernels::repulsion(bodies.isa(), bodies.positions(), begin, end, k2, m_Iteration, m_Buffers[worker]);
+			});
 
-			nodes[id1]->setDirection(dir1, false);
+			bodies.reduce(*m_ThreadPool, m_Buffers);
 		}
+
+		m_Iteration++;
 	}
 
+	inline void setMode(Mode mode) { m_Mode = mode; }
+	inline Mode getMode() const { return m_Mode; }
+
+	inline void setTheta(float theta) { m_Tree.setTheta(theta); }
+
 private:
-	GraphModel* m_GraphModel;
-	NodeTranslationMap* m_NodeTranslationMap;
+	ThreadPool* m_ThreadPool;
+
+	Mode m_Mode;
+	BarnesHutTree m_Tree;
+	unsigned long m_Iteration;
+
+	std::vector<Vec3Array> m_Buffers;
 };
 
 class DustAttractor : public Physics::IForce
@@ -179,21 +565,12 @@ public:
 	{
 	}
 
-	void apply(Scene::NodeVector& nodes)
+	void apply(SpaceBodies& bodies)
 	{
-		Scene::NodeVector::iterator it;
-		for (it = nodes.begin(); it != nodes.end(); ++it)
-		{
-			if (*it == NULL)
-				continue;
-
-			glm::vec3 d = m_Position - (*it)->getPosition();
-			if (glm::length2(d) > m_Radius * m_Radius)
-				(*it)->setDirection((*it)->getDirection() + glm::normalize(d) * m_Factor, false);
-		}
+		ForceKernels::dust(bodies.isa(), bodies.positions(), 0, bodies.size(), m_Position, m_Radius, m_Factor, bodies.forces());
 	}
 
-	inline float getRadius() { return m_Radius; }
+	inline float getRadius() const { return m_Radius; }
 private:
 	glm::vec3 m_Position;
 	float m_Radius;
@@ -0,0 +1,457 @@
+#pragma once
+
+#include <graphiti/Layout/Multilevel.hh>
+#include <graphiti/Layout/Stress.hh>
+#include <graphiti/Layout/TripleBuffer.hh>
+#include <graphiti/Visualizers/Space/SpaceForces.hh>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Runs the space force layout on its own thread, decoupled from the render loop.
+// The worker owns a private copy of the positions (SpaceBodies) and iterates as fast as it can while playing.
+// The view queues its mutations (nodes, edges, locks, lods, parameters) and picks up the latest positions
+// with update() / frame(), published through a triple buffer so neither side waits on the other.
+// The step size follows Hu's adaptive cooling and the worker pauses itself once the layout has converged.
+// In incremental mode, new nodes and edges only relax their neighbourhood while the global physics is paused.
+class SpaceLayout
+{
+public:
+    // Latest positions computed by the worker
+    struct Frame
+    {
+        Frame() : Sequence(0), Iteration(0), Energy(0), Displacement(0), Converged(false), Playing(false) {}
+
+        unsigned long Sequence; // Number of commands the worker had processed when this frame was computed
+        unsigned long Iteration;
+        float Energy;           // Sum of the squared forces
+        float Displacement;     // Largest node move of the iteration
+        bool Converged;         // The worker paused itself after this frame
+        bool Playing;           // The worker keeps iterating after this frame
+        std::vector<SpaceBodies::NodeID> IDs;
+        std::vector<glm::vec3> Positions;
+    };
+
+    SpaceLayout()
+    {
+        m_Sent = 0;
+        m_Stop = false;
+
+        m_Playing = false;
+        m_Temperature = 0.2f;
+        m_Tolerance = 0.01f;
+        m_MaxIterations = 0;
+        m_Start = 0;
+        m_Incremental = false;
+        m_Hops = 2;
+        m_LocalIterations = 50;
+        m_Processed = 0;
+        m_Iteration = 0;
+
+        cool(true);
+
+        m_EdgeAttractionForce.bind(&m_ThreadPool);
+        m_NodeRepulsionForce.bind(&m_ThreadPool);
+        m_Multilevel.bind(&m_ThreadPool);
+        m_Stress.bind(&m_ThreadPool);
+
+        m_Thread = std::thread(&SpaceLayout::run, this);
+    }
+
+    ~SpaceLayout()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stop = true;
+        }
+        m_Wake.notify_one();
+
+        m_Thread.join();
+    }
+
+    // ----- Commands -----
+
+    inline void play() { push(Command(PLAY)); }
+    inline void pause() { push(Command(PAUSE)); }
+    inline void setTemperature(float temperature) { Command c(TEMPERATURE); c.Value = temperature; push(c); }
+
+    inline void addNode(SpaceBodies::NodeID id, const glm::vec3& position) { Command c(ADD_NODE); c.ID1 = id; c.Position = position; push(c); }
+    inline void removeNode(SpaceBodies::NodeID id) { Command c(REMOVE_NODE); c.ID1 = id; push(c); }
+    inline void setPosition(SpaceBodies::NodeID id, const glm::vec3& position) { Command c(SET_POSITION); c.ID1 = id; c.Position = position; push(c); }
+    // Same as setPosition() for many nodes, queued at once
+    void setPositions(const std::vector<SpaceBodies::NodeID>& ids, const std::vector<glm::vec3>& positions)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            for (unsigned long i = 0; i < ids.size(); i++)
+            {
+                Command c(SET_POSITION);
+                c.ID1 = ids[i];
+                c.Position = positions[i];
+                m_Commands.push_back(c);
+            }
+        }
+        m_Sent += ids.size();
+        m_Wake.notify_one();
+    }
+
+    inline void setLocked(SpaceBodies::NodeID id, bool locked) { Command c(SET_LOCKED); c.ID1 = id; c.Value = locked ? 1.0f : 0.0f; push(c); }
+    inline void setNodeLOD(SpaceBodies::NodeID id, float lod) { Command c(NODE_LOD); c.ID1 = id; c.Value = lod; push(c); }
+
+    inline void addEdge(SpaceBodies::EdgeID id, SpaceBodies::NodeID node1, SpaceBodies::NodeID node2) { Command c(ADD_EDGE); c.ID1 = id; c.ID2 = node1; c.ID3 = node2; push(c); }
+    inline void removeEdge(SpaceBodies::EdgeID id) { Command c(REMOVE_EDGE); c.ID1 = id; push(c); }
+    inline void setEdgeLOD(SpaceBodies::EdgeID id, float lod) { Command c(EDGE_LOD); c.ID1 = id; c.Value = lod; push(c); }
+
+    inline void setLODWindow(bool showNodeLOD, bool showEdgeLOD, const glm::vec2& slice)
+    {
+        Command c(LOD_WINDOW);
+        c.ID1 = showNodeLOD;
+        c.ID2 = showEdgeLOD;
+        c.Position = glm::vec3(slice.x, slice.y, 0);
+        push(c);
+    }
+
+    inline void setRepulsion(NodeRepulsionForce::Mode mode) { Command c(REPULSION); c.ID1 = mode; push(c); }
+    inline void setTheta(float theta) { Command c(THETA); c.Value = theta; push(c); }
+    inline void setThreads(unsigned int threads) { Command c(THREADS); c.ID1 = threads; push(c); }
+
+    // Convergence threshold, relative to the temperature
+    inline void setTolerance(float tolerance) { Command c(TOLERANCE); c.Value = tolerance; push(c); }
+    // Pauses the layout after this many iterations since play(), 0 runs until convergence
+    inline void setMaxIterations(unsigned long iterations) { Command c(MAX_ITERATIONS); c.ID1 = iterations; push(c); }
+
+    inline void setIncremental(bool incremental) { Command c(INCREMENTAL); c.ID1 = incremental; push(c); }
+    inline void setHops(unsigned int hops) { Command c(HOPS); c.ID1 = hops; push(c); }
+
+    // Lays the whole graph out again with the multilevel layout, locked nodes keep their position
+    inline void multilevel() { push(Command(MULTILEVEL)); }
+    // Lays the whole graph out again with stress majorization, the other nodes are placed around the locked ones
+    inline void stress() { push(Command(STRESS)); }
+
+    // Number of commands queued so far, compare with Frame::Sequence to know whether a frame has seen a command
+    inline unsigned long sequence() const { return m_Sent; }
+
+    // ----- Frames -----
+
+    // Returns true when the worker published a new frame since the last call
+    inline bool update() { return m_Frames.update(); }
+    inline const Frame& frame() const { return m_Frames.front(); }
+
+    inline float getDustRadius() const { return m_DustAttractor.getRadius(); }
+
+private:
+    enum CommandType
+    {
+        PLAY, PAUSE, TEMPERATURE,
+        ADD_NODE, REMOVE_NODE, SET_POSITION, SET_LOCKED, NODE_LOD,
+        ADD_EDGE, REMOVE_EDGE, EDGE_LOD,
+        LOD_WINDOW, REPULSION, THETA, THREADS, TOLERANCE, MAX_ITERATIONS, INCREMENTAL, HOPS, MULTILEVEL, STRESS
+    };
+
+    struct Command
+    {
+        Command(CommandType type) : Type(type), ID1(0), ID2(0), ID3(0), Value(0) {}
+
+        CommandType Type;
+        unsigned long ID1;
+        unsigned long ID2;
+        unsigned long ID3;
+        float Value;
+        glm::vec3 Position;
+    };
+
+    void push(const Command& command)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Commands.push_back(command);
+        }
+        m_Sent++;
+        m_Wake.notify_one();
+    }
+
+    void execute(const Command& c)
+    {
+        switch (c.Type)
+        {
+        case PLAY:
+            m_Playing = true;
+            m_Start = m_Iteration;
+            cool(true);
+            break;
+        case PAUSE:
+            m_Playing = false;
+            break;
+        case TEMPERATURE:
+            m_Temperature = c.Value;
+            cool(true);
+            break;
+        case TOLERANCE:
+            m_Tolerance = c.Value;
+            break;
+        case MAX_ITERATIONS:
+            m_MaxIterations = c.ID1;
+            break;
+        case INCREMENTAL:
+            m_Incremental = c.ID1 != 0;
+            break;
+        case HOPS:
+            m_Hops = c.ID1;
+            break;
+        case ADD_NODE:
+            m_Bodies.addNode(c.ID1, c.Position, !m_Incremental);
+            if (m_Incremental)
+                m_Seeds.push_back(c.ID1);
+            break;
+        case REMOVE_NODE:
+            m_Bodies.removeNode(c.ID1);
+            break;
+        case SET_POSITION:
+            m_Bodies.setPosition(c.ID1, c.Position);
+            break;
+        case SET_LOCKED:
+            m_Bodies.setLocked(c.ID1, c.Value != 0.0f);
+            break;
+        case NODE_LOD:
+            m_Bodies.setNodeLOD(c.ID1, c.Value);
+            break;
+        case ADD_EDGE:
+            m_Bodies.addEdge(c.ID1, c.ID2, c.ID3);
+            if (m_Incremental)
+            {
+                m_Seeds.push_back(c.ID2);
+                m_Seeds.push_back(c.ID3);
+            }
+            break;
+        case REMOVE_EDGE:
+            m_Bodies.removeEdge(c.ID1);
+            break;
+        case EDGE_LOD:
+            m_Bodies.setEdgeLOD(c.ID1, c.Value);
+            break;
+        case LOD_WINDOW:
+            m_Bodies.setLODWindow(c.ID1 != 0, c.ID2 != 0, c.Position.x, c.Position.y);
+            break;
+        case REPULSION:
+            m_NodeRepulsionForce.setMode(static_cast<NodeRepulsionForce::Mode>(c.ID1));
+            break;
+        case THETA:
+            m_NodeRepulsionForce.setTheta(c.Value);
+            break;
+        case THREADS:
+            m_ThreadPool.resize(c.ID1);
+            break;
+        case MULTILEVEL:
+            runMultilevel();
+            break;
+        case STRESS:
+            runStress();
+            break;
+        }
+    }
+
+    void step()
+    {
+        // NOTE : Forces run over contiguous copies of the positions
+        m_Bodies.prepare();
+
+        m_NodeRepulsionForce.apply(m_Bodies);
+        m_EdgeAttractionForce.apply(m_Bodies);
+        m_DustAttractor.apply(m_Bodies);
+
+        m_Bodies.integrate(m_Step, &m_Energy, &m_Displacement);
+
+        m_Iteration++;
+
+        cool(false);
+
+        // NOTE : Once the step has cooled down, nodes only jitter around their position
+        m_Converged = m_Displacement < m_Tolerance * m_Temperature;
+        if (m_Converged)
+        {
+            LOG("[SPACE] Layout converged after %lu iterations (energy %f, displacement %f).\n", m_Iteration, m_Energy, m_Displacement);
+            m_Playing = false;
+        }
+        else if (m_MaxIterations > 0 && m_Iteration - m_Start >= m_MaxIterations)
+        {
+            LOG("[SPACE] Layout stopped after %lu iterations (energy %f, displacement %f).\n", m_MaxIterations, m_Energy, m_Displacement);
+            m_Playing = false;
+        }
+
+        publish();
+    }
+
+    // Hu's adaptive cooling : the step grows back after 5 iterations lowering the energy and shrinks as soon as it rises.
+    // NOTE : Rises under 2% only shrink the step a little, the random jitter alone makes the energy wobble that much,
+    //        but a layout stuck on a flat energy (e.g. a small path) still has to cool down.
+    void cool(bool reset)
+    {
+        const float t = 0.95f;
+        const float margin = 1.02f;
+
+        if (reset)
+        {
+            m_Step = m_Temperature;
+            m_Progress = 0;
+            m_PreviousEnergy = std::numeric_limits<float>::max();
+            m_Energy = 0;
+            m_Displacement = 0;
+            m_Converged = false;
+            return;
+        }
+
+        if (m_Energy < m_PreviousEnergy)
+        {
+            if (++m_Progress >= 5)
+            {
+                m_Progress = 0;
+                m_Step = std::min(m_Temperature, m_Step / t);
+            }
+        }
+        else
+        {
+            m_Progress = 0;
+            m_Step = (m_Energy < margin * m_PreviousEnergy ? 0.99f : t) * m_Step;
+        }
+
+        m_PreviousEnergy = m_Energy;
+    }
+
+    void runMultilevel()
+    {
+        std::vector<glm::vec3> positions = m_Bodies.bodies();
+        std::vector<unsigned int> links;
+        m_Bodies.bodyLinks(links);
+
+        const std::vector<SpaceBodies::NodeID>& ids = m_Bodies.ids();
+        std::vector<bool> locked(ids.size());
+        for (unsigned long b = 0; b < ids.size(); b++)
+            locked[b] = m_Bodies.isLocked(ids[b]);
+
+        m_Multilevel.run(positions, links, locked);
+
+        for (unsigned long b = 0; b < ids.size(); b++)
+            if (!locked[b])
+                m_Bodies.setPosition(ids[b], positions[b]);
+
+        cool(true);
+        publish();
+    }
+
+    void runStress()
+    {
+        std::vector<glm::vec3> positions = m_Bodies.bodies();
+        std::vector<unsigned int> links;
+        m_Bodies.bodyLinks(links);
+
+        const std::vector<SpaceBodies::NodeID>& ids = m_Bodies.ids();
+        std::vector<bool> locked(ids.size());
+        for (unsigned long b = 0; b < ids.size(); b++)
+            locked[b] = m_Bodies.isLocked(ids[b]);
+
+        m_Stress.run(positions, links, locked);
+
+        for (unsigned long b = 0; b < ids.size(); b++)
+            if (!locked[b])
+                m_Bodies.setPosition(ids[b], positions[b]);
+
+        cool(true);
+        publish();
+    }
+
+    // NOTE : Commands are counted as they run, a frame published in the middle of a batch only covers the commands before it
+    void publish()
+    {
+        Frame& frame = m_Frames.back();
+        frame.Sequence = m_Processed;
+        frame.Iteration = m_Iteration;
+        frame.Energy = m_Energy;
+        frame.Displacement = m_Displacement;
+        frame.Converged = m_Converged;
+        frame.Playing = m_Playing;
+        frame.IDs = m_Bodies.ids();
+        frame.Positions = m_Bodies.bodies();
+        m_Frames.publish();
+    }
+
+    void run()
+    {
+        std::vector<Command> commands;
+
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Wake.wait(lock, [this]() { return m_Stop || !m_Commands.empty() || (m_Playing && m_Bodies.size() > 0); });
+                if (m_Stop)
+                    return;
+
+                commands.swap(m_Commands);
+            }
+
+            for (auto& command : commands)
+            {
+                m_Processed++;
+                execute(command);
+            }
+            commands.clear();
+
+            // NOTE : The global physics takes care of new nodes while playing
+            if (!m_Seeds.empty())
+            {
+                if (!m_Playing && m_Bodies.size() > 0)
+                {
+                    m_Bodies.relax(m_Seeds, m_Hops, m_LocalIterations);
+                    publish();
+                }
+                m_Seeds.clear();
+            }
+
+            if (m_Playing && m_Bodies.size() > 0)
+                step();
+        }
+    }
+
+    std::thread m_Thread;
+
+    // Shared
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::vector<Command> m_Commands;
+    bool m_Stop;
+
+    TripleBuffer<Frame> m_Frames;
+
+    // View thread
+    unsigned long m_Sent;
+
+    // Layout thread
+    bool m_Playing;
+    float m_Temperature;
+    float m_Tolerance;
+    unsigned long m_MaxIterations;
+    unsigned long m_Start;
+
+    bool m_Incremental;
+    unsigned int m_Hops;
+    unsigned int m_LocalIterations;
+    std::vector<SpaceBodies::NodeID> m_Seeds;
+
+    float m_Step;
+    unsigned int m_Progress;
+    float m_PreviousEnergy;
+    float m_Energy;
+    float m_Displacement;
+    bool m_Converged;
+    unsigned long m_Processed;
+    unsigned long m_Iteration;
+
+    ThreadPool m_ThreadPool;
+    SpaceBodies m_Bodies;
+    EdgeAttractionForce m_EdgeAttractionForce;
+    NodeRepulsionForce m_NodeRepulsionForce;
+    DustAttractor m_DustAttractor;
+    MultilevelLayout m_Multilevel;
+    StressLayout m_Stress;
+};
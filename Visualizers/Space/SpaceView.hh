@@ -29,9 +29,10 @@
 
 #include <graphiti/Visualizers/Space/SpaceResources.hh>
 
-typedef TranslationMap<SpaceNode::ID, Node::ID> NodeTranslationMap;
-typedef TranslationMap<SpaceEdge::ID, Edge::ID> EdgeTranslationMap;
-#include <graphiti/Visualizers/Space/SpaceForces.hh>
+typedef TranslationMap<Node::ID, SpaceNode::ID> NodeTranslationMap;
+typedef TranslationMap<Edge::ID, SpaceEdge::ID> EdgeTranslationMap;
+#include <graphiti/Visualizers/Space/SpaceLayout.hh>
+#include <graphiti/Layout/Shapes.hh>
 
 #include <graphiti/Pack.hh>
  
@@ -85,9 +86,10 @@ class SpaceView : public GraphView
          m_DirtyOctree = false;
  
          m_PhysicsMode = PAUSE;
-         m_LastUpdateTime = 0;
-         m_Iterations = 0;
-         m_Temperature = 0.2f;
+         m_PlaySequence = 0;
+
+         m_Shapes.bind(&m_ThreadPool);
+         m_ShapeRadius = 20.0f;
      }
  
     virtual ~SpaceView()
@@ -115,9 +117,6 @@ class SpaceView : public GraphView
         m_Cameras.lookAt(glm::vec3(0, 0, -5), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
         m_CameraAnimation = false;
 
-        m_EdgeAttractionForce.bind(m_GraphEntity->model(), &m_NodeMap, &m_EdgeMap);
-        m_NodeRepulsionForce.bind(m_GraphEntity->model(), &m_NodeMap);
-
         m_GraphEntity->views().push_back(this);
         m_GraphEntity->listeners().push_back(this);
 
@@ -178,6 +177,23 @@ class SpaceView : public GraphView
             variable->set(m_Cameras[0]->getPosition());
             return variable;
         }
+        else if (name == "physics:stats")
+        {
+            // NOTE : Energy, largest displacement and iteration count of the last layout frame
+            const SpaceLayout::Frame& frame = m_Layout.frame();
+            Vec3Variable* variable = new Vec3Variable();
+            if (isCurrent(frame))
+                variable->set(glm::vec3(frame.Energy, frame.Displacement, (float) frame.Iteration));
+            else
+                variable->set(glm::vec3(0, 0, 0));
+            return variable;
+        }
+        else if (name == "physics:converged")
+        {
+            BooleanVariable* variable = new BooleanVariable();
+            variable->set(m_Layout.frame().Converged && isCurrent(m_Layout.frame()));
+            return variable;
+        }
 
          return NULL;
  	}
@@ -257,6 +273,59 @@ class SpaceView : public GraphView
 
         return NULL;
     }
+
+    unsigned int exportNodeArray(const std::string& name, std::vector<float>& array) override
+    {
+        unsigned int components;
+        if (name == "position")
+            components = 3;
+        else if (name == "color")
+            components = 4;
+        else
+            return 0;
+
+        array.resize(model()->countNodes() * components);
+
+        float* out = array.data();
+        for (auto it = model()->nodes_begin(); it != model()->nodes_end(); ++it, out += components)
+        {
+            SpaceNode* node = static_cast<SpaceNode*>(m_SpaceNodes[m_NodeMap.getLocalID(it->id())]);
+
+            if (components == 3)
+            {
+                glm::vec3 position = node->getPosition();
+                out[0] = position.x; out[1] = position.y; out[2] = position.z;
+            }
+            else
+            {
+                glm::vec4 color = node->getColor();
+                out[0] = color.r; out[1] = color.g; out[2] = color.b; out[3] = color.a;
+            }
+        }
+
+        return components;
+    }
+
+    void commitNodeArray(const std::string& name, const std::vector<float>& array) override
+    {
+        unsigned int components = name == "position" ? 3 : 4;
+        if ((name != "position" && name != "color") || array.size() != model()->countNodes() * components)
+            return;
+
+        const float* in = array.data();
+        for (auto it = model()->nodes_begin(); it != model()->nodes_end(); ++it, in += components)
+        {
+            SpaceNode* node = static_cast<SpaceNode*>(m_SpaceNodes[m_NodeMap.getLocalID(it->id())]);
+
+            if (components == 3)
+                moveNode(node->getID(), glm::vec3(in[0], in[1], in[2]));
+            else
+                node->setColor(glm::vec4(in[0], in[1], in[2], in[3]));
+        }
+
+        if (components == 3)
+            m_DirtyOctree = true;
+    }
  
     void draw(Context* ctx) override
     {
@@ -390,6 +459,9 @@ class SpaceView : public GraphView
 
         m_NodeMap.addRemoteID(uid, vid);
 
+        m_Layout.addNode(vid, node->getPosition());
+        touchNode(vid);
+
         return vid;
     }
 
@@ -403,12 +475,14 @@ class SpaceView : public GraphView
 
             if (msg->Message == "play")
             {
-                m_Iterations = 1;
                 m_PhysicsMode = PLAY;
+                m_Layout.play();
+                m_PlaySequence = m_Layout.sequence();
             }
             else if (msg->Message == "pause")
             {
                 m_PhysicsMode = PAUSE;
+                m_Layout.pause();
             }
         }
     }
@@ -478,7 +552,7 @@ class SpaceView : public GraphView
         {
             float time = context()->sequencer().track("animation")->clock().seconds();
             glm::vec3 pos;
-            float radius = m_DustAttractor.getRadius() * (0.4 + 0.25 * cos(time / 30.f));
+            float radius = m_Layout.getDustRadius() * (0.4 + 0.25 * cos(time / 30.f));
             pos.x = radius * cos(time / 10.0f);
             pos.y = radius * cos(time / 50.0f);
             pos.z = radius * sin(time / 10.0f);
@@ -486,44 +560,157 @@ class SpaceView : public GraphView
         }
     }
 
+    // Picks up the latest positions computed by the layout thread
     void updateNodes()
     {
-        const unsigned int c_MaxIterations = 100;
-        bool c_Loop = true;
+        if (g_SpaceResources->ShowNodeLOD != m_LODWindow.ShowNodeLOD || g_SpaceResources->ShowEdgeLOD != m_LODWindow.ShowEdgeLOD || g_SpaceResources->LODSlice != m_LODWindow.Slice)
+        {
+            m_LODWindow.ShowNodeLOD = g_SpaceResources->ShowNodeLOD;
+            m_LODWindow.ShowEdgeLOD = g_SpaceResources->ShowEdgeLOD;
+            m_LODWindow.Slice = g_SpaceResources->LODSlice;
+            m_Layout.setLODWindow(m_LODWindow.ShowNodeLOD, m_LODWindow.ShowEdgeLOD, m_LODWindow.Slice);
+        }
 
-        if (m_Iterations < 1 || (!c_Loop  && m_Iterations > c_MaxIterations) || m_PhysicsMode == PAUSE)
+        if (!m_Layout.update())
             return;
-        else if (m_Iterations == 1)
-            m_LastUpdateTime = m_Clock.milliseconds();
 
-        // m_SpaceNodes.setSpeed(20.0f / (float)m_Iterations);
-        m_SpaceNodes.setSpeed(m_Temperature);
+        const SpaceLayout::Frame& frame = m_Layout.frame();
 
-        // Reset node directions
-        for (auto itn : m_SpaceNodes)
-            if (itn != NULL)
-                itn->setDirection(glm::vec3(0, 0, 0), false);
+        if (frame.Converged && isCurrent(frame))
+            m_PhysicsMode = PAUSE;
 
-        // Calculate graph forces
-        m_NodeRepulsionForce.apply(m_SpaceNodes);
-        m_EdgeAttractionForce.apply(m_SpaceNodes, m_SpaceEdges);
-        m_DustAttractor.apply(m_SpaceNodes);
-        // m_GravitationForce.apply(m_SpaceNodes);
+        for (unsigned long i = 0; i < frame.IDs.size(); i++)
+        {
+            SpaceNode::ID id = frame.IDs[i];
+
+            // NOTE : Skip nodes removed, added or moved here since the layout computed this frame
+            if (id >= m_SpaceNodes.size() || m_SpaceNodes[id] == NULL || m_Touched[id] > frame.Sequence)
+                continue;
+
+            if (m_SpaceNodes[id]->isPositionLocked())
+                continue;
+
+            m_SpaceNodes[id]->setPosition(frame.Positions[i]);
+        }
+
+        m_DirtyOctree = true;
+    }
 
-        m_SpaceNodes.normalizeDirections();
-        m_SpaceNodes.randomizeDirections();
-        m_SpaceNodes.update();
+    // NOTE : Frames computed before the last play command still carry the previous run's convergence
+    inline bool isCurrent(const SpaceLayout::Frame& frame) const { return frame.Sequence >= m_PlaySequence; }
 
-        if (!c_Loop)
+    // Moves a node and lets the layout know about it, used when dragging nodes around
+    void moveNode(SpaceNode::ID id, const glm::vec3& position)
+    {
+        m_SpaceNodes[id]->setPosition(position);
+
+        m_Layout.setPosition(id, position);
+        touchNode(id);
+    }
+
+    // Closed form layouts of the console 'layout' command (see Layout/Shapes.hh), computed in parallel and written
+    // straight into the nodes and the layout. Globe only moves geolocated nodes and seeds the nodes of depth 0, both lock them.
+    void applyShape(const std::string& shape)
+    {
+        std::vector<SpaceNode::ID> ids;
+        std::vector<glm::vec2> geolocations;
+
+        AttributeColumn* depths[] = { model()->nodeAttributes().column("depth", RD_INT), model()->nodeAttributes().column("depth", RD_FLOAT) };
+
+        for (auto it = model()->nodes_begin(); it != model()->nodes_end(); ++it)
         {
-            Timecode mean = (m_Clock.milliseconds() - m_LastUpdateTime) / m_Iterations;
-            LOG("[SPACE] Iteration %u/%u, Mean Update Time : %lu ms, Estimated Remaining Time : %lu ms\n", m_Iterations, c_MaxIterations, mean, (c_MaxIterations - m_Iterations) * mean);
+            SpaceNode::ID id = m_NodeMap.getLocalID(it->id());
+
+            if (shape == "globe")
+            {
+                auto geolocation = m_Geolocations.find(id);
+                if (geolocation == m_Geolocations.end())
+                    continue;
+                geolocations.push_back(geolocation->second);
+            }
+            else if (shape == "seeds")
+            {
+                unsigned long row = SlotMap<Node>::index(it->id());
+                bool seed = false;
+                if (depths[0] != NULL && depths[0]->has(row))
+                    seed = depths[0]->integers()[row] == 0;
+                else if (depths[1] != NULL && depths[1]->has(row))
+                    seed = depths[1]->floats()[row] == 0.0f;
+                if (!seed)
+                    continue;
+            }
+
+            ids.push_back(id);
         }
 
-        m_Iterations++;
+        std::vector<glm::vec3> positions(ids.size());
+
+        if (shape == "point")
+            m_Shapes.point(positions);
+        else if (shape == "sphere")
+            m_Shapes.sphere(positions, m_ShapeRadius);
+        else if (shape == "cube")
+            m_Shapes.cube(positions);
+        else if (shape == "cone")
+        {
+            std::vector<unsigned int> degrees(m_SpaceNodes.size(), 0);
+            for (auto it : m_SpaceEdges)
+            {
+                if (it == NULL)
+                    continue;
+                SpaceEdge* edge = static_cast<SpaceEdge*>(it);
+                degrees[edge->getNode1()]++;
+                degrees[edge->getNode2()]++;
+            }
+
+            std::vector<unsigned int> nodeDegrees(ids.size());
+            for (unsigned long i = 0; i < ids.size(); i++)
+                nodeDegrees[i] = degrees[ids[i]];
+
+            m_Shapes.cone(positions, nodeDegrees);
+        }
+        else if (shape == "globe")
+            m_Shapes.globe(positions, geolocations);
+        else if (shape == "seeds")
+            m_Shapes.seeds(positions, 100.0f);
+
+        m_ThreadPool.parallelFor(ids.size(), 4096, [&](unsigned int worker, unsigned long begin, unsigned long end)
+        {
+            (void) worker;
+            for (unsigned long i = begin; i < end; i++)
+                m_SpaceNodes[ids[i]]->setPosition(positions[i]);
+        });
+
+        if (shape == "globe" || shape == "seeds")
+        {
+            for (auto id : ids)
+            {
+                m_SpaceNodes[id]->setPositionLock(true);
+                m_Layout.setLocked(id, true);
+
+                if (shape == "seeds")
+                {
+                    static_cast<SpaceNode*>(m_SpaceNodes[id])->setActivity(2.0f);
+                    static_cast<SpaceNode*>(m_SpaceNodes[id])->setMark(2);
+                }
+            }
+        }
+
+        m_Layout.setPositions(ids, positions);
+        for (auto id : ids)
+            touchNode(id);
+
         m_DirtyOctree = true;
     }
 
+    // Remembers the last layout command about a node, older frames must not overwrite it
+    void touchNode(SpaceNode::ID id)
+    {
+        if (id >= m_Touched.size())
+            m_Touched.resize(id + 1, 0);
+        m_Touched[id] = m_Layout.sequence();
+    }
+
     void updateEdges()
     {
         if (g_SpaceResources->ShowEdges || g_SpaceResources->ShowEdgeActivity)
@@ -627,7 +814,7 @@ class SpaceView : public GraphView
 
     inline void setNodeSize(float size) { g_SpaceResources->NodeIconSize = size; }
     inline void setEdgeSize(float size) { g_SpaceResources->EdgeSize = size; }
-    inline void setTemperature(float temperature) { LOG("Temperature : %f\n", temperature); m_Temperature = temperature; }
+    inline void setTemperature(float temperature) { LOG("Temperature : %f\n", temperature); m_Layout.setTemperature(temperature); }
 
     void checkNodeUID(Node::ID uid)
     {
@@ -688,6 +875,70 @@ class SpaceView : public GraphView
             vbool.set(value);
             g_SpaceResources->ShowDebug = vbool.value();
         }
+        else if (name == "space:layout" && type == RD_STRING)
+        {
+            if (value == "multilevel")
+                m_Layout.multilevel();
+            else if (value == "stress")
+                m_Layout.stress();
+            else if (value == "point" || value == "sphere" || value == "cube" || value == "cone" || value == "globe" || value == "seeds")
+                applyShape(value);
+            else
+                LOG("[SPACE] Unknown layout '%s' (multilevel, stress, point, sphere, cube, cone, globe, seeds)!\n", value.c_str());
+        }
+        else if (name == "space:layout:radius" && type == RD_FLOAT)
+        {
+            vfloat.set(value);
+            m_ShapeRadius = vfloat.value();
+        }
+        else if (name == "space:layout:incremental" && type == RD_BOOLEAN)
+        {
+            vbool.set(value);
+            m_Layout.setIncremental(vbool.value());
+        }
+        else if (name == "space:layout:hops" && type == RD_INT)
+        {
+            IntVariable vint;
+            vint.set(value);
+            m_Layout.setHops(vint.value() > 0 ? vint.value() : 0);
+        }
+        else if (name == "space:physics:repulsion" && type == RD_STRING)
+        {
+            if (value == "exact")
+                m_Layout.setRepulsion(NodeRepulsionForce::EXACT);
+            else if (value == "barnes-hut")
+                m_Layout.setRepulsion(NodeRepulsionForce::BARNES_HUT);
+            else
+                LOG("[SPACE] Unknown repulsion mode '%s' (exact, barnes-hut)!\n", value.c_str());
+        }
+        else if (name == "space:physics:theta" && type == RD_FLOAT)
+        {
+            vfloat.set(value);
+            m_Layout.setTheta(vfloat.value());
+        }
+        else if (name == "space:physics" && type == RD_BOOLEAN)
+        {
+            vbool.set(value);
+            m_PhysicsMode = vbool.value() ? PLAY : PAUSE;
+            if (vbool.value())
+            {
+                m_Layout.play();
+                m_PlaySequence = m_Layout.sequence();
+            }
+            else
+                m_Layout.pause();
+        }
+        else if (name == "space:physics:tolerance" && type == RD_FLOAT)
+        {
+            vfloat.set(value);
+            m_Layout.setTolerance(vfloat.value());
+        }
+        else if (name == "space:physics:threads" && type == RD_INT)
+        {
+            IntVariable vint;
+            vint.set(value);
+            m_Layout.setThreads(vint.value() > 0 ? vint.value() : 0);
+        }
     }
 
     void onAddNode(Node::ID uid, const char* label) override
@@ -702,22 +953,13 @@ class SpaceView : public GraphView
 
         SpaceNode::ID vid = m_NodeMap.getLocalID(uid);
 
-        for (unsigned int i = 0; i < m_SpaceEdges.size(); i++)
-        {
-            if (m_SpaceEdges[i] != NULL)
-            {
-                SpaceEdge* edge = static_cast<SpaceEdge*>(m_SpaceEdges[i]);
-
-                if (edge->getNode1() == vid || edge->getNode2() == vid)
-                {
-                    m_SpaceEdges.remove(i);
-                    m_EdgeMap.removeLocalID(i);
-                }
-            }
-        }
+        // NOTE : Incident edges have already been removed through onRemoveEdge
 
         // TODO : Remove node from spheres here
 
+        m_Layout.removeNode(vid);
+        m_Geolocations.erase(vid);
+
         m_SpaceNodes.remove(vid);
         m_NodeMap.eraseRemoteID(uid, vid);
 
@@ -726,25 +968,34 @@ class SpaceView : public GraphView
 
     void onSetNodeAttribute(Node::ID uid, const std::string& name, VariableType type, const std::string& value) override
     {
-        FloatVariable vfloat;
-        BooleanVariable vbool;
-        StringVariable vstring;
-        Vec3Variable vvec3;
-        Vec4Variable vvec4;
-        IntVariable vint;
+        // NOTE : Only parse values this view actually handles
+        if (name.compare(0, 6, "space:") != 0 && name.compare(0, 10, "particles:") != 0 && name != "world:geolocation")
+            return;
+
+        IVariable* variable = parseVariable(type, value);
+        if (variable == NULL)
+            return;
+
+        onSetNodeAttributeValue(uid, name, *variable);
+
+        delete variable;
+    }
+
+    void onSetNodeAttributeValue(Node::ID uid, const std::string& name, IVariable& value) override
+    {
+        VariableType type = value.type();
 
         checkNodeUID(uid);
         SpaceNode::ID id = m_NodeMap.getLocalID(uid);
 
         if (name == "space:locked" && type == RD_BOOLEAN)
         {
-            vbool.set(value);
-            m_SpaceNodes[id]->setPositionLock(vbool.value());
+            m_SpaceNodes[id]->setPositionLock(static_cast<BooleanVariable&>(value).value());
+            m_Layout.setLocked(id, static_cast<BooleanVariable&>(value).value());
         }
         else if ((name == "space:position" || name == "particles:position") && type == RD_VEC3)
         {
-            vvec3.set(value);
-            m_SpaceNodes[id]->setPosition(vvec3.value());
+            moveNode(id, static_cast<Vec3Variable&>(value).value());
             m_DirtyOctree = true;
         }
         else if (name == "space:color" && (type == RD_VEC3 || type == RD_VEC4))
@@ -752,47 +1003,42 @@ class SpaceView : public GraphView
             glm::vec4 c;
 
             if (type == RD_VEC3)
-            {
-                vvec3.set(value);
-                c = glm::vec4(vvec3.value(), 1.0);
-            }
+                c = glm::vec4(static_cast<Vec3Variable&>(value).value(), 1.0);
             else
-            {
-                vvec4.set(value);
-                c = vvec4.value();
-            }
+                c = static_cast<Vec4Variable&>(value).value();
+
             static_cast<SpaceNode*>(m_SpaceNodes[id])->setColor(c);
         }
         else if (name == "space:lod" && type == RD_FLOAT)
         {
-            vfloat.set(value);
-            m_SpaceNodes[id]->setLOD(vfloat.value());
+            m_SpaceNodes[id]->setLOD(static_cast<FloatVariable&>(value).value());
+            m_Layout.setNodeLOD(id, static_cast<FloatVariable&>(value).value());
         }
         else if (name == "space:activity" && type == RD_FLOAT)
          {
-            vfloat.set(value);
-            static_cast<SpaceNode*>(m_SpaceNodes[id])->setActivity(vfloat.value());
+            static_cast<SpaceNode*>(m_SpaceNodes[id])->setActivity(static_cast<FloatVariable&>(value).value());
          }
         else if (name == "space:icon" && type == RD_STRING)
          {
-            vstring.set(value);
-
             // NOTE : Icon names are lowercase for simplicity
-            std::string lower = vstring.value();
+            std::string lower = static_cast<StringVariable&>(value).value();
             std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
 
             static_cast<SpaceNode*>(m_SpaceNodes[id])->setIcon(lower);
          }
         else if (name == "space:mark" && type == RD_INT)
          {
-            vint.set(value);
-            static_cast<SpaceNode*>(m_SpaceNodes[id])->setMark(static_cast<int>(vint.value()));
+            static_cast<SpaceNode*>(m_SpaceNodes[id])->setMark(static_cast<int>(static_cast<IntVariable&>(value).value()));
          }
         else if (name == "space:size" && type == RD_FLOAT)
          {
-            vfloat.set(value);
-            static_cast<SpaceNode*>(m_SpaceNodes[id])->setSize(vfloat.value());
+            static_cast<SpaceNode*>(m_SpaceNodes[id])->setSize(static_cast<FloatVariable&>(value).value());
          }
+        else if (name == "world:geolocation" && type == RD_VEC2)
+        {
+            // NOTE : Kept for the globe layout, the world view doesn't give them back
+            m_Geolocations[id] = static_cast<Vec2Variable&>(value).value();
+        }
     }
  
     void onSetNodeLabel(Node::ID uid, const char* label) override
@@ -821,6 +1067,7 @@ class SpaceView : public GraphView
         SpaceEdge::ID lid = m_SpaceEdges.add(new SpaceEdge(m_SpaceNodes[node1], m_SpaceNodes[node2]));
 
         m_EdgeMap.addRemoteID(uid, lid);
+        m_Layout.addEdge(lid, node1, node2);
         m_DirtyOctree = true;
     }
 
@@ -830,6 +1077,8 @@ class SpaceView : public GraphView
 
         SpaceEdge::ID vid = m_EdgeMap.getLocalID(uid);
 
+        m_Layout.removeEdge(vid);
+
         m_SpaceEdges.remove(vid);
         m_EdgeMap.eraseRemoteID(uid, vid);
 
@@ -898,6 +1147,7 @@ class SpaceView : public GraphView
         {
             vfloat.set(value);
             m_SpaceEdges[id]->setLOD(vfloat.value());
+            m_Layout.setEdgeLOD(id, vfloat.value());
         }
         else if (name == "space:icon" && type == RD_STRING)
         {
@@ -928,6 +1178,7 @@ class SpaceView : public GraphView
         SpaceEdge::ID lid = m_SpaceEdges.add(new SpaceEdge(m_SpaceNodes[nid], m_SpaceNodes[vid]));
 
         m_EdgeMap.addRemoteID(element.second, lid);
+        m_Layout.addEdge(lid, nid, vid);
 
         m_DirtyOctree = true;
     }
@@ -947,9 +1198,6 @@ class SpaceView : public GraphView
  private:
     GraphEntity* m_GraphEntity;
 
-    Clock m_Clock;
-    Timecode m_LastUpdateTime;
-
     CameraVector m_Cameras;
     bool m_CameraAnimation;
 
@@ -964,12 +1212,22 @@ class SpaceView : public GraphView
     bool m_DirtyOctree;
 
     PhysicsMode m_PhysicsMode;
-    unsigned int m_Iterations;
+    unsigned long m_PlaySequence; // Layout sequence number of the last play command
+
+    SpaceLayout m_Layout;
+    std::vector<unsigned long> m_Touched;
 
-    EdgeAttractionForce m_EdgeAttractionForce;
-    NodeRepulsionForce m_NodeRepulsionForce;
-    Physics::GravitationForce m_GravitationForce;
-    DustAttractor m_DustAttractor;
+    ThreadPool m_ThreadPool;
+    ShapeLayout m_Shapes;
+    float m_ShapeRadius;
+    std::unordered_map<SpaceNode::ID, glm::vec2> m_Geolocations;
+
+    struct LODWindow
+    {
+        LODWindow() : ShowNodeLOD(false), ShowEdgeLOD(false), Slice(0.0, 1.0) {}
 
-    float m_Temperature;
+        bool ShowNodeLOD;
+        bool ShowEdgeLOD;
+        glm::vec2 Slice;
+    } m_LODWindow;
  };
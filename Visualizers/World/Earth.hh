@@ -284,21 +284,7 @@ public:
     {
         EarthGeoPoint::ID vid = m_NodeMap.getLocalID(uid);
 
-        for (unsigned int i = 0; i < m_GeoEdges.size(); i++)
-        {
-            if (m_GeoEdges[i] != NULL)
-            {
-                EarthGeoEdge* edge = static_cast<EarthGeoEdge*>(m_GeoEdges[i]);
-
-                if (edge->getNode1() == vid || edge->getNode2() == vid)
-                {
-                    m_GeoEdges.remove(i);
-                    m_EdgeMap.removeLocalID(i);
-
-                    LOG("Edge %i removed with node\n", i);
-                }
-            }
-        }
+        // NOTE : Incident edges have already been removed through onRemoveEdge
 
         // TODO : Remove node spheres
 
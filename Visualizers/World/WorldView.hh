@@ -17,8 +17,8 @@
 #include <graphiti/Visualizers/World/Earth.hh>
 #include <graphiti/Visualizers/World/WorldMap.hh>
 
-typedef TranslationMap<SpaceNode::ID, Node::ID> NodeTranslationMap;
-typedef TranslationMap<SpaceEdge::ID, Edge::ID> EdgeTranslationMap;
+typedef TranslationMap<Node::ID, SpaceNode::ID> NodeTranslationMap;
+typedef TranslationMap<Edge::ID, SpaceEdge::ID> EdgeTranslationMap;
 
 class WorldView : public GraphView
 {